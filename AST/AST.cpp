@@ -1,13 +1,13 @@
 #include "AST.h"
+#include <algorithm>
+#include <stdexcept>
 
 // Binary expression
-BinaryExpressionAST::BinaryExpressionAST(
-	std::unique_ptr<IExpressionAST> && left,
-	std::unique_ptr<IExpressionAST> && right,
-	BinaryExpressionAST::Operator op)
-	: m_left(std::move(left))
-	, m_right(std::move(right))
+BinaryExpressionAST::BinaryExpressionAST(const IExpressionAST* left, const IExpressionAST* right, Operator op)
+	: IExpressionAST(ExpressionKind::Binary)
 	, m_op(op)
+	, m_left(left)
+	, m_right(right)
 {
 }
 
@@ -32,14 +32,48 @@ void BinaryExpressionAST::Accept(IExpressionVisitor& visitor)const
 }
 
 // Literal constant
-LiteralConstantAST::LiteralConstantAST(const LiteralConstantAST::Value& value)
-	: m_value(value)
+LiteralConstantAST::LiteralConstantAST(int value)
+	: IExpressionAST(ExpressionKind::Literal, ExpressionType::Int)
+	, m_int(value)
 {
 }
 
-const LiteralConstantAST::Value& LiteralConstantAST::GetValue()const
+LiteralConstantAST::LiteralConstantAST(double value)
+	: IExpressionAST(ExpressionKind::Literal, ExpressionType::Float)
+	, m_float(value)
 {
-	return m_value;
+}
+
+LiteralConstantAST::LiteralConstantAST(bool value)
+	: IExpressionAST(ExpressionKind::Literal, ExpressionType::Bool)
+	, m_bool(value)
+{
+}
+
+LiteralConstantAST::LiteralConstantAST(const std::string& value)
+	: IExpressionAST(ExpressionKind::Literal, ExpressionType::String)
+	, m_string(StringInterner::Global().Intern(value))
+{
+}
+
+int LiteralConstantAST::GetInt()const
+{
+	return m_int;
+}
+
+double LiteralConstantAST::GetFloat()const
+{
+	return m_float;
+}
+
+bool LiteralConstantAST::GetBool()const
+{
+	return m_bool;
+}
+
+std::string LiteralConstantAST::GetString()const
+{
+	return StringInterner::Global().GetString(m_string);
 }
 
 void LiteralConstantAST::Accept(IExpressionVisitor& visitor)const
@@ -48,15 +82,26 @@ void LiteralConstantAST::Accept(IExpressionVisitor& visitor)const
 }
 
 // Array element access
-ArrayElementAccessAST::ArrayElementAccessAST(const std::string& name, std::unique_ptr<IExpressionAST> && index)
-	: m_name(name)
-	, m_index(std::move(index))
+ArrayElementAccessAST::ArrayElementAccessAST(const std::string& name, const IExpressionAST* index)
+	: ArrayElementAccessAST(StringInterner::Global().Intern(name), index)
 {
 }
 
-const std::string& ArrayElementAccessAST::GetName()const
+ArrayElementAccessAST::ArrayElementAccessAST(SymbolId symbol, const IExpressionAST* index)
+	: IExpressionAST(ExpressionKind::ArrayAccess)
+	, m_symbol(symbol)
+	, m_index(index)
 {
-	return m_name;
+}
+
+std::string ArrayElementAccessAST::GetName()const
+{
+	return StringInterner::Global().GetString(m_symbol);
+}
+
+SymbolId ArrayElementAccessAST::GetSymbol()const
+{
+	return m_symbol;
 }
 
 const IExpressionAST& ArrayElementAccessAST::GetIndex()const
@@ -70,9 +115,10 @@ void ArrayElementAccessAST::Accept(IExpressionVisitor& visitor)const
 }
 
 // Unary operator
-UnaryAST::UnaryAST(std::unique_ptr<IExpressionAST> && expr, UnaryAST::Operator op)
-	: m_expr(std::move(expr))
+UnaryAST::UnaryAST(const IExpressionAST* expr, UnaryAST::Operator op)
+	: IExpressionAST(ExpressionKind::Unary)
 	, m_op(op)
+	, m_expr(expr)
 {
 }
 
@@ -93,13 +139,25 @@ void UnaryAST::Accept(IExpressionVisitor& visitor)const
 
 // Identifier node
 IdentifierAST::IdentifierAST(const std::string &name)
-	: m_name(name)
+	: IExpressionAST(ExpressionKind::Identifier)
+	, m_symbol(StringInterner::Global().Intern(name))
 {
 }
 
-const std::string& IdentifierAST::GetName()const
+IdentifierAST::IdentifierAST(SymbolId symbol)
+	: IExpressionAST(ExpressionKind::Identifier)
+	, m_symbol(symbol)
 {
-	return m_name;
+}
+
+std::string IdentifierAST::GetName()const
+{
+	return StringInterner::Global().GetString(m_symbol);
+}
+
+SymbolId IdentifierAST::GetSymbol()const
+{
+	return m_symbol;
 }
 
 void IdentifierAST::Accept(IExpressionVisitor& visitor)const
@@ -107,28 +165,32 @@ void IdentifierAST::Accept(IExpressionVisitor& visitor)const
 	visitor.Visit(*this);
 }
 
-FunctionCallExprAST::FunctionCallExprAST(
-	const std::string& name,
-	std::vector<std::unique_ptr<IExpressionAST>>&& params
-)
-	: m_name(name)
-	, m_params(std::move(params))
+FunctionCallExprAST::FunctionCallExprAST(SymbolId name, const IExpressionAST* const* params, size_t count)
+	: IExpressionAST(ExpressionKind::Call)
+	, m_name(name)
+	, m_params(params)
+	, m_count(count)
+{
+}
+
+std::string FunctionCallExprAST::GetName()const
 {
+	return StringInterner::Global().GetString(m_name);
 }
 
-const std::string& FunctionCallExprAST::GetName()const
+SymbolId FunctionCallExprAST::GetSymbol()const
 {
 	return m_name;
 }
 
 size_t FunctionCallExprAST::GetParamsCount() const
 {
-	return m_params.size();
+	return m_count;
 }
 
 const IExpressionAST& FunctionCallExprAST::GetParam(size_t index)const
 {
-	if (index < m_params.size())
+	if (index < m_count)
 	{
 		return *m_params[index];
 	}
@@ -141,21 +203,22 @@ void FunctionCallExprAST::Accept(IExpressionVisitor& visitor)const
 }
 
 // Variable declaration node
-VariableDeclarationAST::VariableDeclarationAST(std::unique_ptr<IdentifierAST> && identifier, ExpressionType type)
-	: m_identifier(std::move(identifier))
+VariableDeclarationAST::VariableDeclarationAST(const IdentifierAST* identifier, ExpressionType type)
+	: IStatementAST(StatementKind::Declaration)
 	, m_type(type)
+	, m_identifier(identifier)
 	, m_expr(nullptr)
 {
 }
 
-void VariableDeclarationAST::SetExpression(std::unique_ptr<IExpressionAST> && expr)
+void VariableDeclarationAST::SetExpression(const IExpressionAST* expr)
 {
-	m_expr = std::move(expr);
+	m_expr = expr;
 }
 
 const IExpressionAST* VariableDeclarationAST::GetExpression()const
 {
-	return m_expr.get();
+	return m_expr;
 }
 
 const IdentifierAST& VariableDeclarationAST::GetIdentifier()const
@@ -174,12 +237,10 @@ void VariableDeclarationAST::Accept(IStatementVisitor& visitor)const
 }
 
 // Assign statement node
-AssignStatementAST::AssignStatementAST(
-	std::unique_ptr<IdentifierAST> && identifier,
-	std::unique_ptr<IExpressionAST> && expr
-)
-	: m_identifier(std::move(identifier))
-	, m_expr(std::move(expr))
+AssignStatementAST::AssignStatementAST(const IdentifierAST* identifier, const IExpressionAST* expr)
+	: IStatementAST(StatementKind::Assign)
+	, m_identifier(identifier)
+	, m_expr(expr)
 {
 }
 
@@ -200,16 +261,31 @@ void AssignStatementAST::Accept(IStatementVisitor& visitor)const
 
 ArrayElementAssignAST::ArrayElementAssignAST(
 	const std::string& arrayId,
-	std::unique_ptr<IExpressionAST>&& index,
-	std::unique_ptr<IExpressionAST>&& expression
+	const IExpressionAST* index,
+	const IExpressionAST* expression
 )
-	: m_arrayId(arrayId)
-	, m_index(std::move(index))
-	, m_expression(std::move(expression))
+	: ArrayElementAssignAST(StringInterner::Global().Intern(arrayId), index, expression)
+{
+}
+
+ArrayElementAssignAST::ArrayElementAssignAST(
+	SymbolId arrayId,
+	const IExpressionAST* index,
+	const IExpressionAST* expression
+)
+	: IStatementAST(StatementKind::ArrayAssign)
+	, m_arrayId(arrayId)
+	, m_index(index)
+	, m_expression(expression)
+{
+}
+
+std::string ArrayElementAssignAST::GetName()const
 {
+	return StringInterner::Global().GetString(m_arrayId);
 }
 
-const std::string& ArrayElementAssignAST::GetName()const
+SymbolId ArrayElementAssignAST::GetSymbol()const
 {
 	return m_arrayId;
 }
@@ -230,14 +306,15 @@ void ArrayElementAssignAST::Accept(IStatementVisitor& visitor)const
 }
 
 // Return statement node
-ReturnStatementAST::ReturnStatementAST(std::unique_ptr<IExpressionAST> && expression)
-	: m_expression(std::move(expression))
+ReturnStatementAST::ReturnStatementAST(const IExpressionAST* expression)
+	: IStatementAST(StatementKind::Return)
+	, m_expression(expression)
 {
 }
 
 const IExpressionAST* ReturnStatementAST::GetExpression()const
 {
-	return m_expression.get();
+	return m_expression;
 }
 
 void ReturnStatementAST::Accept(IStatementVisitor& visitor)const
@@ -247,18 +324,19 @@ void ReturnStatementAST::Accept(IStatementVisitor& visitor)const
 
 // If statement node
 IfStatementAST::IfStatementAST(
-	std::unique_ptr<IExpressionAST> && expr,
-	std::unique_ptr<IStatementAST> && then,
-	std::unique_ptr<IStatementAST> && elif)
-	: m_expr(std::move(expr))
-	, m_then(std::move(then))
-	, m_elif(std::move(elif))
+	const IExpressionAST* expr,
+	const IStatementAST* then,
+	const IStatementAST* elif)
+	: IStatementAST(StatementKind::If)
+	, m_expr(expr)
+	, m_then(then)
+	, m_elif(elif)
 {
 }
 
-void IfStatementAST::SetElseClause(std::unique_ptr<IStatementAST> && elif)
+void IfStatementAST::SetElseClause(const IStatementAST* elif)
 {
-	m_elif = std::move(elif);
+	m_elif = elif;
 }
 
 const IExpressionAST& IfStatementAST::GetExpr()const
@@ -273,7 +351,7 @@ const IStatementAST& IfStatementAST::GetThenStmt()const
 
 const IStatementAST* IfStatementAST::GetElseStmt()const
 {
-	return m_elif ? m_elif.get() : nullptr;
+	return m_elif;
 }
 
 void IfStatementAST::Accept(IStatementVisitor& visitor)const
@@ -282,11 +360,10 @@ void IfStatementAST::Accept(IStatementVisitor& visitor)const
 }
 
 // While statement node
-WhileStatementAST::WhileStatementAST(
-	std::unique_ptr<IExpressionAST> && expr,
-	std::unique_ptr<IStatementAST> && stmt)
-	: m_expr(std::move(expr))
-	, m_stmt(std::move(stmt))
+WhileStatementAST::WhileStatementAST(const IExpressionAST* expr, const IStatementAST* stmt)
+	: IStatementAST(StatementKind::While)
+	, m_expr(expr)
+	, m_stmt(stmt)
 {
 }
 
@@ -306,14 +383,16 @@ void WhileStatementAST::Accept(IStatementVisitor& visitor)const
 }
 
 // Composite statement node
-void CompositeStatementAST::AddStatement(std::unique_ptr<IStatementAST> && stmt)
+CompositeStatementAST::CompositeStatementAST(const IStatementAST* const* statements, size_t count)
+	: IStatementAST(StatementKind::Composite)
+	, m_statements(statements)
+	, m_count(count)
 {
-	m_statements.push_back(std::move(stmt));
 }
 
 const IStatementAST& CompositeStatementAST::GetStatement(size_t index)const
 {
-	if (index >= m_statements.size())
+	if (index >= m_count)
 	{
 		throw std::out_of_range("index must be less that statements count");
 	}
@@ -322,7 +401,7 @@ const IStatementAST& CompositeStatementAST::GetStatement(size_t index)const
 
 size_t CompositeStatementAST::GetCount()const
 {
-	return m_statements.size();
+	return m_count;
 }
 
 void CompositeStatementAST::Accept(IStatementVisitor& visitor)const
@@ -333,14 +412,14 @@ void CompositeStatementAST::Accept(IStatementVisitor& visitor)const
 // Function node
 FunctionAST::FunctionAST(
 	boost::optional<ExpressionType> returnType,
-	std::unique_ptr<IdentifierAST> && identifier,
+	const IdentifierAST* identifier,
 	std::vector<Param> && params,
-	std::unique_ptr<IStatementAST> && statement
+	const IStatementAST* statement
 )
 	: m_returnType(returnType)
-	, m_identifier(std::move(identifier))
 	, m_params(std::move(params))
-	, m_statement(std::move(statement))
+	, m_identifier(identifier)
+	, m_statement(statement)
 {
 }
 
@@ -365,9 +444,27 @@ const IStatementAST& FunctionAST::GetStatement()const
 }
 
 // Program node (root)
-void ProgramAST::AddFunction(std::unique_ptr<FunctionAST> && function)
+void ProgramAST::AddFunction(const FunctionAST* function)
 {
-	m_functions.push_back(std::move(function));
+	m_functions.push_back(function);
+}
+
+void ProgramAST::ReplaceFunctions(size_t index, size_t removed, const FunctionAST* const* functions, size_t count)
+{
+	if (index > m_functions.size() || removed > m_functions.size() - index)
+	{
+		throw std::out_of_range("replaced functions must be in the program");
+	}
+	const size_t common = std::min(removed, count);
+	std::copy(functions, functions + common, m_functions.begin() + index);
+	if (removed > count)
+	{
+		m_functions.erase(m_functions.begin() + index + count, m_functions.begin() + index + removed);
+	}
+	else
+	{
+		m_functions.insert(m_functions.begin() + index + removed, functions + common, functions + count);
+	}
 }
 
 size_t ProgramAST::GetFunctionsCount()const
@@ -384,32 +481,35 @@ const FunctionAST& ProgramAST::GetFunction(size_t index)const
 	return *m_functions[index];
 }
 
+PrintAST::PrintAST(const IExpressionAST* const* params, size_t count)
+	: IStatementAST(StatementKind::Print)
+	, m_params(params)
+	, m_count(count)
+{
+}
+
 size_t PrintAST::GetParamsCount()const
 {
-	return m_params.size();
+	return m_count;
 }
 
 const IExpressionAST& PrintAST::GetExpression(size_t index)const
 {
-	if (index >= m_params.size())
+	if (index >= m_count)
 	{
 		throw std::out_of_range("index must be less than expressions count");
 	}
 	return *m_params[index];
 }
 
-void PrintAST::AddExpression(std::unique_ptr<IExpressionAST> && expression)
-{
-	m_params.push_back(std::move(expression));
-}
-
 void PrintAST::Accept(IStatementVisitor& visitor)const
 {
 	visitor.Visit(*this);
 }
 
-FunctionCallStatementAST::FunctionCallStatementAST(std::unique_ptr<FunctionCallExprAST> && call)
-	: m_call(std::move(call))
+FunctionCallStatementAST::FunctionCallStatementAST(const FunctionCallExprAST* call)
+	: IStatementAST(StatementKind::CallStatement)
+	, m_call(call)
 {
 }
 
@@ -432,6 +532,22 @@ std::string ToString(BinaryExpressionAST::Operator operation)
 {
 	switch (operation)
 	{
+	case BinaryExpressionAST::Or:
+		return "||";
+	case BinaryExpressionAST::And:
+		return "&&";
+	case BinaryExpressionAST::Equals:
+		return "==";
+	case BinaryExpressionAST::NotEquals:
+		return "!=";
+	case BinaryExpressionAST::Less:
+		return "<";
+	case BinaryExpressionAST::LessOrEquals:
+		return "<=";
+	case BinaryExpressionAST::Greater:
+		return ">";
+	case BinaryExpressionAST::GreaterOrEquals:
+		return ">=";
 	case BinaryExpressionAST::Plus:
 		return "+";
 	case BinaryExpressionAST::Minus:
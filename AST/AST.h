@@ -1,22 +1,69 @@
 #pragma once
 
-#include <memory>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
-#include <boost/variant.hpp>
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "Visitor.h"
 #include "ExpressionType.h"
+#include "StringInterner.h"
 
+// Which class a node is, for passes that switch on it rather than call
+// Accept; see SwitchVisitor.h.
+enum class ExpressionKind : uint8_t
+{
+	Binary,
+	Literal,
+	Unary,
+	Identifier,
+	Call,
+	ArrayAccess
+};
+
+enum class StatementKind : uint8_t
+{
+	Declaration,
+	Assign,
+	ArrayAssign,
+	Return,
+	If,
+	While,
+	Composite,
+	Print,
+	CallStatement
+};
+
+// Nodes are built in an ASTContext, which frees them all at once; they are
+// never deleted one at a time, so the destructors need not be virtual.
 class IExpressionAST
 {
 public:
-	using Ptr = std::unique_ptr<IExpressionAST>;
-	virtual ~IExpressionAST() = default;
 	virtual void Accept(IExpressionVisitor& visitor)const = 0;
+
+	ExpressionKind GetKind()const;
+
+	// The type of the value. Literals have it from the start; the rest get
+	// it from TypeChecker, which may set it on a const tree because it
+	// follows from the tree.
+	bool HasType()const;
+	ExpressionType GetType()const;
+	void SetType(ExpressionType type)const;
+
+protected:
+	explicit IExpressionAST(ExpressionKind kind);
+	IExpressionAST(ExpressionKind kind, ExpressionType type);
+	~IExpressionAST() = default;
+
+private:
+	static const uint8_t kNoType = 0xff;
+
+	ExpressionKind m_kind;
+	mutable uint8_t m_type;	// an ExpressionType, or kNoType
 };
 
 class BinaryExpressionAST : public IExpressionAST
@@ -27,7 +74,11 @@ public:
 		Or,
 		And,
 		Equals,
+		NotEquals,
 		Less,
+		LessOrEquals,
+		Greater,
+		GreaterOrEquals,
 		Plus,
 		Minus,
 		Mul,
@@ -35,10 +86,7 @@ public:
 		Mod
 	};
 
-	explicit BinaryExpressionAST(
-		std::unique_ptr<IExpressionAST> && left,
-		std::unique_ptr<IExpressionAST> && right,
-		Operator op);
+	explicit BinaryExpressionAST(const IExpressionAST* left, const IExpressionAST* right, Operator op);
 
 	const IExpressionAST& GetLeft()const;
 	const IExpressionAST& GetRight()const;
@@ -47,23 +95,36 @@ public:
 	void Accept(IExpressionVisitor& visitor)const override;
 
 private:
-	std::unique_ptr<IExpressionAST> m_left;
-	std::unique_ptr<IExpressionAST> m_right;
 	Operator m_op;
+	const IExpressionAST* m_left;
+	const IExpressionAST* m_right;
 };
 
 class LiteralConstantAST : public IExpressionAST
 {
 public:
-	// TODO: add bool, string literal
-	using Value = boost::variant<int, double, bool, std::string>;
+	explicit LiteralConstantAST(int value);
+	explicit LiteralConstantAST(double value);
+	explicit LiteralConstantAST(bool value);
+	// Strings are interned, like names, so literals need no destructor.
+	explicit LiteralConstantAST(const std::string& value);
+
+	// GetType() tells which of the getters below holds the value.
+	int GetInt()const;
+	double GetFloat()const;
+	bool GetBool()const;
+	std::string GetString()const;
 
-	explicit LiteralConstantAST(const Value& value);
-	const Value& GetValue()const;
 	void Accept(IExpressionVisitor& visitor)const override;
 
 private:
-	Value m_value;
+	union
+	{
+		int m_int;
+		double m_float;
+		bool m_bool;
+		SymbolId m_string;
+	};
 };
 
 class UnaryAST : public IExpressionAST
@@ -76,7 +137,7 @@ public:
 		Negation
 	};
 
-	explicit UnaryAST(std::unique_ptr<IExpressionAST> && expr, Operator op);
+	explicit UnaryAST(const IExpressionAST* expr, Operator op);
 
 	const IExpressionAST& GetExpr()const;
 	Operator GetOperator()const;
@@ -84,70 +145,83 @@ public:
 	void Accept(IExpressionVisitor& visitor)const override;
 
 private:
-	std::unique_ptr<IExpressionAST> m_expr;
 	Operator m_op;
+	const IExpressionAST* m_expr;
 };
 
+// Names are interned in StringInterner::Global(); compare them by symbol.
 class IdentifierAST : public IExpressionAST
 {
 public:
 	explicit IdentifierAST(const std::string& name);
-	const std::string& GetName()const;
+	explicit IdentifierAST(SymbolId symbol);
+
+	std::string GetName()const;
+	SymbolId GetSymbol()const;
 
 	void Accept(IExpressionVisitor& visitor)const override;
 
 private:
-	std::string m_name;
+	SymbolId m_symbol;
 };
 
+// The params array belongs to the same ASTContext as the node.
 class FunctionCallExprAST : public IExpressionAST
 {
 public:
-	explicit FunctionCallExprAST(
-		const std::string& name,
-		std::vector<std::unique_ptr<IExpressionAST>> && params
-	);
+	explicit FunctionCallExprAST(SymbolId name, const IExpressionAST* const* params, size_t count);
 
-	const std::string& GetName()const;
+	std::string GetName()const;
+	SymbolId GetSymbol()const;
 	size_t GetParamsCount()const;
 	const IExpressionAST& GetParam(size_t index)const;
 
 	void Accept(IExpressionVisitor& visitor)const override;
 
 private:
-	std::string m_name;
-	std::vector<std::unique_ptr<IExpressionAST>> m_params;
+	SymbolId m_name;
+	const IExpressionAST* const* m_params;
+	size_t m_count;
 };
 
 class ArrayElementAccessAST : public IExpressionAST
 {
 public:
-	explicit ArrayElementAccessAST(const std::string& name, std::unique_ptr<IExpressionAST> && index);
+	explicit ArrayElementAccessAST(const std::string& name, const IExpressionAST* index);
+	explicit ArrayElementAccessAST(SymbolId symbol, const IExpressionAST* index);
 
-	const std::string& GetName()const;
+	std::string GetName()const;
+	SymbolId GetSymbol()const;
 	const IExpressionAST& GetIndex()const;
 
 	void Accept(IExpressionVisitor & visitor)const override;
 
 private:
-	std::string m_name;
-	std::unique_ptr<IExpressionAST> m_index;
+	SymbolId m_symbol;
+	const IExpressionAST* m_index;
 };
 
 class IStatementAST
 {
 public:
-	using Ptr = std::unique_ptr<IStatementAST>;
-	virtual ~IStatementAST() = default;
 	virtual void Accept(IStatementVisitor& visitor)const = 0;
+
+	StatementKind GetKind()const;
+
+protected:
+	explicit IStatementAST(StatementKind kind);
+	~IStatementAST() = default;
+
+private:
+	StatementKind m_kind;
 };
 
 class VariableDeclarationAST : public IStatementAST
 {
 public:
-	explicit VariableDeclarationAST(std::unique_ptr<IdentifierAST> && identifier, ExpressionType type);
+	explicit VariableDeclarationAST(const IdentifierAST* identifier, ExpressionType type);
 
-	void SetExpression(std::unique_ptr<IExpressionAST> && expr);
+	void SetExpression(const IExpressionAST* expr);
 	const IExpressionAST* GetExpression()const;
 
 	const IdentifierAST& GetIdentifier()const;
@@ -156,17 +230,15 @@ public:
 	void Accept(IStatementVisitor& visitor)const override;
 
 private:
-	std::unique_ptr<IdentifierAST> m_identifier;
 	ExpressionType m_type;
-	std::unique_ptr<IExpressionAST> m_expr; // can be nullptr
+	const IdentifierAST* m_identifier;
+	const IExpressionAST* m_expr; // can be nullptr
 };
 
 class AssignStatementAST : public IStatementAST
 {
 public:
-	explicit AssignStatementAST(
-		std::unique_ptr<IdentifierAST> && identifier,
-		std::unique_ptr<IExpressionAST> && expr);
+	explicit AssignStatementAST(const IdentifierAST* identifier, const IExpressionAST* expr);
 
 	const IdentifierAST& GetIdentifier()const;
 	const IExpressionAST& GetExpr()const;
@@ -174,8 +246,8 @@ public:
 	void Accept(IStatementVisitor& visitor)const override;
 
 private:
-	std::unique_ptr<IdentifierAST> m_identifier;
-	std::unique_ptr<IExpressionAST> m_expr;
+	const IdentifierAST* m_identifier;
+	const IExpressionAST* m_expr;
 };
 
 class ArrayElementAssignAST : public IStatementAST
@@ -183,43 +255,49 @@ class ArrayElementAssignAST : public IStatementAST
 public:
 	explicit ArrayElementAssignAST(
 		const std::string& arrayId,
-		std::unique_ptr<IExpressionAST>&& index,
-		std::unique_ptr<IExpressionAST>&& expression
+		const IExpressionAST* index,
+		const IExpressionAST* expression
+	);
+	explicit ArrayElementAssignAST(
+		SymbolId arrayId,
+		const IExpressionAST* index,
+		const IExpressionAST* expression
 	);
 
-	const std::string& GetName()const;
+	std::string GetName()const;
+	SymbolId GetSymbol()const;
 	const IExpressionAST& GetIndex()const;
 	const IExpressionAST& GetExpression()const;
 
 	void Accept(IStatementVisitor& visitor)const override;
 
 private:
-	std::string m_arrayId;
-	std::unique_ptr<IExpressionAST> m_index;
-	std::unique_ptr<IExpressionAST> m_expression;
+	SymbolId m_arrayId;
+	const IExpressionAST* m_index;
+	const IExpressionAST* m_expression;
 };
 
 class ReturnStatementAST : public IStatementAST
 {
 public:
-	explicit ReturnStatementAST(std::unique_ptr<IExpressionAST> && expression);
+	explicit ReturnStatementAST(const IExpressionAST* expression);
 
 	const IExpressionAST* GetExpression()const;
 	void Accept(IStatementVisitor& visitor)const override;
 
 private:
-	std::unique_ptr<IExpressionAST> m_expression;
+	const IExpressionAST* m_expression;
 };
 
 class IfStatementAST : public IStatementAST
 {
 public:
 	explicit IfStatementAST(
-		std::unique_ptr<IExpressionAST> && expr,
-		std::unique_ptr<IStatementAST> && then,
-		std::unique_ptr<IStatementAST> && elif = nullptr);
+		const IExpressionAST* expr,
+		const IStatementAST* then,
+		const IStatementAST* elif = nullptr);
 
-	void SetElseClause(std::unique_ptr<IStatementAST> && elif);
+	void SetElseClause(const IStatementAST* elif);
 	const IExpressionAST& GetExpr()const;
 	const IStatementAST& GetThenStmt()const;
 	const IStatementAST* GetElseStmt()const;
@@ -227,17 +305,15 @@ public:
 	void Accept(IStatementVisitor& visitor)const override;
 
 private:
-	std::unique_ptr<IExpressionAST> m_expr;
-	std::unique_ptr<IStatementAST> m_then;
-	std::unique_ptr<IStatementAST> m_elif;
+	const IExpressionAST* m_expr;
+	const IStatementAST* m_then;
+	const IStatementAST* m_elif;
 };
 
 class WhileStatementAST : public IStatementAST
 {
 public:
-	explicit WhileStatementAST(
-		std::unique_ptr<IExpressionAST> && expr,
-		std::unique_ptr<IStatementAST> && stmt);
+	explicit WhileStatementAST(const IExpressionAST* expr, const IStatementAST* stmt);
 
 	const IExpressionAST& GetExpr()const;
 	const IStatementAST& GetStatement()const;
@@ -245,60 +321,65 @@ public:
 	void Accept(IStatementVisitor& visitor)const override;
 
 private:
-	std::unique_ptr<IExpressionAST> m_expr;
-	std::unique_ptr<IStatementAST> m_stmt;
+	const IExpressionAST* m_expr;
+	const IStatementAST* m_stmt;
 };
 
+// The statements array belongs to the same ASTContext as the node.
 class CompositeStatementAST : public IStatementAST
 {
 public:
-	void AddStatement(std::unique_ptr<IStatementAST> && stmt);
+	explicit CompositeStatementAST(const IStatementAST* const* statements, size_t count);
+
 	const IStatementAST& GetStatement(size_t index)const;
 	size_t GetCount()const;
 
 	void Accept(IStatementVisitor& visitor)const override;
 
 private:
-	std::vector<std::unique_ptr<IStatementAST>> m_statements;
+	const IStatementAST* const* m_statements;
+	size_t m_count;
 };
 
 class PrintAST : public IStatementAST
 {
 public:
+	explicit PrintAST(const IExpressionAST* const* params, size_t count);
+
 	size_t GetParamsCount()const;
 	const IExpressionAST& GetExpression(size_t index)const;
-	void AddExpression(std::unique_ptr<IExpressionAST> && expression);
 
 	void Accept(IStatementVisitor& visitor)const override;
 
 private:
-	std::vector<std::unique_ptr<IExpressionAST>> m_params;
+	const IExpressionAST* const* m_params;
+	size_t m_count;
 };
 
 // Function call statement with ignoring returning value of a function
 class FunctionCallStatementAST : public IStatementAST
 {
 public:
-	explicit FunctionCallStatementAST(std::unique_ptr<FunctionCallExprAST> && call);
+	explicit FunctionCallStatementAST(const FunctionCallExprAST* call);
 	const IExpressionAST& GetCall()const;
 	const FunctionCallExprAST& GetCallAsDerived()const;
 
 	void Accept(IStatementVisitor& visitor)const override;
 
 private:
-	std::unique_ptr<FunctionCallExprAST> m_call;
+	const FunctionCallExprAST* m_call;
 };
 
 class FunctionAST
 {
 public:
-	using Param = std::pair<std::string, ExpressionType>;
+	using Param = std::pair<SymbolId, ExpressionType>;
 
 	explicit FunctionAST(
 		boost::optional<ExpressionType> returnType,
-		std::unique_ptr<IdentifierAST> && identifier,
+		const IdentifierAST* identifier,
 		std::vector<Param> && params,
-		std::unique_ptr<IStatementAST> && statement
+		const IStatementAST* statement
 	);
 
 	boost::optional<ExpressionType> GetReturnType()const;
@@ -309,21 +390,68 @@ public:
 private:
 	boost::optional<ExpressionType> m_returnType;
 	std::vector<Param> m_params;
-	std::unique_ptr<IdentifierAST> m_identifier;
-	std::unique_ptr<IStatementAST> m_statement;
+	const IdentifierAST* m_identifier;
+	const IStatementAST* m_statement;
 };
 
 class ProgramAST
 {
 public:
-	void AddFunction(std::unique_ptr<FunctionAST> && function);
+	void AddFunction(const FunctionAST* function);
+
+	// Replaces removed functions from index on with count new ones; the
+	// rest stay where they are, so an edited program keeps their nodes.
+	void ReplaceFunctions(size_t index, size_t removed, const FunctionAST* const* functions, size_t count);
 
 	size_t GetFunctionsCount()const;
 	const FunctionAST& GetFunction(size_t index)const;
 
 private:
-	std::vector<std::unique_ptr<FunctionAST>> m_functions;
+	std::vector<const FunctionAST*> m_functions;
 };
 
 std::string ToString(BinaryExpressionAST::Operator operation);
 std::string ToString(UnaryAST::Operator operation);
+
+inline IExpressionAST::IExpressionAST(ExpressionKind kind)
+	: m_kind(kind)
+	, m_type(kNoType)
+{
+}
+
+inline IExpressionAST::IExpressionAST(ExpressionKind kind, ExpressionType type)
+	: m_kind(kind)
+	, m_type(uint8_t(type))
+{
+}
+
+inline ExpressionKind IExpressionAST::GetKind()const
+{
+	return m_kind;
+}
+
+inline bool IExpressionAST::HasType()const
+{
+	return m_type != kNoType;
+}
+
+inline ExpressionType IExpressionAST::GetType()const
+{
+	assert(HasType());
+	return ExpressionType(m_type);
+}
+
+inline void IExpressionAST::SetType(ExpressionType type)const
+{
+	m_type = uint8_t(type);
+}
+
+inline IStatementAST::IStatementAST(StatementKind kind)
+	: m_kind(kind)
+{
+}
+
+inline StatementKind IStatementAST::GetKind()const
+{
+	return m_kind;
+}
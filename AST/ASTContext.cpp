@@ -0,0 +1,29 @@
+#include "ASTContext.h"
+
+ASTContext::~ASTContext()
+{
+	for (auto it = m_cleanups.rbegin(); it != m_cleanups.rend(); ++it)
+	{
+		it->destroy(it->node);
+	}
+}
+
+void ASTContext::Absorb(ASTContext& other)
+{
+	m_arena.Absorb(other.m_arena);
+	m_nodeCount += other.m_nodeCount;
+	m_cleanups.insert(m_cleanups.end(), other.m_cleanups.begin(), other.m_cleanups.end());
+
+	other.m_nodeCount = 0;
+	other.m_cleanups.clear();
+}
+
+size_t ASTContext::GetNodeCount()const
+{
+	return m_nodeCount;
+}
+
+size_t ASTContext::GetBytesUsed()const
+{
+	return m_arena.GetBytesUsed();
+}
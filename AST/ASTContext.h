@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Arena.h"
+
+// Owns the nodes of one syntax tree. Nodes are constructed in place in a
+// bump arena and the whole tree is freed at once with the context, without
+// visiting a node. The few node types that still hold a std::vector have
+// their destructors run then; the common ones have none.
+class ASTContext
+{
+public:
+	ASTContext() = default;
+	~ASTContext();
+
+	ASTContext(const ASTContext&) = delete;
+	ASTContext& operator=(const ASTContext&) = delete;
+
+	template <typename T, typename... Args>
+	T* Create(Args&&... args);
+
+	// Copies a run of child pointers into the arena, for nodes with a
+	// variable number of children.
+	template <typename T>
+	const T* const* CreateList(const T* const* items, size_t count);
+
+	// Takes over the nodes of a tree built in another context, such as one
+	// parsed on another thread; other is left empty.
+	void Absorb(ASTContext& other);
+
+	size_t GetNodeCount()const;
+	size_t GetBytesUsed()const;
+
+private:
+	struct Cleanup
+	{
+		void (*destroy)(void*);
+		void* node;
+	};
+
+	template <typename T>
+	static void Destroy(void* node);
+
+	Arena m_arena;
+	size_t m_nodeCount = 0;
+	std::vector<Cleanup> m_cleanups;
+};
+
+template <typename T, typename... Args>
+inline T* ASTContext::Create(Args&&... args)
+{
+	T* node = new (m_arena.Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	++m_nodeCount;
+	if (!std::is_trivially_destructible<T>::value)
+	{
+		m_cleanups.push_back(Cleanup{ &Destroy<T>, node });
+	}
+	return node;
+}
+
+template <typename T>
+inline const T* const* ASTContext::CreateList(const T* const* items, size_t count)
+{
+	auto** list = m_arena.AllocateArray<const T*>(count);
+	if (count != 0)
+	{
+		memcpy(list, items, count * sizeof(const T*));
+	}
+	return list;
+}
+
+template <typename T>
+void ASTContext::Destroy(void* node)
+{
+	static_cast<T*>(node)->~T();
+}
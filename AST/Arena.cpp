@@ -0,0 +1,80 @@
+#include "Arena.h"
+#include <cstdlib>
+#include <new>
+
+Arena::Arena(size_t chunkSize)
+	: m_chunkSize(chunkSize)
+	, m_current(nullptr)
+	, m_end(nullptr)
+	, m_used(0)
+	, m_reserved(0)
+{
+}
+
+Arena::~Arena()
+{
+	Reset();
+}
+
+void* Arena::AllocateSlow(size_t size, size_t align)
+{
+	// Oversized requests get a chunk of their own so the rest of the current
+	// chunk is not wasted.
+	const size_t needed = size + align;
+	const size_t chunkSize = needed > m_chunkSize / 4 ? needed : m_chunkSize;
+
+	char* chunk = static_cast<char*>(malloc(chunkSize));
+	if (!chunk)
+	{
+		throw std::bad_alloc();
+	}
+	m_chunks.push_back(chunk);
+	m_reserved += chunkSize;
+
+	const size_t misalign = reinterpret_cast<size_t>(chunk) & (align - 1);
+	char* result = chunk + (misalign ? align - misalign : 0);
+
+	if (chunkSize == m_chunkSize)
+	{
+		m_current = result + size;
+		m_end = chunk + chunkSize;
+	}
+	m_used += size;
+	return result;
+}
+
+void Arena::Reset()
+{
+	for (char* chunk : m_chunks)
+	{
+		free(chunk);
+	}
+	m_chunks.clear();
+	m_current = nullptr;
+	m_end = nullptr;
+	m_used = 0;
+	m_reserved = 0;
+}
+
+void Arena::Absorb(Arena& other)
+{
+	m_chunks.insert(m_chunks.end(), other.m_chunks.begin(), other.m_chunks.end());
+	m_used += other.m_used;
+	m_reserved += other.m_reserved;
+
+	other.m_chunks.clear();
+	other.m_current = nullptr;
+	other.m_end = nullptr;
+	other.m_used = 0;
+	other.m_reserved = 0;
+}
+
+size_t Arena::GetBytesUsed()const
+{
+	return m_used;
+}
+
+size_t Arena::GetBytesReserved()const
+{
+	return m_reserved;
+}
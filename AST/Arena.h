@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Bump allocator. Memory comes from large chunks and is only given back all
+// at once, when the arena is reset or destroyed; nothing allocated here has
+// its destructor run.
+class Arena
+{
+public:
+	explicit Arena(size_t chunkSize = 64 * 1024);
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	void* Allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	// Frees every chunk at once.
+	void Reset();
+
+	// Takes over the chunks of other, which is left empty; what was
+	// allocated there now lives as long as this arena.
+	void Absorb(Arena& other);
+
+	// Bytes handed out so far, and bytes reserved from the system.
+	size_t GetBytesUsed()const;
+	size_t GetBytesReserved()const;
+
+private:
+	void* AllocateSlow(size_t size, size_t align);
+
+	size_t m_chunkSize;
+	char* m_current;
+	char* m_end;
+	size_t m_used;
+	size_t m_reserved;
+	std::vector<char*> m_chunks;
+};
+
+inline void* Arena::Allocate(size_t size, size_t align)
+{
+	const size_t misalign = reinterpret_cast<size_t>(m_current) & (align - 1);
+	const size_t padding = misalign ? align - misalign : 0;
+
+	if (m_current && size + padding <= size_t(m_end - m_current))
+	{
+		char* result = m_current + padding;
+		m_current = result + size;
+		m_used += size;
+		return result;
+	}
+	return AllocateSlow(size, align);
+}
@@ -0,0 +1,591 @@
+#include "ConstantFolder.h"
+#include "StackGuard.h"
+#include "SwitchVisitor.h"
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace
+{
+// The conversions below are the ones codegen emits: zext for bool to int,
+// uitofp for int and bool to float, and a compare with zero for bool. Each
+// returns false where codegen would throw.
+bool ToBool(const LiteralConstantAST& literal, bool& value)
+{
+	switch (literal.GetType())
+	{
+	case ExpressionType::Int:
+		value = literal.GetInt() != 0;
+		return true;
+	case ExpressionType::Float:
+		// fcmp oeq is false for NaN, so NaN is true.
+		value = !(literal.GetFloat() == 0.0);
+		return true;
+	case ExpressionType::Bool:
+		value = literal.GetBool();
+		return true;
+	case ExpressionType::String:
+		return false;
+	}
+	return false;
+}
+
+bool ToInt(const LiteralConstantAST& literal, int& value)
+{
+	switch (literal.GetType())
+	{
+	case ExpressionType::Int:
+		value = literal.GetInt();
+		return true;
+	case ExpressionType::Bool:
+		value = literal.GetBool() ? 1 : 0;
+		return true;
+	case ExpressionType::Float:
+	case ExpressionType::String:
+		// No binary operator converts a float to int.
+		return false;
+	}
+	return false;
+}
+
+bool ToFloat(const LiteralConstantAST& literal, double& value)
+{
+	switch (literal.GetType())
+	{
+	case ExpressionType::Int:
+		value = double(uint32_t(literal.GetInt()));
+		return true;
+	case ExpressionType::Float:
+		value = literal.GetFloat();
+		return true;
+	case ExpressionType::Bool:
+		value = literal.GetBool() ? 1.0 : 0.0;
+		return true;
+	case ExpressionType::String:
+		return false;
+	}
+	return false;
+}
+
+// Wraps around as i32 arithmetic does.
+int Wrap(uint32_t value)
+{
+	return int32_t(value);
+}
+}
+
+class ConstantFolder::Pass
+	: public ExpressionSwitch<Pass, const IExpressionAST*>
+	, public StatementSwitch<Pass, const IStatementAST*>
+{
+public:
+	Pass(ASTContext& context, Stats& stats)
+		: m_context(context)
+		, m_stats(stats)
+	{
+	}
+
+	const IExpressionAST* Fold(const IExpressionAST& node)
+	{
+		if (StackGuard::IsNearEnd())
+		{
+			const IExpressionAST* folded = nullptr;
+			StackGuard::Grow([&] { folded = Fold(node); });
+			return folded;
+		}
+		return ExpressionSwitch<Pass, const IExpressionAST*>::Dispatch(node);
+	}
+
+	// Null if nothing is left of the statement.
+	const IStatementAST* Fold(const IStatementAST& node)
+	{
+		if (StackGuard::IsNearEnd())
+		{
+			const IStatementAST* folded = nullptr;
+			StackGuard::Grow([&] { folded = Fold(node); });
+			return folded;
+		}
+		return StatementSwitch<Pass, const IStatementAST*>::Dispatch(node);
+	}
+
+	// For the places that need a statement even if nothing is left.
+	const IStatementAST& FoldBody(const IStatementAST& node)
+	{
+		const IStatementAST* folded = Fold(node);
+		return folded ? *folded : *m_context.Create<CompositeStatementAST>(nullptr, 0);
+	}
+
+	const IExpressionAST* Visit(const BinaryExpressionAST& node)
+	{
+		const IExpressionAST& left = *Fold(node.GetLeft());
+		const IExpressionAST& right = *Fold(node.GetRight());
+		if (left.GetKind() == ExpressionKind::Literal && right.GetKind() == ExpressionKind::Literal)
+		{
+			if (const IExpressionAST* value = Evaluate(static_cast<const LiteralConstantAST&>(left),
+				static_cast<const LiteralConstantAST&>(right), node.GetOperator()))
+			{
+				++m_stats.folded;
+				return value;
+			}
+		}
+		if (&left == &node.GetLeft() && &right == &node.GetRight())
+		{
+			return &node;
+		}
+		return Rebuild<BinaryExpressionAST>(node, &left, &right, node.GetOperator());
+	}
+
+	const IExpressionAST* Visit(const LiteralConstantAST& node)
+	{
+		return &node;
+	}
+
+	const IExpressionAST* Visit(const UnaryAST& node)
+	{
+		const IExpressionAST& expr = *Fold(node.GetExpr());
+		if (expr.GetKind() == ExpressionKind::Literal)
+		{
+			if (const IExpressionAST* value = Evaluate(static_cast<const LiteralConstantAST&>(expr), node.GetOperator()))
+			{
+				++m_stats.folded;
+				return value;
+			}
+		}
+		if (&expr == &node.GetExpr())
+		{
+			return &node;
+		}
+		return Rebuild<UnaryAST>(node, &expr, node.GetOperator());
+	}
+
+	const IExpressionAST* Visit(const IdentifierAST& node)
+	{
+		return &node;
+	}
+
+	const IExpressionAST* Visit(const FunctionCallExprAST& node)
+	{
+		return FoldCall(node);
+	}
+
+	const IExpressionAST* Visit(const ArrayElementAccessAST& node)
+	{
+		const IExpressionAST* index = Fold(node.GetIndex());
+		if (index == &node.GetIndex())
+		{
+			return &node;
+		}
+		return Rebuild<ArrayElementAccessAST>(node, node.GetSymbol(), index);
+	}
+
+	const IStatementAST* Visit(const VariableDeclarationAST& node)
+	{
+		const IExpressionAST* expression = node.GetExpression();
+		if (!expression || (expression = Fold(*expression)) == node.GetExpression())
+		{
+			return &node;
+		}
+		VariableDeclarationAST* declaration = m_context.Create<VariableDeclarationAST>(&node.GetIdentifier(), node.GetType());
+		declaration->SetExpression(expression);
+		return declaration;
+	}
+
+	const IStatementAST* Visit(const AssignStatementAST& node)
+	{
+		const IExpressionAST* expr = Fold(node.GetExpr());
+		if (expr == &node.GetExpr())
+		{
+			return &node;
+		}
+		return m_context.Create<AssignStatementAST>(&node.GetIdentifier(), expr);
+	}
+
+	const IStatementAST* Visit(const ArrayElementAssignAST& node)
+	{
+		const IExpressionAST* index = Fold(node.GetIndex());
+		const IExpressionAST* expression = Fold(node.GetExpression());
+		if (index == &node.GetIndex() && expression == &node.GetExpression())
+		{
+			return &node;
+		}
+		return m_context.Create<ArrayElementAssignAST>(node.GetSymbol(), index, expression);
+	}
+
+	const IStatementAST* Visit(const ReturnStatementAST& node)
+	{
+		const IExpressionAST* expression = node.GetExpression();
+		if (!expression || (expression = Fold(*expression)) == node.GetExpression())
+		{
+			return &node;
+		}
+		return m_context.Create<ReturnStatementAST>(expression);
+	}
+
+	const IStatementAST* Visit(const IfStatementAST& node)
+	{
+		const IExpressionAST* expr = Fold(node.GetExpr());
+		bool condition;
+		if (IsConstant(*expr, condition))
+		{
+			++m_stats.pruned;
+			if (condition)
+			{
+				return Fold(node.GetThenStmt());
+			}
+			return node.GetElseStmt() ? Fold(*node.GetElseStmt()) : nullptr;
+		}
+
+		const IStatementAST* then = &FoldBody(node.GetThenStmt());
+		const IStatementAST* elif = node.GetElseStmt() ? &FoldBody(*node.GetElseStmt()) : nullptr;
+		if (expr == &node.GetExpr() && then == &node.GetThenStmt() && elif == node.GetElseStmt())
+		{
+			return &node;
+		}
+		return m_context.Create<IfStatementAST>(expr, then, elif);
+	}
+
+	const IStatementAST* Visit(const WhileStatementAST& node)
+	{
+		// A loop whose condition is true stays: only its exit would go.
+		const IExpressionAST* expr = Fold(node.GetExpr());
+		bool condition;
+		if (IsConstant(*expr, condition) && !condition)
+		{
+			++m_stats.pruned;
+			return nullptr;
+		}
+
+		const IStatementAST* stmt = &FoldBody(node.GetStatement());
+		if (expr == &node.GetExpr() && stmt == &node.GetStatement())
+		{
+			return &node;
+		}
+		return m_context.Create<WhileStatementAST>(expr, stmt);
+	}
+
+	const IStatementAST* Visit(const CompositeStatementAST& node)
+	{
+		std::vector<const IStatementAST*> statements;
+		statements.reserve(node.GetCount());
+		bool changed = false;
+		for (size_t i = 0; i < node.GetCount(); ++i)
+		{
+			const IStatementAST* statement = Fold(node.GetStatement(i));
+			changed |= statement != &node.GetStatement(i);
+			if (statement)
+			{
+				statements.push_back(statement);
+			}
+		}
+		if (!changed)
+		{
+			return &node;
+		}
+		return m_context.Create<CompositeStatementAST>(
+			m_context.CreateList(statements.data(), statements.size()), statements.size());
+	}
+
+	const IStatementAST* Visit(const PrintAST& node)
+	{
+		std::vector<const IExpressionAST*> params(node.GetParamsCount());
+		bool changed = false;
+		for (size_t i = 0; i < params.size(); ++i)
+		{
+			params[i] = Fold(node.GetExpression(i));
+			changed |= params[i] != &node.GetExpression(i);
+		}
+		if (!changed)
+		{
+			return &node;
+		}
+		return m_context.Create<PrintAST>(m_context.CreateList(params.data(), params.size()), params.size());
+	}
+
+	const IStatementAST* Visit(const FunctionCallStatementAST& node)
+	{
+		const FunctionCallExprAST* call = FoldCall(node.GetCallAsDerived());
+		if (call == &node.GetCallAsDerived())
+		{
+			return &node;
+		}
+		return m_context.Create<FunctionCallStatementAST>(call);
+	}
+
+private:
+	const FunctionCallExprAST* FoldCall(const FunctionCallExprAST& node)
+	{
+		std::vector<const IExpressionAST*> params(node.GetParamsCount());
+		bool changed = false;
+		for (size_t i = 0; i < params.size(); ++i)
+		{
+			params[i] = Fold(node.GetParam(i));
+			changed |= params[i] != &node.GetParam(i);
+		}
+		if (!changed)
+		{
+			return &node;
+		}
+		return Rebuild<FunctionCallExprAST>(node,
+			node.GetSymbol(), m_context.CreateList(params.data(), params.size()), params.size());
+	}
+
+	// Built in place of node, keeping the type the type checker gave it, so
+	// codegen can read the types of a checked tree after it is folded.
+	template <typename T, typename... Args>
+	const T* Rebuild(const IExpressionAST& node, Args&&... args)
+	{
+		const T* rebuilt = m_context.Create<T>(std::forward<Args>(args)...);
+		if (node.HasType())
+		{
+			rebuilt->SetType(node.GetType());
+		}
+		return rebuilt;
+	}
+
+	static bool IsConstant(const IExpressionAST& expr, bool& condition)
+	{
+		return expr.GetKind() == ExpressionKind::Literal
+			&& ToBool(static_cast<const LiteralConstantAST&>(expr), condition);
+	}
+
+	// Null if the operator is left for codegen.
+	const IExpressionAST* Evaluate(const LiteralConstantAST& left, const LiteralConstantAST& right,
+		BinaryExpressionAST::Operator op)
+	{
+		const auto type = GetPreferredType(left.GetType(), right.GetType());
+		if (!type)
+		{
+			return nullptr;
+		}
+
+		if (op == BinaryExpressionAST::Or || op == BinaryExpressionAST::And)
+		{
+			bool l;
+			bool r;
+			if (*type == ExpressionType::String || !ToBool(left, l) || !ToBool(right, r))
+			{
+				return nullptr;
+			}
+			return Literal(op == BinaryExpressionAST::Or ? l || r : l && r);
+		}
+
+		switch (*type)
+		{
+		case ExpressionType::Int:
+		{
+			int l;
+			int r;
+			if (!ToInt(left, l) || !ToInt(right, r))
+			{
+				return nullptr;
+			}
+			return EvaluateInt(l, r, op);
+		}
+		case ExpressionType::Float:
+		{
+			double l;
+			double r;
+			if (!ToFloat(left, l) || !ToFloat(right, r))
+			{
+				return nullptr;
+			}
+			return EvaluateFloat(l, r, op);
+		}
+		case ExpressionType::Bool:
+			return EvaluateBool(left.GetBool(), right.GetBool(), op);
+		case ExpressionType::String:
+			return nullptr;
+		}
+		return nullptr;
+	}
+
+	const IExpressionAST* EvaluateInt(int l, int r, BinaryExpressionAST::Operator op)
+	{
+		switch (op)
+		{
+		case BinaryExpressionAST::Equals:
+			return Literal(l == r);
+		case BinaryExpressionAST::NotEquals:
+			return Literal(l != r);
+		case BinaryExpressionAST::Less:
+			return Literal(l < r);
+		case BinaryExpressionAST::LessOrEquals:
+			return Literal(l <= r);
+		case BinaryExpressionAST::Greater:
+			return Literal(l > r);
+		case BinaryExpressionAST::GreaterOrEquals:
+			return Literal(l >= r);
+		case BinaryExpressionAST::Plus:
+			return Literal(Wrap(uint32_t(l) + uint32_t(r)));
+		case BinaryExpressionAST::Minus:
+			return Literal(Wrap(uint32_t(l) - uint32_t(r)));
+		case BinaryExpressionAST::Mul:
+			return Literal(Wrap(uint32_t(l) * uint32_t(r)));
+		case BinaryExpressionAST::Div:
+		case BinaryExpressionAST::Mod:
+			// sdiv and srem are undefined for these; codegen emits them.
+			if (r == 0 || (l == INT_MIN && r == -1))
+			{
+				return nullptr;
+			}
+			return Literal(op == BinaryExpressionAST::Div ? l / r : l % r);
+		case BinaryExpressionAST::Or:
+		case BinaryExpressionAST::And:
+			break;
+		}
+		return nullptr;
+	}
+
+	const IExpressionAST* EvaluateFloat(double l, double r, BinaryExpressionAST::Operator op)
+	{
+		// Ordered compares, false for NaN, except for fcmp une.
+		switch (op)
+		{
+		case BinaryExpressionAST::Equals:
+			return Literal(l == r);
+		case BinaryExpressionAST::NotEquals:
+			return Literal(!(l == r));
+		case BinaryExpressionAST::Less:
+			return Literal(l < r);
+		case BinaryExpressionAST::LessOrEquals:
+			return Literal(l <= r);
+		case BinaryExpressionAST::Greater:
+			return Literal(l > r);
+		case BinaryExpressionAST::GreaterOrEquals:
+			return Literal(l >= r);
+		case BinaryExpressionAST::Plus:
+			return Real(l + r);
+		case BinaryExpressionAST::Minus:
+			return Real(l - r);
+		case BinaryExpressionAST::Mul:
+			return Real(l * r);
+		case BinaryExpressionAST::Div:
+			return Real(l / r);
+		case BinaryExpressionAST::Mod:
+			return Real(std::fmod(l, r));
+		case BinaryExpressionAST::Or:
+		case BinaryExpressionAST::And:
+			break;
+		}
+		return nullptr;
+	}
+
+	const IExpressionAST* EvaluateBool(bool l, bool r, BinaryExpressionAST::Operator op)
+	{
+		// Booleans are i1, compared signed: true is -1 and less than false.
+		const int sl = l ? -1 : 0;
+		const int sr = r ? -1 : 0;
+		switch (op)
+		{
+		case BinaryExpressionAST::Equals:
+			return Literal(l == r);
+		case BinaryExpressionAST::NotEquals:
+			return Literal(l != r);
+		case BinaryExpressionAST::Less:
+			return Literal(sl < sr);
+		case BinaryExpressionAST::LessOrEquals:
+			return Literal(sl <= sr);
+		case BinaryExpressionAST::Greater:
+			return Literal(sl > sr);
+		case BinaryExpressionAST::GreaterOrEquals:
+			return Literal(sl >= sr);
+		case BinaryExpressionAST::Plus:
+		case BinaryExpressionAST::Minus:
+		case BinaryExpressionAST::Mul:
+		case BinaryExpressionAST::Div:
+		case BinaryExpressionAST::Mod:
+			// Codegen refuses arithmetic on booleans.
+			return nullptr;
+		case BinaryExpressionAST::Or:
+		case BinaryExpressionAST::And:
+			break;
+		}
+		return nullptr;
+	}
+
+	const IExpressionAST* Evaluate(const LiteralConstantAST& value, UnaryAST::Operator op)
+	{
+		switch (op)
+		{
+		case UnaryAST::Plus:
+			return &value;
+		case UnaryAST::Minus:
+			switch (value.GetType())
+			{
+			case ExpressionType::Int:
+				return Literal(Wrap(0u - uint32_t(value.GetInt())));
+			case ExpressionType::Float:
+				return Literal(-value.GetFloat());
+			case ExpressionType::Bool:
+				// Negating an i1 gives it back.
+				return &value;
+			case ExpressionType::String:
+				break;
+			}
+			return nullptr;
+		case UnaryAST::Negation:
+		{
+			bool boolean;
+			return ToBool(value, boolean) ? Literal(!boolean) : nullptr;
+		}
+		}
+		return nullptr;
+	}
+
+	template <typename T>
+	const IExpressionAST* Literal(T value)
+	{
+		return m_context.Create<LiteralConstantAST>(value);
+	}
+
+	// The bits of a NaN depend on what computes it, so one is left for
+	// codegen to emit as before.
+	const IExpressionAST* Real(double value)
+	{
+		return std::isnan(value) ? nullptr : Literal(value);
+	}
+
+	ASTContext& m_context;
+	Stats& m_stats;
+};
+
+ConstantFolder::ConstantFolder(ASTContext& context)
+	: m_context(context)
+{
+}
+
+const IExpressionAST* ConstantFolder::Fold(const IExpressionAST& expression)
+{
+	return Pass(m_context, m_stats).Fold(expression);
+}
+
+const IStatementAST* ConstantFolder::Fold(const IStatementAST& statement)
+{
+	return &Pass(m_context, m_stats).FoldBody(statement);
+}
+
+const FunctionAST* ConstantFolder::Fold(const FunctionAST& function)
+{
+	const IStatementAST* statement = Fold(function.GetStatement());
+	if (statement == &function.GetStatement())
+	{
+		return &function;
+	}
+	std::vector<FunctionAST::Param> params = function.GetParams();
+	return m_context.Create<FunctionAST>(function.GetReturnType(), &function.GetIdentifier(), std::move(params), statement);
+}
+
+void ConstantFolder::Fold(const ProgramAST& program, ProgramAST& folded)
+{
+	for (size_t i = 0; i < program.GetFunctionsCount(); ++i)
+	{
+		folded.AddFunction(Fold(program.GetFunction(i)));
+	}
+}
+
+const ConstantFolder::Stats& ConstantFolder::GetStats()const
+{
+	return m_stats;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+
+#include "AST.h"
+#include "ASTContext.h"
+
+// Evaluates the operators whose operands are literals and drops the
+// branches of if and while statements whose condition is one, so codegen
+// never sees work that is known at compile time. Operands are converted as
+// codegen converts them, GetPreferredType choosing the common type, and the
+// result is the literal codegen would have produced.
+//
+// Codegen runs it on every tree once the type checker has accepted it, so
+// that errors in the branches it drops are still reported; the nodes it
+// builds keep the types the checker gave the nodes they replace.
+//
+// Whatever codegen rejects or leaves undefined, such as arithmetic on
+// booleans or division by zero, is not folded, for codegen to report or emit
+// as before. Nodes that do not change are kept, so a tree with nothing to
+// fold comes back as it is; new nodes are built in context.
+class ConstantFolder
+{
+public:
+	struct Stats
+	{
+		size_t folded = 0;	// operators replaced by their value
+		size_t pruned = 0;	// if and while statements decided by a constant condition
+	};
+
+	explicit ConstantFolder(ASTContext& context);
+
+	ConstantFolder(const ConstantFolder&) = delete;
+	ConstantFolder& operator=(const ConstantFolder&) = delete;
+
+	const IExpressionAST* Fold(const IExpressionAST& expression);
+	const IStatementAST* Fold(const IStatementAST& statement);
+	const FunctionAST* Fold(const FunctionAST& function);
+
+	// Adds the folded functions of program to folded.
+	void Fold(const ProgramAST& program, ProgramAST& folded);
+
+	const Stats& GetStats()const;
+
+private:
+	class Pass;
+
+	ASTContext& m_context;
+	Stats m_stats;
+};
@@ -0,0 +1,280 @@
+#include "ExpressionDAG.h"
+#include "StackGuard.h"
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+namespace
+{
+size_t Mix(size_t hash, uint64_t value)
+{
+	// A multiply-xorshift step; the inputs are small integers and other
+	// hashes, which this spreads over the whole word.
+	hash = (hash ^ value) * 0x9E3779B97F4A7C15ULL;
+	return hash ^ (hash >> 29);
+}
+}
+
+// Rebuilds a tree through the builder, children first.
+class ExpressionDAG::Copier : public IExpressionVisitor
+{
+public:
+	explicit Copier(ExpressionDAG& dag)
+		: m_dag(dag)
+		, m_result(nullptr)
+	{
+	}
+
+	const IExpressionAST* Copy(const IExpressionAST& node)
+	{
+		if (StackGuard::IsNearEnd())
+		{
+			const IExpressionAST* copy = nullptr;
+			StackGuard::Grow([&] { copy = Copy(node); });
+			return copy;
+		}
+		node.Accept(*this);
+		return m_result;
+	}
+
+	void Visit(const BinaryExpressionAST& node) override
+	{
+		const IExpressionAST* left = Copy(node.GetLeft());
+		const IExpressionAST* right = Copy(node.GetRight());
+		m_result = m_dag.Binary(left, right, node.GetOperator());
+	}
+
+	void Visit(const LiteralConstantAST& node) override
+	{
+		switch (node.GetType())
+		{
+		case ExpressionType::Int:
+			m_result = m_dag.Literal(node.GetInt());
+			break;
+		case ExpressionType::Float:
+			m_result = m_dag.Literal(node.GetFloat());
+			break;
+		case ExpressionType::Bool:
+			m_result = m_dag.Literal(node.GetBool());
+			break;
+		case ExpressionType::String:
+			m_result = m_dag.Literal(node.GetString());
+			break;
+		}
+	}
+
+	void Visit(const UnaryAST& node) override
+	{
+		m_result = m_dag.Unary(Copy(node.GetExpr()), node.GetOperator());
+	}
+
+	void Visit(const IdentifierAST& node) override
+	{
+		m_result = node.HasType() ?
+			m_dag.Identifier(node.GetSymbol(), node.GetType()) :
+			m_dag.Identifier(node.GetSymbol());
+	}
+
+	void Visit(const FunctionCallExprAST& node) override
+	{
+		std::vector<const IExpressionAST*> params(node.GetParamsCount());
+		for (size_t i = 0; i < params.size(); ++i)
+		{
+			params[i] = Copy(node.GetParam(i));
+		}
+		m_result = m_dag.Call(node.GetSymbol(), params.data(), params.size());
+	}
+
+	void Visit(const ArrayElementAccessAST& node) override
+	{
+		m_result = m_dag.ArrayAccess(node.GetSymbol(), Copy(node.GetIndex()));
+	}
+
+private:
+	ExpressionDAG& m_dag;
+	const IExpressionAST* m_result;
+};
+
+ExpressionDAG::Stats& ExpressionDAG::Stats::operator+=(const Stats& other)
+{
+	requested += other.requested;
+	built += other.built;
+	reused += other.reused;
+	bytesSaved += other.bytesSaved;
+	return *this;
+}
+
+ExpressionDAG::ExpressionDAG(ASTContext& context)
+	: m_context(context)
+{
+}
+
+const IExpressionAST* ExpressionDAG::Binary(const IExpressionAST* left, const IExpressionAST* right, BinaryExpressionAST::Operator op)
+{
+	Key key;
+	if (!MakeKey(Kind::Binary, uint8_t(op), left, right, 0, key))
+	{
+		return Build<BinaryExpressionAST>(left, right, op);
+	}
+	return Find<BinaryExpressionAST>(key, left, right, op);
+}
+
+const IExpressionAST* ExpressionDAG::Unary(const IExpressionAST* expr, UnaryAST::Operator op)
+{
+	Key key;
+	if (!MakeKey(Kind::Unary, uint8_t(op), expr, nullptr, 0, key))
+	{
+		return Build<UnaryAST>(expr, op);
+	}
+	return Find<UnaryAST>(key, expr, op);
+}
+
+const IExpressionAST* ExpressionDAG::Literal(int value)
+{
+	Key key;
+	MakeKey(Kind::Literal, uint8_t(ExpressionType::Int), nullptr, nullptr, uint64_t(uint32_t(value)), key);
+	return Find<LiteralConstantAST>(key, value);
+}
+
+const IExpressionAST* ExpressionDAG::Literal(double value)
+{
+	// By bits, so that 0.0 and -0.0 stay apart.
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	Key key;
+	MakeKey(Kind::Literal, uint8_t(ExpressionType::Float), nullptr, nullptr, bits, key);
+	return Find<LiteralConstantAST>(key, value);
+}
+
+const IExpressionAST* ExpressionDAG::Literal(bool value)
+{
+	Key key;
+	MakeKey(Kind::Literal, uint8_t(ExpressionType::Bool), nullptr, nullptr, value, key);
+	return Find<LiteralConstantAST>(key, value);
+}
+
+const IExpressionAST* ExpressionDAG::Literal(const std::string& value)
+{
+	Key key;
+	MakeKey(Kind::Literal, uint8_t(ExpressionType::String), nullptr, nullptr,
+		StringInterner::Global().Intern(value), key);
+	return Find<LiteralConstantAST>(key, value);
+}
+
+const IExpressionAST* ExpressionDAG::Identifier(SymbolId symbol)
+{
+	Key key;
+	MakeKey(Kind::Identifier, 0, nullptr, nullptr, symbol, key);
+	return Find<IdentifierAST>(key, symbol);
+}
+
+const IExpressionAST* ExpressionDAG::Identifier(SymbolId symbol, ExpressionType type)
+{
+	Key key;
+	MakeKey(Kind::Identifier, uint8_t(int(type) + 1), nullptr, nullptr, symbol, key);
+	const IExpressionAST* identifier = Find<IdentifierAST>(key, symbol);
+	identifier->SetType(type);
+	return identifier;
+}
+
+const IExpressionAST* ExpressionDAG::ArrayAccess(SymbolId symbol, const IExpressionAST* index)
+{
+	Key key;
+	if (!MakeKey(Kind::ArrayAccess, 0, index, nullptr, symbol, key))
+	{
+		return Build<ArrayElementAccessAST>(symbol, index);
+	}
+	return Find<ArrayElementAccessAST>(key, symbol, index);
+}
+
+const FunctionCallExprAST* ExpressionDAG::Call(SymbolId name, const IExpressionAST* const* params, size_t count)
+{
+	++m_stats.requested;
+	++m_stats.built;
+	return m_context.Create<FunctionCallExprAST>(name, m_context.CreateList(params, count), count);
+}
+
+const IExpressionAST* ExpressionDAG::Share(const IExpressionAST& expression)
+{
+	return Copier(*this).Copy(expression);
+}
+
+bool ExpressionDAG::Contains(const IExpressionAST* node)const
+{
+	return m_hashes.count(node) != 0;
+}
+
+size_t ExpressionDAG::GetHash(const IExpressionAST* node)const
+{
+	auto found = m_hashes.find(node);
+	return found != m_hashes.end() ? found->second : 0;
+}
+
+const ExpressionDAG::Stats& ExpressionDAG::GetStats()const
+{
+	return m_stats;
+}
+
+void ExpressionDAG::AddStats(const Stats& stats)
+{
+	m_stats += stats;
+}
+
+bool ExpressionDAG::Key::operator==(const Key& other)const
+{
+	return kind == other.kind && op == other.op && left == other.left && right == other.right
+		&& payload == other.payload;
+}
+
+bool ExpressionDAG::MakeKey(Kind kind, uint8_t op, const IExpressionAST* left, const IExpressionAST* right,
+	uint64_t payload, Key& key)const
+{
+	key.kind = kind;
+	key.op = op;
+	key.left = left;
+	key.right = right;
+	key.payload = payload;
+	key.hash = Mix(Mix(0, size_t(kind) << 8 | op), payload);
+
+	// Children are hashed by content, not address, so the hashes do not
+	// change from run to run.
+	for (const IExpressionAST* child : { left, right })
+	{
+		if (child)
+		{
+			auto found = m_hashes.find(child);
+			if (found == m_hashes.end())
+			{
+				return false;
+			}
+			key.hash = Mix(key.hash, found->second);
+		}
+	}
+	return true;
+}
+
+template <typename T, typename... Args>
+const IExpressionAST* ExpressionDAG::Find(const Key& key, Args&&... args)
+{
+	auto found = m_nodes.find(key);
+	if (found != m_nodes.end())
+	{
+		++m_stats.requested;
+		++m_stats.reused;
+		m_stats.bytesSaved += sizeof(T);
+		return found->second;
+	}
+
+	const IExpressionAST* node = Build<T>(std::forward<Args>(args)...);
+	m_nodes.emplace(key, node);
+	m_hashes.emplace(node, key.hash);
+	return node;
+}
+
+template <typename T, typename... Args>
+const IExpressionAST* ExpressionDAG::Build(Args&&... args)
+{
+	++m_stats.requested;
+	++m_stats.built;
+	return m_context.Create<T>(std::forward<Args>(args)...);
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "AST.h"
+#include "ASTContext.h"
+
+// Builds expression nodes in an ASTContext and hands back the node built
+// before when an identical one is asked for again, so a subexpression that
+// repeats becomes one node with many parents. Only side-effect-free nodes
+// are shared: calls, and whatever contains one, are always built anew.
+//
+// Children are shared before their parents, so two nodes are identical when
+// their kind, operator, payload and child pointers are; the hash of every
+// shared node is kept for its parents to build on. Identical nodes mean the
+// same text, not the same value: a name may be assigned or redeclared
+// between two uses.
+class ExpressionDAG
+{
+public:
+	struct Stats
+	{
+		size_t requested = 0;	// expression nodes asked for
+		size_t built = 0;		// of them, built anew
+		size_t reused = 0;		// handed back from an earlier request
+		size_t bytesSaved = 0;	// arena bytes the reused nodes would have taken
+
+		Stats& operator+=(const Stats& other);
+	};
+
+	explicit ExpressionDAG(ASTContext& context);
+
+	ExpressionDAG(const ExpressionDAG&) = delete;
+	ExpressionDAG& operator=(const ExpressionDAG&) = delete;
+
+	const IExpressionAST* Binary(const IExpressionAST* left, const IExpressionAST* right, BinaryExpressionAST::Operator op);
+	const IExpressionAST* Unary(const IExpressionAST* expr, UnaryAST::Operator op);
+	const IExpressionAST* Literal(int value);
+	const IExpressionAST* Literal(double value);
+	const IExpressionAST* Literal(bool value);
+	const IExpressionAST* Literal(const std::string& value);
+	const IExpressionAST* Identifier(SymbolId symbol);
+	// A name of a known type, kept apart from the same name declared with
+	// another type elsewhere, so the node can carry the type.
+	const IExpressionAST* Identifier(SymbolId symbol, ExpressionType type);
+	const IExpressionAST* ArrayAccess(SymbolId symbol, const IExpressionAST* index);
+	const FunctionCallExprAST* Call(SymbolId name, const IExpressionAST* const* params, size_t count);
+
+	// Copies a tree built elsewhere into the context, sharing its nodes.
+	const IExpressionAST* Share(const IExpressionAST& expression);
+
+	// True for the shared nodes this builder made.
+	bool Contains(const IExpressionAST* node)const;
+
+	// Structural hash of a shared node; the same in every run.
+	size_t GetHash(const IExpressionAST* node)const;
+
+	const Stats& GetStats()const;
+
+	// Counts what a builder for another context shared, such as one used
+	// on another thread.
+	void AddStats(const Stats& stats);
+
+private:
+	enum class Kind : uint8_t
+	{
+		Binary,
+		Unary,
+		Literal,
+		Identifier,
+		ArrayAccess
+	};
+
+	struct Key
+	{
+		Kind kind;
+		uint8_t op;
+		const IExpressionAST* left;
+		const IExpressionAST* right;
+		uint64_t payload;
+		size_t hash;
+
+		bool operator==(const Key& other)const;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key)const
+		{
+			return key.hash;
+		}
+	};
+
+	class Copier;
+
+	// False if a child is not shared, in which case neither is the node.
+	bool MakeKey(Kind kind, uint8_t op, const IExpressionAST* left, const IExpressionAST* right, uint64_t payload,
+		Key& key)const;
+
+	template <typename T, typename... Args>
+	const IExpressionAST* Find(const Key& key, Args&&... args);
+
+	template <typename T, typename... Args>
+	const IExpressionAST* Build(Args&&... args);
+
+	ASTContext& m_context;
+	std::unordered_map<Key, const IExpressionAST*, KeyHash> m_nodes;
+	std::unordered_map<const IExpressionAST*, size_t> m_hashes;
+	Stats m_stats;
+};
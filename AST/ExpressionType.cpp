@@ -1,43 +1,84 @@
 #include "ExpressionType.h"
-#include <unordered_map>
-#include <set>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
 
 namespace
 {
-    const std::map<ExpressionType, std::set<ExpressionType>> gcAvailableCasts = {
-        { ExpressionType::Int, { ExpressionType::Float, ExpressionType::Bool } },
-        { ExpressionType::Float, { ExpressionType::Int, ExpressionType::Bool } },
-        { ExpressionType::Bool, { ExpressionType::Int, ExpressionType::Float } }
+    const size_t gcTypeCount = 4;
+    static_assert(size_t(ExpressionType::String) + 1 == gcTypeCount, "the tables need a row and a column for every type");
+
+    const uint8_t I = uint8_t(ExpressionType::Int);
+    const uint8_t F = uint8_t(ExpressionType::Float);
+    const uint8_t B = uint8_t(ExpressionType::Bool);
+    const uint8_t S = uint8_t(ExpressionType::String);
+    const uint8_t N = 0xff; // no common type
+
+    // Indexed [from][to]: numbers and booleans convert into each other,
+    // strings only into themselves.
+    constexpr bool gcCasts[gcTypeCount][gcTypeCount] = {
+        //           Int    Float  Bool   String
+        /* Int */    { true,  true,  true,  false },
+        /* Float */  { true,  true,  true,  false },
+        /* Bool */   { true,  true,  true,  false },
+        /* String */ { false, false, false, true }
     };
-    
-    const std::map<std::pair<ExpressionType, ExpressionType>, ExpressionType> gcBinaryCasts = {
-        // Integer left
-        { { ExpressionType::Int, ExpressionType::Float }, ExpressionType::Float },
-        { { ExpressionType::Int, ExpressionType::Bool }, ExpressionType::Int },
-        // Float left
-        { { ExpressionType::Float, ExpressionType::Int }, ExpressionType::Float },
-        { { ExpressionType::Float, ExpressionType::Bool }, ExpressionType::Float },
-        // Bool left
-        { { ExpressionType::Bool, ExpressionType::Int }, ExpressionType::Int },
-        { { ExpressionType::Bool, ExpressionType::Float }, ExpressionType::Float }
+
+    // Indexed [left][right]: the type both operands of a binary operator are
+    // converted to.
+    constexpr uint8_t gcBinaryCasts[gcTypeCount][gcTypeCount] = {
+        //           Int Float Bool String
+        /* Int */    { I,  F,  I,  N },
+        /* Float */  { F,  F,  F,  N },
+        /* Bool */   { I,  F,  B,  N },
+        /* String */ { N,  N,  N,  S }
     };
-}
 
-bool Convertible(ExpressionType from, ExpressionType to)
-{
-    if (from == to)
+    constexpr bool Casts(uint8_t from, uint8_t to)
+    {
+        return gcCasts[from][to];
+    }
+
+    constexpr uint8_t BinaryCast(uint8_t left, uint8_t right)
+    {
+        return gcBinaryCasts[left][right];
+    }
+
+    // The common type of left and right is the same either way round, and
+    // both convert to it.
+    constexpr bool BinaryCastIsSound(uint8_t left, uint8_t right, uint8_t type)
     {
-        throw std::runtime_error("trying to convert from '" + ToString(from) +  "' to itself");
+        return type == BinaryCast(right, left) && (type == N || (Casts(left, type) && Casts(right, type)));
     }
-    
-    auto found = gcAvailableCasts.find(from);
-    if (found == gcAvailableCasts.end())
+
+    // Checks every pair of types from index on, as index / count and
+    // index % count.
+    constexpr bool BinaryCastsAreSound(size_t index = 0)
     {
-        return false;
+        return index == gcTypeCount * gcTypeCount
+            || (BinaryCastIsSound(uint8_t(index / gcTypeCount), uint8_t(index % gcTypeCount),
+                    BinaryCast(uint8_t(index / gcTypeCount), uint8_t(index % gcTypeCount)))
+                && BinaryCastsAreSound(index + 1));
     }
-    
-    const auto& availableCasts = found->second;
-    return availableCasts.find(to) != availableCasts.end();
+
+    static_assert(Casts(I, I) && Casts(F, F) && Casts(B, B) && Casts(S, S), "every type converts to itself");
+    static_assert(Casts(I, F) && Casts(I, B) && Casts(F, I) && Casts(F, B) && Casts(B, I) && Casts(B, F),
+        "numbers and booleans convert into each other");
+    static_assert(!Casts(S, I) && !Casts(S, F) && !Casts(S, B) && !Casts(I, S) && !Casts(F, S) && !Casts(B, S),
+        "strings convert to nothing and nothing converts to them");
+    static_assert(BinaryCast(I, I) == I && BinaryCast(F, F) == F && BinaryCast(B, B) == B && BinaryCast(S, S) == S,
+        "operands of the same type keep it");
+    static_assert(BinaryCast(I, F) == F && BinaryCast(B, F) == F, "float wins over int and bool");
+    static_assert(BinaryCast(B, I) == I, "int wins over bool");
+    static_assert(BinaryCastsAreSound(),
+        "operand order does not matter, and both operands convert to the common type");
+}
+
+bool Convertible(ExpressionType from, ExpressionType to)
+{
+    assert(size_t(from) < gcTypeCount && size_t(to) < gcTypeCount);
+    return Casts(uint8_t(from), uint8_t(to));
 }
 
 bool ConvertibleToBool(ExpressionType type)
@@ -45,20 +86,15 @@ bool ConvertibleToBool(ExpressionType type)
     return Convertible(type, ExpressionType::Bool);
 }
 
-boost::optional<ExpressionType> GetPreferredType(
-                                                 ExpressionType left, ExpressionType right)
+boost::optional<ExpressionType> GetPreferredType(ExpressionType left, ExpressionType right)
 {
-    if (left == right)
-    {
-        return left;
-    }
-    
-    auto found = gcBinaryCasts.find(std::make_pair(left, right));
-    if (found == gcBinaryCasts.end())
+    assert(size_t(left) < gcTypeCount && size_t(right) < gcTypeCount);
+    const uint8_t type = BinaryCast(uint8_t(left), uint8_t(right));
+    if (type == N)
     {
         return boost::none;
     }
-    return found->second;
+    return ExpressionType(type);
 }
 
 std::string ToString(ExpressionType type)
@@ -13,9 +13,12 @@ enum class ExpressionType
 	String
 };
 
+// Whether a value of type from can be converted to type to; every type
+// converts to itself. Both look up a table, so they cost next to nothing.
 bool Convertible(ExpressionType from, ExpressionType to);
 bool ConvertibleToBool(ExpressionType type);
 
+// The type both operands of a binary operator are converted to, if any.
 boost::optional<ExpressionType> GetPreferredType(ExpressionType left, ExpressionType right);
 
 std::string ToString(ExpressionType type);
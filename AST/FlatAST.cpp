@@ -0,0 +1,749 @@
+#include "FlatAST.h"
+#include "StackGuard.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+const char gcImageMagic[4] = { 'F', 'L', 'A', 'T' };
+
+size_t Align(size_t offset)
+{
+	return (offset + 7) & ~size_t(7);
+}
+
+bool IsExpression(FlatAST::Kind kind)
+{
+	return kind <= FlatAST::Kind::ArrayAccess;
+}
+
+bool IsStatement(FlatAST::Kind kind)
+{
+	return kind >= FlatAST::Kind::Declaration && kind <= FlatAST::Kind::CallStatement;
+}
+
+void Require(bool valid)
+{
+	if (!valid)
+	{
+		throw std::runtime_error("syntax tree image is damaged");
+	}
+}
+}
+
+// Where each part of an image starts, worked out from its counts. Every
+// part begins on an 8-byte boundary, so an aligned image can be read in
+// place. Numbers are in the byte order of the machine that wrote them;
+// another one sees a different version and refuses the image.
+struct FlatAST::Layout
+{
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t nodes;
+		uint64_t lists;
+		uint64_t params;
+		uint64_t functions;
+		uint64_t symbols;
+		uint64_t textBytes;
+	};
+
+	explicit Layout(const Header& header)
+	{
+		payloads = Align(sizeof(Header));
+		children = Align(payloads + header.nodes * sizeof(Payload));
+		lists = Align(children + header.nodes * 3 * sizeof(Index));
+		params = Align(lists + header.lists * sizeof(Index));
+		functions = Align(params + header.params * 2 * sizeof(uint32_t));
+		names = Align(functions + header.functions * sizeof(Index));
+		kinds = Align(names + (header.symbols + 1) * sizeof(uint32_t));
+		ops = Align(kinds + header.nodes);
+		text = Align(ops + header.nodes);
+		size = Align(text + header.textBytes);
+	}
+
+	size_t payloads;
+	size_t children;
+	size_t lists;
+	size_t params;
+	size_t functions;
+	size_t names; // where each name ends in text
+	size_t kinds;
+	size_t ops;
+	size_t text;
+	size_t size;
+};
+
+// Appends the nodes below whatever it visits; the row of the last node
+// visited is left in m_result.
+class FlatAST::Builder
+	: public IExpressionVisitor
+	, public IStatementVisitor
+{
+public:
+	explicit Builder(FlatAST& flat)
+		: m_flat(flat)
+		, m_result(kNone)
+	{
+	}
+
+	Index Add(const IExpressionAST& node)
+	{
+		if (StackGuard::IsNearEnd())
+		{
+			Index index = kNone;
+			StackGuard::Grow([&] { index = Add(node); });
+			return index;
+		}
+		node.Accept(*this);
+		return m_result;
+	}
+
+	Index Add(const IStatementAST& node)
+	{
+		if (StackGuard::IsNearEnd())
+		{
+			Index index = kNone;
+			StackGuard::Grow([&] { index = Add(node); });
+			return index;
+		}
+		node.Accept(*this);
+		return m_result;
+	}
+
+	Index Add(const FunctionAST& function)
+	{
+		const Index body = Add(function.GetStatement());
+		const std::vector<FunctionAST::Param>& params = function.GetParams();
+		const Index first = Index(m_flat.m_params.size() / 2);
+		for (const FunctionAST::Param& param : params)
+		{
+			m_flat.m_params.push_back(param.first);
+			m_flat.m_params.push_back(uint32_t(param.second));
+		}
+
+		const boost::optional<ExpressionType> type = function.GetReturnType();
+		return m_flat.Add(Kind::Function, type ? uint8_t(*type) : kNoType, body, first, Index(params.size()),
+			Symbol(function.GetIdentifier().GetSymbol()));
+	}
+
+	void Visit(const BinaryExpressionAST& node) override
+	{
+		const Index left = Add(node.GetLeft());
+		const Index right = Add(node.GetRight());
+		m_result = m_flat.Add(Kind::Binary, uint8_t(node.GetOperator()), left, right, kNone, Symbol(0));
+	}
+
+	void Visit(const LiteralConstantAST& node) override
+	{
+		Payload payload = Symbol(0);
+		switch (node.GetType())
+		{
+		case ExpressionType::Int:
+			payload.integer = node.GetInt();
+			break;
+		case ExpressionType::Float:
+			payload.real = node.GetFloat();
+			break;
+		case ExpressionType::Bool:
+			payload.boolean = node.GetBool();
+			break;
+		case ExpressionType::String:
+			payload.symbol = StringInterner::Global().Intern(node.GetString());
+			break;
+		}
+		m_result = m_flat.Add(Kind::Literal, uint8_t(node.GetType()), kNone, kNone, kNone, payload);
+	}
+
+	void Visit(const UnaryAST& node) override
+	{
+		const Index operand = Add(node.GetExpr());
+		m_result = m_flat.Add(Kind::Unary, uint8_t(node.GetOperator()), operand, kNone, kNone, Symbol(0));
+	}
+
+	void Visit(const IdentifierAST& node) override
+	{
+		m_result = m_flat.Add(Kind::Identifier, 0, kNone, kNone, kNone, Symbol(node.GetSymbol()));
+	}
+
+	void Visit(const FunctionCallExprAST& node) override
+	{
+		std::vector<Index> params(node.GetParamsCount());
+		for (size_t i = 0; i < params.size(); ++i)
+		{
+			params[i] = Add(node.GetParam(i));
+		}
+		m_result = m_flat.Add(Kind::Call, 0, m_flat.AddList(params), Index(params.size()), kNone,
+			Symbol(node.GetSymbol()));
+	}
+
+	void Visit(const ArrayElementAccessAST& node) override
+	{
+		const Index index = Add(node.GetIndex());
+		m_result = m_flat.Add(Kind::ArrayAccess, 0, index, kNone, kNone, Symbol(node.GetSymbol()));
+	}
+
+	void Visit(const VariableDeclarationAST& node) override
+	{
+		const Index value = node.GetExpression() ? Add(*node.GetExpression()) : kNone;
+		m_result = m_flat.Add(Kind::Declaration, uint8_t(node.GetType()), value, kNone, kNone,
+			Symbol(node.GetIdentifier().GetSymbol()));
+	}
+
+	void Visit(const AssignStatementAST& node) override
+	{
+		const Index value = Add(node.GetExpr());
+		m_result = m_flat.Add(Kind::Assign, 0, value, kNone, kNone, Symbol(node.GetIdentifier().GetSymbol()));
+	}
+
+	void Visit(const ArrayElementAssignAST& node) override
+	{
+		const Index index = Add(node.GetIndex());
+		const Index value = Add(node.GetExpression());
+		m_result = m_flat.Add(Kind::ArrayAssign, 0, index, value, kNone, Symbol(node.GetSymbol()));
+	}
+
+	void Visit(const ReturnStatementAST& node) override
+	{
+		const Index value = node.GetExpression() ? Add(*node.GetExpression()) : kNone;
+		m_result = m_flat.Add(Kind::Return, 0, value, kNone, kNone, Symbol(0));
+	}
+
+	void Visit(const IfStatementAST& node) override
+	{
+		const Index condition = Add(node.GetExpr());
+		const Index then = Add(node.GetThenStmt());
+		const Index elif = node.GetElseStmt() ? Add(*node.GetElseStmt()) : kNone;
+		m_result = m_flat.Add(Kind::If, 0, condition, then, elif, Symbol(0));
+	}
+
+	void Visit(const WhileStatementAST& node) override
+	{
+		const Index condition = Add(node.GetExpr());
+		const Index body = Add(node.GetStatement());
+		m_result = m_flat.Add(Kind::While, 0, condition, body, kNone, Symbol(0));
+	}
+
+	void Visit(const CompositeStatementAST& node) override
+	{
+		std::vector<Index> statements(node.GetCount());
+		for (size_t i = 0; i < statements.size(); ++i)
+		{
+			statements[i] = Add(node.GetStatement(i));
+		}
+		m_result = m_flat.Add(Kind::Composite, 0, m_flat.AddList(statements), Index(statements.size()), kNone,
+			Symbol(0));
+	}
+
+	void Visit(const PrintAST& node) override
+	{
+		std::vector<Index> params(node.GetParamsCount());
+		for (size_t i = 0; i < params.size(); ++i)
+		{
+			params[i] = Add(node.GetExpression(i));
+		}
+		m_result = m_flat.Add(Kind::Print, 0, m_flat.AddList(params), Index(params.size()), kNone, Symbol(0));
+	}
+
+	void Visit(const FunctionCallStatementAST& node) override
+	{
+		const Index call = Add(node.GetCall());
+		m_result = m_flat.Add(Kind::CallStatement, 0, call, kNone, kNone, Symbol(0));
+	}
+
+private:
+	static Payload Symbol(SymbolId symbol)
+	{
+		Payload payload;
+		payload.real = 0;
+		payload.symbol = symbol;
+		return payload;
+	}
+
+	FlatAST& m_flat;
+	Index m_result;
+};
+
+FlatAST::FlatAST()
+	: m_symbols(nullptr)
+	, m_readOnly(false)
+{
+	Attach();
+}
+
+FlatAST::FlatAST(const ProgramAST& program)
+	: FlatAST()
+{
+	for (size_t i = 0; i < program.GetFunctionsCount(); ++i)
+	{
+		AddFunction(program.GetFunction(i));
+	}
+}
+
+FlatAST::FlatAST(const void* image, size_t size)
+	: m_symbols(nullptr)
+	, m_readOnly(true)
+{
+	const char* bytes = static_cast<const char*>(image);
+	Layout::Header header;
+	if (size < sizeof(header) || reinterpret_cast<uintptr_t>(bytes) % 8 != 0)
+	{
+		throw std::runtime_error("not a syntax tree image");
+	}
+	memcpy(&header, bytes, sizeof(header));
+	if (memcmp(header.magic, gcImageMagic, sizeof(gcImageMagic)) != 0 || header.version != kImageVersion)
+	{
+		throw std::runtime_error("not a syntax tree image of this version");
+	}
+
+	// Every count is of things at least a byte long, so counts that fit
+	// in the image cannot overflow the layout.
+	for (uint64_t count : { header.nodes, header.lists, header.params, header.functions, header.symbols, header.textBytes })
+	{
+		if (count > size)
+		{
+			throw std::runtime_error("syntax tree image is damaged");
+		}
+	}
+	const Layout layout(header);
+	if (layout.size != size)
+	{
+		throw std::runtime_error("syntax tree image is damaged");
+	}
+
+	m_rows.kinds = reinterpret_cast<const Kind*>(bytes + layout.kinds);
+	m_rows.ops = reinterpret_cast<const uint8_t*>(bytes + layout.ops);
+	m_rows.children = reinterpret_cast<const Index*>(bytes + layout.children);
+	m_rows.payloads = reinterpret_cast<const Payload*>(bytes + layout.payloads);
+	m_rows.lists = reinterpret_cast<const Index*>(bytes + layout.lists);
+	m_rows.params = reinterpret_cast<const uint32_t*>(bytes + layout.params);
+	m_rows.functions = reinterpret_cast<const Index*>(bytes + layout.functions);
+	m_rows.size = size_t(header.nodes);
+	m_rows.functionCount = size_t(header.functions);
+
+	// Names are numbered from 1 in the image; each is interned once here,
+	// and the rows are mapped through the table as they are read.
+	const uint32_t* ends = reinterpret_cast<const uint32_t*>(bytes + layout.names);
+	const char* text = bytes + layout.text;
+	m_symbolMap.resize(size_t(header.symbols) + 1, StringInterner::kNoSymbol);
+	for (size_t k = 1; k < m_symbolMap.size(); ++k)
+	{
+		if (ends[k] < ends[k - 1] || ends[k] > header.textBytes)
+		{
+			throw std::runtime_error("syntax tree image is damaged");
+		}
+		m_symbolMap[k] = StringInterner::Global().Intern(text + ends[k - 1], ends[k] - ends[k - 1]);
+	}
+	m_symbols = m_symbolMap.data();
+
+	Validate(header.lists, header.params, header.symbols);
+}
+
+// Checks every row of an image once, so that building from it reads only
+// what is inside the image: each child comes before its parent and is of
+// the kind its slot takes, each list and parameter run lies inside its
+// array, and every kind, operator, type and name is one that exists.
+void FlatAST::Validate(uint64_t lists, uint64_t params, uint64_t symbols)const
+{
+	auto isType = [](uint8_t op) { return op <= uint8_t(ExpressionType::String); };
+	auto isName = [&](uint32_t symbol) { return symbol >= 1 && symbol <= symbols; };
+
+	for (Index node = 0; node < m_rows.size; ++node)
+	{
+		const Kind kind = GetKind(node);
+		const uint8_t op = GetOperator(node);
+		const Index a = GetChild(node, 0);
+		const Index b = GetChild(node, 1);
+		const Index c = GetChild(node, 2);
+
+		auto expression = [&](Index child) { return child < node && IsExpression(GetKind(child)); };
+		auto statement = [&](Index child) { return child < node && IsStatement(GetKind(child)); };
+		auto list = [&](bool (*item)(Kind)) {
+			Require(uint64_t(a) + b <= lists);
+			for (Index i = 0; i < b; ++i)
+			{
+				const Index child = m_rows.lists[size_t(a) + i];
+				Require(child < node && item(GetKind(child)));
+			}
+		};
+
+		Require(kind <= Kind::Function);
+		if (HasSymbol(kind, op))
+		{
+			Require(isName(m_rows.payloads[node].symbol));
+		}
+
+		switch (kind)
+		{
+		case Kind::Binary:
+			Require(op <= BinaryExpressionAST::Mod && expression(a) && expression(b));
+			break;
+		case Kind::Literal:
+			Require(isType(op));
+			break;
+		case Kind::Unary:
+			Require(op <= UnaryAST::Negation && expression(a));
+			break;
+		case Kind::Identifier:
+			break;
+		case Kind::Call:
+		case Kind::Print:
+			list(IsExpression);
+			break;
+		case Kind::ArrayAccess:
+		case Kind::Assign:
+			Require(expression(a));
+			break;
+		case Kind::Declaration:
+			Require(isType(op) && (a == kNone || expression(a)));
+			break;
+		case Kind::ArrayAssign:
+			Require(expression(a) && expression(b));
+			break;
+		case Kind::Return:
+			Require(a == kNone || expression(a));
+			break;
+		case Kind::If:
+			Require(expression(a) && statement(b) && (c == kNone || statement(c)));
+			break;
+		case Kind::While:
+			Require(expression(a) && statement(b));
+			break;
+		case Kind::Composite:
+			list(IsStatement);
+			break;
+		case Kind::CallStatement:
+			Require(a < node && GetKind(a) == Kind::Call);
+			break;
+		case Kind::Function:
+			Require((op == kNoType || isType(op)) && statement(a) && uint64_t(b) + c <= params);
+			for (Index i = 0; i < c; ++i)
+			{
+				const uint32_t* param = m_rows.params + 2 * (size_t(b) + i);
+				Require(isName(param[0]) && param[1] <= uint32_t(ExpressionType::String));
+			}
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < m_rows.functionCount; ++i)
+	{
+		Require(GetFunction(i) < m_rows.size && GetKind(GetFunction(i)) == Kind::Function);
+	}
+	// Without functions, the last row is the root of a block.
+	if (m_rows.functionCount == 0 && m_rows.size > 0)
+	{
+		Require(IsStatement(GetKind(Index(m_rows.size - 1))));
+	}
+}
+
+FlatAST::Index FlatAST::AddFunction(const FunctionAST& function)
+{
+	const Index index = Builder(*this).Add(function);
+	m_functions.push_back(index);
+	Attach();
+	return index;
+}
+
+FlatAST::Index FlatAST::AddStatement(const IStatementAST& statement)
+{
+	const Index index = Builder(*this).Add(statement);
+	Attach();
+	return index;
+}
+
+FlatAST::Index FlatAST::AddExpression(const IExpressionAST& expression)
+{
+	const Index index = Builder(*this).Add(expression);
+	Attach();
+	return index;
+}
+
+FlatAST::Index FlatAST::Add(Kind kind, uint8_t op, Index a, Index b, Index c, Payload payload)
+{
+	if (m_readOnly)
+	{
+		throw std::logic_error("a syntax tree read from an image cannot grow");
+	}
+	if (m_kinds.size() >= kNone)
+	{
+		throw std::length_error("too many nodes for a flat syntax tree");
+	}
+	m_kinds.push_back(kind);
+	m_ops.push_back(op);
+	m_children.push_back(a);
+	m_children.push_back(b);
+	m_children.push_back(c);
+	m_payloads.push_back(payload);
+	return Index(m_kinds.size() - 1);
+}
+
+FlatAST::Index FlatAST::AddList(const std::vector<Index>& items)
+{
+	const Index first = Index(m_lists.size());
+	m_lists.insert(m_lists.end(), items.begin(), items.end());
+	return first;
+}
+
+// Points the rows at the vectors again after they have grown.
+void FlatAST::Attach()
+{
+	m_rows.kinds = m_kinds.data();
+	m_rows.ops = m_ops.data();
+	m_rows.children = m_children.data();
+	m_rows.payloads = m_payloads.data();
+	m_rows.lists = m_lists.data();
+	m_rows.params = m_params.data();
+	m_rows.functions = m_functions.data();
+	m_rows.size = m_kinds.size();
+	m_rows.functionCount = m_functions.size();
+}
+
+bool FlatAST::HasSymbol(Kind kind, uint8_t op)
+{
+	switch (kind)
+	{
+	case Kind::Literal:
+		return ExpressionType(op) == ExpressionType::String;
+	case Kind::Identifier:
+	case Kind::Call:
+	case Kind::ArrayAccess:
+	case Kind::Declaration:
+	case Kind::Assign:
+	case Kind::ArrayAssign:
+	case Kind::Function:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void FlatAST::Save(std::string& out)const
+{
+	// Names get image numbers in order of first use.
+	std::vector<uint32_t> numbers(StringInterner::Global().GetCount() + 1, 0);
+	std::vector<SymbolId> names;
+	auto number = [&](SymbolId symbol) {
+		if (numbers[symbol] == 0)
+		{
+			names.push_back(symbol);
+			numbers[symbol] = uint32_t(names.size());
+		}
+		return numbers[symbol];
+	};
+
+	std::vector<Payload> payloads(m_rows.payloads, m_rows.payloads + m_rows.size);
+	for (Index node = 0; node < m_rows.size; ++node)
+	{
+		if (HasSymbol(GetKind(node), GetOperator(node)))
+		{
+			payloads[node].symbol = number(GetSymbol(node));
+		}
+	}
+	size_t paramCount = 0;
+	for (size_t i = 0; i < m_rows.functionCount; ++i)
+	{
+		paramCount += GetChild(GetFunction(i), 2);
+	}
+	std::vector<uint32_t> params(m_rows.params, m_rows.params + 2 * paramCount);
+	for (size_t i = 0; i < params.size(); i += 2)
+	{
+		params[i] = number(m_symbols ? m_symbols[params[i]] : params[i]);
+	}
+
+	std::string text;
+	std::vector<uint32_t> ends(1, 0);
+	const StringInterner& interner = StringInterner::Global();
+	for (SymbolId symbol : names)
+	{
+		text.append(interner.GetSpelling(symbol), interner.GetLength(symbol));
+		if (text.size() > UINT32_MAX)
+		{
+			throw std::length_error("too many names for a syntax tree image");
+		}
+		ends.push_back(uint32_t(text.size()));
+	}
+
+	size_t listCount = 0;
+	for (Index node = 0; node < m_rows.size; ++node)
+	{
+		const Kind kind = GetKind(node);
+		if (kind == Kind::Call || kind == Kind::Composite || kind == Kind::Print)
+		{
+			listCount += GetChild(node, 1);
+		}
+	}
+
+	Layout::Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, gcImageMagic, sizeof(gcImageMagic));
+	header.version = kImageVersion;
+	header.nodes = m_rows.size;
+	header.lists = listCount;
+	header.params = paramCount;
+	header.functions = m_rows.functionCount;
+	header.symbols = names.size();
+	header.textBytes = text.size();
+	const Layout layout(header);
+
+	out.assign(layout.size, '\0');
+	char* bytes = &out[0];
+	memcpy(bytes, &header, sizeof(header));
+	memcpy(bytes + layout.payloads, payloads.data(), payloads.size() * sizeof(Payload));
+	memcpy(bytes + layout.children, m_rows.children, m_rows.size * 3 * sizeof(Index));
+	memcpy(bytes + layout.lists, m_rows.lists, listCount * sizeof(Index));
+	memcpy(bytes + layout.params, params.data(), params.size() * sizeof(uint32_t));
+	memcpy(bytes + layout.functions, m_rows.functions, m_rows.functionCount * sizeof(Index));
+	memcpy(bytes + layout.names, ends.data(), ends.size() * sizeof(uint32_t));
+	memcpy(bytes + layout.kinds, m_rows.kinds, m_rows.size);
+	memcpy(bytes + layout.ops, m_rows.ops, m_rows.size);
+	memcpy(bytes + layout.text, text.data(), text.size());
+}
+
+// Back to the tree form
+void FlatAST::BuildProgram(ASTContext& context, ProgramAST& program)const
+{
+	for (size_t i = 0; i < GetFunctionsCount(); ++i)
+	{
+		program.AddFunction(BuildFunction(GetFunction(i), context));
+	}
+}
+
+const FunctionAST* FlatAST::BuildFunction(Index node, ASTContext& context)const
+{
+	boost::optional<ExpressionType> returnType;
+	if (GetOperator(node) != kNoType)
+	{
+		returnType = ExpressionType(GetOperator(node));
+	}
+	std::vector<FunctionAST::Param> params(GetChild(node, 2));
+	for (size_t i = 0; i < params.size(); ++i)
+	{
+		params[i] = GetParam(node, i);
+	}
+
+	return context.Create<FunctionAST>(
+		returnType,
+		context.Create<IdentifierAST>(GetSymbol(node)),
+		std::move(params),
+		BuildStatement(GetChild(node, 0), context));
+}
+
+const IStatementAST* FlatAST::BuildStatement(Index node, ASTContext& context)const
+{
+	if (StackGuard::IsNearEnd())
+	{
+		const IStatementAST* statement = nullptr;
+		StackGuard::Grow([&] { statement = BuildStatement(node, context); });
+		return statement;
+	}
+
+	const Index a = GetChild(node, 0);
+	const Index b = GetChild(node, 1);
+	const Index c = GetChild(node, 2);
+
+	switch (GetKind(node))
+	{
+	case Kind::Declaration:
+	{
+		auto* declaration = context.Create<VariableDeclarationAST>(
+			context.Create<IdentifierAST>(GetSymbol(node)), ExpressionType(GetOperator(node)));
+		if (a != kNone)
+		{
+			declaration->SetExpression(BuildExpression(a, context));
+		}
+		return declaration;
+	}
+	case Kind::Assign:
+		return context.Create<AssignStatementAST>(context.Create<IdentifierAST>(GetSymbol(node)),
+			BuildExpression(a, context));
+	case Kind::ArrayAssign:
+		return context.Create<ArrayElementAssignAST>(GetSymbol(node), BuildExpression(a, context), BuildExpression(b, context));
+	case Kind::Return:
+		return context.Create<ReturnStatementAST>(a != kNone ? BuildExpression(a, context) : nullptr);
+	case Kind::If:
+		return context.Create<IfStatementAST>(BuildExpression(a, context), BuildStatement(b, context),
+			c != kNone ? BuildStatement(c, context) : nullptr);
+	case Kind::While:
+		return context.Create<WhileStatementAST>(BuildExpression(a, context), BuildStatement(b, context));
+	case Kind::Composite:
+	{
+		std::vector<const IStatementAST*> statements(b);
+		for (size_t i = 0; i < statements.size(); ++i)
+		{
+			statements[i] = BuildStatement(GetListItem(node, i), context);
+		}
+		return context.Create<CompositeStatementAST>(context.CreateList(statements.data(), b), b);
+	}
+	case Kind::Print:
+	{
+		std::vector<const IExpressionAST*> params(b);
+		for (size_t i = 0; i < params.size(); ++i)
+		{
+			params[i] = BuildExpression(GetListItem(node, i), context);
+		}
+		return context.Create<PrintAST>(context.CreateList(params.data(), b), b);
+	}
+	case Kind::CallStatement:
+		return context.Create<FunctionCallStatementAST>(BuildCall(a, context));
+	default:
+		throw std::logic_error("flat syntax tree node is not a statement");
+	}
+}
+
+const IExpressionAST* FlatAST::BuildExpression(Index node, ASTContext& context)const
+{
+	if (StackGuard::IsNearEnd())
+	{
+		const IExpressionAST* expression = nullptr;
+		StackGuard::Grow([&] { expression = BuildExpression(node, context); });
+		return expression;
+	}
+
+	const Index a = GetChild(node, 0);
+	const Index b = GetChild(node, 1);
+	const Payload& payload = GetPayload(node);
+
+	switch (GetKind(node))
+	{
+	case Kind::Binary:
+		return context.Create<BinaryExpressionAST>(BuildExpression(a, context), BuildExpression(b, context),
+			BinaryExpressionAST::Operator(GetOperator(node)));
+	case Kind::Literal:
+		switch (ExpressionType(GetOperator(node)))
+		{
+		case ExpressionType::Int:
+			return context.Create<LiteralConstantAST>(payload.integer);
+		case ExpressionType::Float:
+			return context.Create<LiteralConstantAST>(payload.real);
+		case ExpressionType::Bool:
+			return context.Create<LiteralConstantAST>(payload.boolean);
+		case ExpressionType::String:
+			return context.Create<LiteralConstantAST>(StringInterner::Global().GetString(GetSymbol(node)));
+		}
+		break;
+	case Kind::Unary:
+		return context.Create<UnaryAST>(BuildExpression(a, context), UnaryAST::Operator(GetOperator(node)));
+	case Kind::Identifier:
+		return context.Create<IdentifierAST>(GetSymbol(node));
+	case Kind::Call:
+		return BuildCall(node, context);
+	case Kind::ArrayAccess:
+		return context.Create<ArrayElementAccessAST>(GetSymbol(node), BuildExpression(a, context));
+	default:
+		break;
+	}
+	throw std::logic_error("flat syntax tree node is not an expression");
+}
+
+FunctionCallExprAST* FlatAST::BuildCall(Index node, ASTContext& context)const
+{
+	const size_t count = GetChild(node, 1);
+	std::vector<const IExpressionAST*> params(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		params[i] = BuildExpression(GetListItem(node, i), context);
+	}
+	return context.Create<FunctionCallExprAST>(GetSymbol(node), context.CreateList(params.data(), count), count);
+}
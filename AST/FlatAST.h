@@ -0,0 +1,218 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "AST.h"
+#include "ASTContext.h"
+
+// The nodes of a program as rows of a few parallel arrays: a kind, an
+// operator or type, up to three children given as 32-bit row numbers, and a
+// literal or symbol payload. A pass over it is a loop over contiguous memory
+// with no virtual calls, where a walk of the tree chases pointers across the
+// arena.
+//
+// Children are always added before their parents, so a forward loop sees
+// every node after the nodes below it, and the last row is the root of the
+// tree added last. Nodes with a variable number of children keep them as a
+// run in a separate list array.
+//
+// What each node keeps, by kind:
+//	Binary			op: BinaryExpressionAST::Operator, a: left, b: right
+//	Literal			op: ExpressionType, payload: the value
+//	Unary			op: UnaryAST::Operator, a: operand
+//	Identifier		payload: symbol
+//	Call			payload: symbol, a, b: first list entry and count of arguments
+//	ArrayAccess		payload: symbol, a: index
+//	Declaration		op: ExpressionType, payload: symbol, a: initializer or kNone
+//	Assign			payload: symbol, a: value
+//	ArrayAssign		payload: symbol, a: index, b: value
+//	Return			a: value or kNone
+//	If				a: condition, b: then, c: else or kNone
+//	While			a: condition, b: body
+//	Composite		a, b: first list entry and count of statements
+//	Print			a, b: first list entry and count of arguments
+//	CallStatement	a: the Call node
+//	Function		op: ExpressionType or kNoType, payload: symbol, a: body,
+//					b, c: first parameter and count
+//
+// Save writes the rows out as an image with no pointers in it, which a
+// later run can map and read in place.
+class FlatAST
+{
+public:
+	using Index = uint32_t;
+
+	static const Index kNone = UINT32_MAX;
+	static const uint8_t kNoType = UINT8_MAX;
+
+	// Changes with every change to the image layout or to what a row
+	// means; images of another version are refused.
+	static const uint32_t kImageVersion = 1;
+
+	enum class Kind : uint8_t
+	{
+		Binary,
+		Literal,
+		Unary,
+		Identifier,
+		Call,
+		ArrayAccess,
+		Declaration,
+		Assign,
+		ArrayAssign,
+		Return,
+		If,
+		While,
+		Composite,
+		Print,
+		CallStatement,
+		Function
+	};
+
+	union Payload
+	{
+		int integer;
+		double real;
+		bool boolean;
+		SymbolId symbol;
+	};
+
+	FlatAST();
+	explicit FlatAST(const ProgramAST& program);
+
+	// Reads an image made by Save in place, without copying the rows; the
+	// image must outlive the tree and be 8-byte aligned, as a mapped file
+	// is. The names are interned and every row is checked up front. Throws
+	// std::runtime_error if the image is not one of this version or is
+	// damaged.
+	FlatAST(const void* image, size_t size);
+
+	FlatAST(const FlatAST&) = delete;
+	FlatAST& operator=(const FlatAST&) = delete;
+
+	// Appends the nodes of a tree and returns the row of its root. A tree
+	// read from an image takes no more nodes.
+	Index AddFunction(const FunctionAST& function);
+	Index AddStatement(const IStatementAST& statement);
+	Index AddExpression(const IExpressionAST& expression);
+
+	// Builds the tree form again in context, for the passes that visit it.
+	void BuildProgram(ASTContext& context, ProgramAST& program)const;
+	const FunctionAST* BuildFunction(Index node, ASTContext& context)const;
+	const IStatementAST* BuildStatement(Index node, ASTContext& context)const;
+	const IExpressionAST* BuildExpression(Index node, ASTContext& context)const;
+
+	// Replaces out with the image of the tree.
+	void Save(std::string& out)const;
+
+	size_t GetSize()const;
+	size_t GetFunctionsCount()const;
+	Index GetFunction(size_t index)const;
+
+	Kind GetKind(Index node)const;
+	uint8_t GetOperator(Index node)const;
+	Index GetChild(Index node, unsigned slot)const;
+	const Payload& GetPayload(Index node)const;
+
+	// The name or string of a node, also for trees read from an image,
+	// whose payloads hold the image's own numbering.
+	SymbolId GetSymbol(Index node)const;
+
+	// Children of Call, Composite and Print nodes.
+	Index GetListItem(Index node, size_t index)const;
+
+	FunctionAST::Param GetParam(Index function, size_t index)const;
+
+private:
+	class Builder;
+	struct Layout;
+
+	// Where the rows are read from: the vectors below, or an image.
+	struct Rows
+	{
+		const Kind* kinds;
+		const uint8_t* ops;
+		const Index* children;
+		const Payload* payloads;
+		const Index* lists;
+		const uint32_t* params;
+		const Index* functions;
+		size_t size;
+		size_t functionCount;
+	};
+
+	Index Add(Kind kind, uint8_t op, Index a, Index b, Index c, Payload payload);
+	Index AddList(const std::vector<Index>& items);
+	void Attach();
+
+	FunctionCallExprAST* BuildCall(Index node, ASTContext& context)const;
+	void Validate(uint64_t lists, uint64_t params, uint64_t symbols)const;
+
+	static bool HasSymbol(Kind kind, uint8_t op);
+
+	Rows m_rows;
+	const SymbolId* m_symbols; // image symbol to interned symbol, null if built here
+	bool m_readOnly;
+
+	std::vector<Kind> m_kinds;
+	std::vector<uint8_t> m_ops;
+	std::vector<Index> m_children; // three per node
+	std::vector<Payload> m_payloads;
+	std::vector<Index> m_lists;
+	std::vector<uint32_t> m_params; // symbol and type of each
+	std::vector<Index> m_functions;
+	std::vector<SymbolId> m_symbolMap;
+};
+
+inline size_t FlatAST::GetSize()const
+{
+	return m_rows.size;
+}
+
+inline size_t FlatAST::GetFunctionsCount()const
+{
+	return m_rows.functionCount;
+}
+
+inline FlatAST::Index FlatAST::GetFunction(size_t index)const
+{
+	return m_rows.functions[index];
+}
+
+inline FlatAST::Kind FlatAST::GetKind(Index node)const
+{
+	return m_rows.kinds[node];
+}
+
+inline uint8_t FlatAST::GetOperator(Index node)const
+{
+	return m_rows.ops[node];
+}
+
+inline FlatAST::Index FlatAST::GetChild(Index node, unsigned slot)const
+{
+	return m_rows.children[size_t(node) * 3 + slot];
+}
+
+inline const FlatAST::Payload& FlatAST::GetPayload(Index node)const
+{
+	return m_rows.payloads[node];
+}
+
+inline SymbolId FlatAST::GetSymbol(Index node)const
+{
+	const SymbolId symbol = m_rows.payloads[node].symbol;
+	return m_symbols ? m_symbols[symbol] : symbol;
+}
+
+inline FlatAST::Index FlatAST::GetListItem(Index node, size_t index)const
+{
+	return m_rows.lists[GetChild(node, 0) + index];
+}
+
+inline FunctionAST::Param FlatAST::GetParam(Index function, size_t index)const
+{
+	const uint32_t* param = m_rows.params + 2 * (GetChild(function, 1) + index);
+	return FunctionAST::Param(m_symbols ? m_symbols[param[0]] : param[0], ExpressionType(param[1]));
+}
@@ -0,0 +1,132 @@
+#include "StackGuard.h"
+#include <exception>
+#include <new>
+#include <pthread.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+// Assumed to be left below the first check on a thread whose stack bounds
+// cannot be found.
+const size_t gcFallbackStack = 1024 * 1024;
+
+size_t g_limit = 0;
+
+struct Segments
+{
+	std::vector<char*> stacks;
+	size_t used = 0;
+
+	~Segments()
+	{
+		for (char* stack : stacks)
+		{
+			munmap(stack, StackGuard::kSegmentSize);
+		}
+	}
+};
+
+struct Call
+{
+	const std::function<void()>* body;
+	std::exception_ptr failure;
+};
+
+thread_local Segments t_segments;
+thread_local Call* t_call = nullptr;
+
+// Exceptions cannot unwind past the start of a segment, so they are carried
+// across the switch and rethrown on the caller's stack.
+void Trampoline()
+{
+	Call* call = t_call;
+	try
+	{
+		(*call->body)();
+	}
+	catch (...)
+	{
+		call->failure = std::current_exception();
+	}
+}
+
+char* NewSegment()
+{
+	void* stack = mmap(nullptr, StackGuard::kSegmentSize, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+	if (stack == MAP_FAILED)
+	{
+		throw std::bad_alloc();
+	}
+	// A guard page turns an overrun of the segment into a fault.
+	mprotect(stack, size_t(sysconf(_SC_PAGESIZE)), PROT_NONE);
+	return static_cast<char*>(stack);
+}
+}
+
+thread_local char* StackGuard::s_limit = nullptr;
+
+void StackGuard::SetLimit(size_t bytes)
+{
+	g_limit = bytes;
+}
+
+char* StackGuard::FindLimit()
+{
+	pthread_attr_t attr;
+	void* low = nullptr;
+	size_t size = 0;
+	if (pthread_getattr_np(pthread_self(), &attr) == 0)
+	{
+		pthread_attr_getstack(&attr, &low, &size);
+		pthread_attr_destroy(&attr);
+	}
+
+	char* here = static_cast<char*>(__builtin_frame_address(0));
+	s_limit = low ? static_cast<char*>(low) + kRedZone : here - gcFallbackStack;
+	return s_limit;
+}
+
+void StackGuard::Grow(const std::function<void()>& body)
+{
+	Segments& segments = t_segments;
+	if (g_limit && (segments.used + 1) * kSegmentSize > g_limit)
+	{
+		throw std::runtime_error("input is nested too deeply");
+	}
+	if (segments.used == segments.stacks.size())
+	{
+		segments.stacks.push_back(NewSegment());
+	}
+	char* stack = segments.stacks[segments.used];
+
+	Call call{ &body, nullptr };
+	ucontext_t caller;
+	ucontext_t callee;
+	getcontext(&callee);
+	callee.uc_stack.ss_sp = stack;
+	callee.uc_stack.ss_size = kSegmentSize;
+	callee.uc_link = &caller;
+	makecontext(&callee, Trampoline, 0);
+
+	char* savedLimit = s_limit;
+	Call* savedCall = t_call;
+	s_limit = stack + kRedZone;
+	t_call = &call;
+	++segments.used;
+
+	swapcontext(&caller, &callee);
+
+	--segments.used;
+	t_call = savedCall;
+	s_limit = savedLimit;
+
+	if (call.failure)
+	{
+		std::rethrow_exception(call.failure);
+	}
+}
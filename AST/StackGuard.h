@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+// Lets recursive descent and tree walks go as deep as the input does.
+// Recursive code checks IsNearEnd() on entry and, when the stack is nearly
+// used up, runs the rest of the call through Grow(), which continues on a
+// fresh stack segment and switches back when it is done. Segments are kept
+// per thread for reuse.
+class StackGuard
+{
+public:
+	// Stack that must stay free for one step of the recursion, from one
+	// check to the next.
+	static const size_t kRedZone = 256 * 1024;
+	static const size_t kSegmentSize = 16 * 1024 * 1024;
+
+	static bool IsNearEnd();
+
+	// Runs body on a new segment; whatever body throws comes out of Grow.
+	static void Grow(const std::function<void()>& body);
+
+	// Caps the stack memory used on top of the thread's own stack, so that
+	// absurd nesting ends in an error rather than in swapping. 0 means no cap.
+	static void SetLimit(size_t bytes);
+
+private:
+	static char* FindLimit();
+
+	static thread_local char* s_limit;
+};
+
+inline bool StackGuard::IsNearEnd()
+{
+	char probe;
+	char* limit = s_limit ? s_limit : FindLimit();
+	return &probe < limit;
+}
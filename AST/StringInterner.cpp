@@ -0,0 +1,138 @@
+#include "StringInterner.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+const size_t gcInitialSlots = 1024;
+}
+
+const SymbolId StringInterner::kNoSymbol;
+
+StringInterner::StringInterner()
+	: m_arena()
+	, m_entries(1, Entry{ "", 0, 0 })
+	, m_slots(gcInitialSlots, kNoSymbol)
+{
+}
+
+StringInterner& StringInterner::Global()
+{
+	static StringInterner interner;
+	return interner;
+}
+
+uint32_t StringInterner::Hash(const char* text, size_t length)
+{
+	// FNV-1a; identifiers are short, so anything fancier does not pay off.
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash = (hash ^ static_cast<unsigned char>(text[i])) * 16777619u;
+	}
+	return hash;
+}
+
+size_t StringInterner::Probe(const char* text, size_t length, uint32_t hash)const
+{
+	const size_t mask = m_slots.size() - 1;
+	for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+	{
+		const SymbolId id = m_slots[slot];
+		if (id == kNoSymbol)
+		{
+			return slot;
+		}
+
+		const Entry& entry = m_entries[id];
+		if (entry.hash == hash && entry.length == length && memcmp(entry.text, text, length) == 0)
+		{
+			return slot;
+		}
+	}
+}
+
+SymbolId StringInterner::Intern(const char* text, size_t length)
+{
+	const uint32_t hash = Hash(text, length);
+	size_t slot = Probe(text, length, hash);
+	if (m_slots[slot] != kNoSymbol)
+	{
+		return m_slots[slot];
+	}
+
+	if (m_entries.size() >= UINT32_MAX)
+	{
+		throw std::length_error("too many distinct names to intern");
+	}
+
+	char* spelling = static_cast<char*>(m_arena.Allocate(length + 1, 1));
+	memcpy(spelling, text, length);
+	spelling[length] = '\0';
+
+	const SymbolId id = SymbolId(m_entries.size());
+	m_entries.push_back(Entry{ spelling, uint32_t(length), hash });
+
+	// Keep the load factor under one half.
+	if (m_entries.size() * 2 > m_slots.size())
+	{
+		Grow();
+		slot = Probe(text, length, hash);
+	}
+	m_slots[slot] = id;
+
+	return id;
+}
+
+SymbolId StringInterner::Intern(const std::string& text)
+{
+	return Intern(text.data(), text.size());
+}
+
+SymbolId StringInterner::Find(const char* text, size_t length)const
+{
+	return m_slots[Probe(text, length, Hash(text, length))];
+}
+
+void StringInterner::Grow()
+{
+	std::vector<SymbolId> slots(m_slots.size() * 2, kNoSymbol);
+	const size_t mask = slots.size() - 1;
+
+	for (SymbolId id = 1; id < m_entries.size(); ++id)
+	{
+		size_t slot = m_entries[id].hash & mask;
+		while (slots[slot] != kNoSymbol)
+		{
+			slot = (slot + 1) & mask;
+		}
+		slots[slot] = id;
+	}
+	m_slots.swap(slots);
+}
+
+const char* StringInterner::GetSpelling(SymbolId id)const
+{
+	return m_entries[id].text;
+}
+
+size_t StringInterner::GetLength(SymbolId id)const
+{
+	return m_entries[id].length;
+}
+
+std::string StringInterner::GetString(SymbolId id)const
+{
+	const Entry& entry = m_entries[id];
+	return std::string(entry.text, entry.length);
+}
+
+size_t StringInterner::GetCount()const
+{
+	return m_entries.size() - 1;
+}
+
+size_t StringInterner::GetBytesUsed()const
+{
+	return m_arena.GetBytesUsed();
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Arena.h"
+
+using SymbolId = uint32_t;
+
+// Stores each distinct spelling once, in an arena, and hands out dense 32-bit
+// ids: two names are equal exactly when their ids are. Spellings are
+// NUL-terminated and never move, so GetSpelling() pointers stay valid for the
+// life of the interner.
+class StringInterner
+{
+public:
+	static const SymbolId kNoSymbol = 0;
+
+	StringInterner();
+
+	StringInterner(const StringInterner&) = delete;
+	StringInterner& operator=(const StringInterner&) = delete;
+
+	// The interner shared by the lexer, the AST and codegen.
+	static StringInterner& Global();
+
+	SymbolId Intern(const char* text, size_t length);
+	SymbolId Intern(const std::string& text);
+
+	// kNoSymbol if the spelling was never interned.
+	SymbolId Find(const char* text, size_t length)const;
+
+	const char* GetSpelling(SymbolId id)const;
+	size_t GetLength(SymbolId id)const;
+	std::string GetString(SymbolId id)const;
+
+	// Number of distinct spellings and the arena bytes holding them.
+	size_t GetCount()const;
+	size_t GetBytesUsed()const;
+
+private:
+	struct Entry
+	{
+		const char* text;
+		uint32_t length;
+		uint32_t hash;
+	};
+
+	static uint32_t Hash(const char* text, size_t length);
+	size_t Probe(const char* text, size_t length, uint32_t hash)const;
+	void Grow();
+
+	Arena m_arena;
+	std::vector<Entry> m_entries; // indexed by id, entry 0 is kNoSymbol
+	std::vector<SymbolId> m_slots; // open addressing with linear probing, 0 is empty
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <cassert>
+#include <stdexcept>
+
+#include "AST.h"
+
+// Visitors that dispatch on the kind tag of a node instead of through
+// Accept: one switch and a static_cast per node, with Derived's Visit
+// overloads called directly, so they can be inlined and may return a value.
+// Derived defines Visit for every node class of the family, e.g.
+//
+//	class Counter : public ExpressionSwitch<Counter, size_t>
+//	{
+//	public:
+//		size_t Visit(const BinaryExpressionAST& node)
+//		{
+//			return 1 + Dispatch(node.GetLeft()) + Dispatch(node.GetRight());
+//		}
+//		...
+//	};
+//
+// Dispatch does not guard the stack; a pass over deep trees wraps it in a
+// StackGuard check, as the Accept-based passes do.
+template <typename Derived, typename Result>
+class ExpressionSwitch
+{
+public:
+	Result Dispatch(const IExpressionAST& node)
+	{
+		Derived& self = static_cast<Derived&>(*this);
+		switch (node.GetKind())
+		{
+		case ExpressionKind::Binary:
+			return self.Visit(static_cast<const BinaryExpressionAST&>(node));
+		case ExpressionKind::Literal:
+			return self.Visit(static_cast<const LiteralConstantAST&>(node));
+		case ExpressionKind::Unary:
+			return self.Visit(static_cast<const UnaryAST&>(node));
+		case ExpressionKind::Identifier:
+			return self.Visit(static_cast<const IdentifierAST&>(node));
+		case ExpressionKind::Call:
+			return self.Visit(static_cast<const FunctionCallExprAST&>(node));
+		case ExpressionKind::ArrayAccess:
+			return self.Visit(static_cast<const ArrayElementAccessAST&>(node));
+		}
+
+		assert(false);
+		throw std::logic_error("ExpressionSwitch::Dispatch() - undefined expression kind");
+	}
+
+protected:
+	~ExpressionSwitch() = default;
+};
+
+template <typename Derived, typename Result>
+class StatementSwitch
+{
+public:
+	Result Dispatch(const IStatementAST& node)
+	{
+		Derived& self = static_cast<Derived&>(*this);
+		switch (node.GetKind())
+		{
+		case StatementKind::Declaration:
+			return self.Visit(static_cast<const VariableDeclarationAST&>(node));
+		case StatementKind::Assign:
+			return self.Visit(static_cast<const AssignStatementAST&>(node));
+		case StatementKind::ArrayAssign:
+			return self.Visit(static_cast<const ArrayElementAssignAST&>(node));
+		case StatementKind::Return:
+			return self.Visit(static_cast<const ReturnStatementAST&>(node));
+		case StatementKind::If:
+			return self.Visit(static_cast<const IfStatementAST&>(node));
+		case StatementKind::While:
+			return self.Visit(static_cast<const WhileStatementAST&>(node));
+		case StatementKind::Composite:
+			return self.Visit(static_cast<const CompositeStatementAST&>(node));
+		case StatementKind::Print:
+			return self.Visit(static_cast<const PrintAST&>(node));
+		case StatementKind::CallStatement:
+			return self.Visit(static_cast<const FunctionCallStatementAST&>(node));
+		}
+
+		assert(false);
+		throw std::logic_error("StatementSwitch::Dispatch() - undefined statement kind");
+	}
+
+protected:
+	~StatementSwitch() = default;
+};
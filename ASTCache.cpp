@@ -0,0 +1,133 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ASTCache.h"
+
+namespace
+{
+uint64_t hash(const char *text, size_t size)
+{
+    // Eight bytes a step, each folded in with a multiply and a shift, and a
+    // final mix so that every input bit reaches every output bit.
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, text + i, 8);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, text + i, size - i);
+    h = (h ^ tail) * 0xFF51AFD7ED558CCDULL;
+
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+}
+
+ASTCache::Entry::Entry(void *mapping, size_t size)
+        : mapping(mapping), size(size)
+{
+}
+
+ASTCache::Entry::~Entry()
+{
+    flat.reset();
+    munmap(mapping, size);
+}
+
+ASTCache::ASTCache(const std::string &directory)
+        : directory(directory)
+{
+}
+
+std::unique_ptr<ASTCache::Entry> ASTCache::find(const std::string &key) const
+{
+    int fd = open(path(key).c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        mapping = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    std::unique_ptr<Entry> entry(new Entry(mapping, (size_t) st.st_size));
+    try
+    {
+        entry->flat.reset(new FlatAST(mapping, (size_t) st.st_size));
+    } catch (std::runtime_error &)
+    {
+        // Written by another version, or cut short; the next store
+        // replaces it.
+        return nullptr;
+    }
+    return entry;
+}
+
+bool ASTCache::store(const std::string &key, const FlatAST &tree) const
+{
+    std::string image;
+    tree.Save(image);
+
+    std::string target = path(key);
+    std::string temporary = target + "." + std::to_string(getpid()) + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    size_t written = 0;
+    while (written < image.size())
+    {
+        ssize_t n = write(fd, image.data() + written, image.size() - written);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        written += (size_t) n;
+    }
+    bool whole = close(fd) == 0 && written == image.size();
+    if (!whole || rename(temporary.c_str(), target.c_str()) != 0)
+    {
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string ASTCache::key(const char *text, size_t size)
+{
+    char name[48];
+    snprintf(name, sizeof(name), "%016llx-%zu", (unsigned long long) hash(text, size), size);
+    return name;
+}
+
+std::string ASTCache::path(const std::string &key) const
+{
+    return directory + "/" + key + ".ast";
+}
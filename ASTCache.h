@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "AST/FlatAST.h"
+
+// Syntax trees of sources seen before, kept in a directory between runs.
+// An entry is keyed by a hash and the size of the source text and holds the
+// tree as a FlatAST image. A hit maps the file, checks its rows and reads
+// them in place, so an unchanged source is neither lexed nor parsed. The
+// nodes are built from the mapping by the caller: the compiler builds the
+// whole tree, while FlatAST::BuildFunction can build one function alone.
+class ASTCache
+{
+public:
+    // A tree found in the cache, read from the file, which stays mapped
+    // while the entry lives.
+    class Entry
+    {
+    public:
+        ~Entry();
+
+        const FlatAST &tree() const;
+
+    private:
+        friend class ASTCache;
+
+        Entry(void *mapping, size_t size);
+
+        void *mapping;
+        size_t size;
+        std::unique_ptr<FlatAST> flat;
+    };
+
+    explicit ASTCache(const std::string &directory);
+
+    // Names the entry of a source text. The hash is not a cryptographic
+    // one: the cache trusts its directory.
+    static std::string key(const char *text, size_t size);
+
+    // The entry, or null if there is none, or none this build can read.
+    std::unique_ptr<Entry> find(const std::string &key) const;
+
+    // Writes the entry; false if it could not be written, which only costs
+    // a parse next time. The file appears whole or not at all, so a run
+    // that is killed, or one running alongside, never sees half of it.
+    bool store(const std::string &key, const FlatAST &tree) const;
+
+private:
+    std::string directory;
+
+    std::string path(const std::string &key) const;
+};
+
+inline const FlatAST &ASTCache::Entry::tree() const
+{
+    return *flat;
+}
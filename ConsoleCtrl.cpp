@@ -1,7 +1,16 @@
+#include <stdlib.h>
+
 #include "ConsoleCtrl.h"
 #include "Error.h"
 
 const char *ConsoleCtrl::ifile = nullptr;
+bool ConsoleCtrl::prelex = false;
+unsigned ConsoleCtrl::jobs = 1;
+bool ConsoleCtrl::stats = false;
+bool ConsoleCtrl::share = false;
+const char *ConsoleCtrl::cache = nullptr;
+unsigned ConsoleCtrl::errors = 1;
+unsigned ConsoleCtrl::stack = 1024;
 int ConsoleCtrl::argc = 0;
 const char **ConsoleCtrl::argv = nullptr;
 
@@ -24,6 +33,45 @@ void ConsoleCtrl::process(int argc, const char **argv)
         if (!strcmp("-h", arg))
         {
             help();
+        } else if (!strcmp("-prelex", arg))
+        {
+            ConsoleCtrl::prelex = true;
+        } else if (!strcmp("-stats", arg))
+        {
+            ConsoleCtrl::stats = true;
+        } else if (!strcmp("-share", arg))
+        {
+            ConsoleCtrl::share = true;
+        } else if (!strcmp("-cache", arg))
+        {
+            if (i + 1 == argc)
+            {
+                throw Error("-cache needs a directory");
+            }
+            ConsoleCtrl::cache = argv[++i];
+            ConsoleCtrl::prelex = true;
+        } else if (!strcmp("-j", arg))
+        {
+            if (i + 1 == argc || atoi(argv[i + 1]) < 1)
+            {
+                throw Error("-j needs a thread count");
+            }
+            ConsoleCtrl::jobs = (unsigned) atoi(argv[++i]);
+            ConsoleCtrl::prelex = true;
+        } else if (!strcmp("-errors", arg))
+        {
+            if (i + 1 == argc || atoi(argv[i + 1]) < 0)
+            {
+                throw Error("-errors needs a count");
+            }
+            ConsoleCtrl::errors = (unsigned) atoi(argv[++i]);
+        } else if (!strcmp("-stack", arg))
+        {
+            if (i + 1 == argc || atoi(argv[i + 1]) < 0)
+            {
+                throw Error("-stack needs a size in megabytes");
+            }
+            ConsoleCtrl::stack = (unsigned) atoi(argv[++i]);
         } else
         {
             ConsoleCtrl::ifile = arg;
@@ -38,5 +86,14 @@ void ConsoleCtrl::process(int argc, const char **argv)
 
 void ConsoleCtrl::help()
 {
-    fprintf(stderr, "Usage: compiler <filename>\n");
+    fprintf(stderr, "Usage: compiler [-prelex] [-j <threads>] [-stats] [-share] [-cache <directory>]\n"
+                    "                [-errors <count>] [-stack <megabytes>] <filename>|-\n");
+    fprintf(stderr, "  -        read the program from standard input\n");
+    fprintf(stderr, "  -prelex  lex the whole file up front, then parse\n");
+    fprintf(stderr, "  -j       lex up front and parse functions on this many threads (implies -prelex)\n");
+    fprintf(stderr, "  -stats   print the syntax tree's node count and bytes, and what folding removes\n");
+    fprintf(stderr, "  -share   build each repeated side-effect-free subexpression once\n");
+    fprintf(stderr, "  -cache   reuse the tree of an unchanged input from this directory, or keep it there (implies -prelex)\n");
+    fprintf(stderr, "  -errors  stop after this many syntax errors (default 1, 0 to report them all)\n");
+    fprintf(stderr, "  -stack   cap on the stack used for deeply nested input (default 1024, 0 for none)\n");
 }
@@ -4,6 +4,13 @@
 class ConsoleCtrl {
 public:
     static const char *ifile;
+    static bool prelex;     // lex the whole file before parsing
+    static unsigned jobs;   // threads for lexing a pre-lexed file and parsing its functions
+    static bool stats;      // report the size of the syntax tree and what folds
+    static bool share;      // build repeated subexpressions once
+    static const char *cache;   // directory keeping parsed trees between runs, or null
+    static unsigned errors; // syntax errors to report before giving up, 0 for all
+    static unsigned stack;  // megabytes of extra stack for deep nesting, 0 for no cap
     static void process(int argc, const char **argv);
 
 private:
@@ -13,6 +13,11 @@ const char *Error::what() const throw()
     return this->str;
 }
 
+SourceError::SourceError(const char *description)
+        : Error(description)
+{
+}
+
 void error(const char *fmt, ...)
 {
     va_list ap;
@@ -26,7 +31,7 @@ void error(const char *fmt, ...)
     char *ret;
     asprintf(&ret, "[Error]%s:Line %d: %s\n", ConsoleCtrl::ifile, Lexer::line, str);
     
-    throw Error(ret);
+    throw SourceError(ret);
 }
 
 void warnning(const char *fmt, ...)
@@ -12,6 +12,14 @@ protected:
     const char *str;
 };
 
+// What error() throws: a problem at the current line of the input. The
+// parser can record it and carry on with the next statement.
+class SourceError : public Error {
+public:
+
+    SourceError(const char *description);
+};
+
 extern void error(const char *fmt, ...);
 extern void warnning(const char *fmt, ...);
 
@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <cstring>
+
+#include "IncrementalLexer.h"
+#include "Lexer.h"
+#include "SourceBuffer.h"
+#include "Error.h"
+
+namespace
+{
+// Re-lexing starts with this much text and doubles it until the tokens
+// line up again.
+const size_t kMinWindow = 4096;
+
+// Moves the gap [gap, gapEnd) of column so that it starts at at.
+template<typename T>
+void shiftGap(std::vector<T> &column, size_t gap, size_t gapEnd, size_t at)
+{
+    if (at < gap)
+    {
+        std::copy_backward(column.begin() + at, column.begin() + gap, column.begin() + gapEnd);
+    } else
+    {
+        std::copy(column.begin() + gapEnd, column.begin() + gapEnd + (at - gap), column.begin() + gap);
+    }
+}
+
+// Makes the gap of column extra entries wider.
+template<typename T>
+void widenGap(std::vector<T> &column, size_t gapEnd, size_t extra)
+{
+    size_t tail = column.size() - gapEnd;
+    column.resize(column.size() + extra);
+    std::copy_backward(column.begin() + gapEnd, column.begin() + gapEnd + tail, column.end());
+}
+
+// Positions that cross the gap switch between being absolute and being
+// measured back from the end of the text; the conversion is its own inverse.
+void flip(std::vector<uint32_t> &column, size_t from, size_t to, size_t textSize)
+{
+    for (size_t i = from; i < to; i++)
+    {
+        column[i] = static_cast<uint32_t>(textSize - column[i]);
+    }
+}
+}
+
+IncrementalLexer::IncrementalLexer(const char *text, size_t size)
+        : textGap(size), textGapEnd(size + kMinWindow),
+          tokenGap(0), tokenGapEnd(0),
+          lineGap(0), lineGapEnd(0)
+{
+    if (size > UINT32_MAX)
+    {
+        throw Error(fmtstr("Input of %zu bytes is too large for incremental lexing", size));
+    }
+
+    buffer.resize(size + kMinWindow);
+    memcpy(buffer.data(), text, size);
+
+    lines.push_back(0);
+    for (size_t i = 0; i < size; i++)
+    {
+        if (text[i] == '\n')
+        {
+            lines.push_back(static_cast<uint32_t>(i + 1));
+        }
+    }
+    lineGap = lineGapEnd = lines.size();
+
+    relex(0, 0);
+}
+
+IncrementalLexer::Change IncrementalLexer::edit(size_t at, size_t removed, const char *text, size_t length)
+{
+    size_t oldSize = textSize();
+    if (at > oldSize || removed > oldSize - at)
+    {
+        throw Error(fmtstr("Edit of %zu bytes at %zu is outside the %zu byte buffer", removed, at, oldSize));
+    }
+    if (oldSize - removed + length > UINT32_MAX)
+    {
+        throw Error("Edit makes the buffer too large for incremental lexing");
+    }
+
+    // A token that ends right where the edit starts can still grow into it,
+    // so re-lexing starts at the first token that reaches the edit, from the
+    // end of the one before it.
+    Change change;
+    change.first = tokenAt(at);
+    change.firstLine = lineAfter(at);
+    size_t from = change.first ? offset(change.first - 1) + this->length(change.first - 1) : 0;
+    moveTokenGap(change.first, 0);
+    moveLineGap(change.firstLine, 0);
+
+    std::string old;
+    copyText(at, at + removed, old);
+    moveTextGap(at, length);
+    textGapEnd += removed;
+    memcpy(&buffer[textGap], text, length);
+    textGap += length;
+
+    size_t kept;
+    try
+    {
+        kept = relex(from, at + length);
+    } catch (...)
+    {
+        // Put the text back so the buffer and its tokens still agree.
+        tokenGap = change.first;
+        textGap -= length;
+        moveTextGap(at, old.size());
+        memcpy(&buffer[textGap], old.data(), old.size());
+        textGap += old.size();
+        throw;
+    }
+    change.inserted = tokenGap - change.first;
+    change.removed = tags.size() - kept - tokenGapEnd;
+    tokenGapEnd = tags.size() - kept;
+
+    // Line starts inside what was removed go. Those after it kept their
+    // distance from the end, so the comparison is made on distances.
+    size_t tail = textSize() - (at + length);
+    change.removedLines = 0;
+    while (lineGapEnd < lines.size() && lines[lineGapEnd] >= tail)
+    {
+        lineGapEnd++;
+        change.removedLines++;
+    }
+
+    size_t newlines = std::count(text, text + length, '\n');
+    moveLineGap(lineGap, newlines);
+    for (size_t i = 0; i < length; i++)
+    {
+        if (text[i] == '\n')
+        {
+            lines[lineGap++] = static_cast<uint32_t>(at + i + 1);
+        }
+    }
+    change.insertedLines = newlines;
+
+    return change;
+}
+
+// Lexes from the token boundary at from, keeping the old tokens once a new
+// one starts where an old one did, past editEnd. Returns how many slots at
+// the end of the token arrays still hold old tokens to keep.
+size_t IncrementalLexer::relex(size_t from, size_t editEnd)
+{
+    int savedLine = Lexer::line;
+    size_t end = textSize();
+    size_t next = tokenGapEnd;      // first old token not yet passed
+    size_t span = std::max(kMinWindow, 2 * (editEnd - from));
+
+    for (;;)
+    {
+        size_t to = std::min(end, from + span);
+        copyText(from, to, window);
+        Lexer lexer(new SourceBuffer(window.data(), window.size()));
+
+        for (;;)
+        {
+            Token *tok = lexer.gettok();
+            size_t start = from + lexer.tokenOffset();
+            size_t length = lexer.tokenLength();
+
+            // The window cut this token short, or hid what follows it.
+            if (to < end && start + length >= to)
+            {
+                from = start;
+                break;
+            }
+
+            // Old tokens are compared by distance from the end; those from
+            // the edited stretch may lie further back than the text reaches.
+            if (start >= editEnd)
+            {
+                while (next < tags.size() && positions[next] > end - start)
+                {
+                    next++;
+                }
+                if (next < tags.size() && positions[next] == end - start)
+                {
+                    Lexer::line = savedLine;
+                    return tags.size() - next;
+                }
+            }
+
+            Value value;
+            value.integer = 0;
+            if (tok->tag == Tag::NUM)
+            {
+                value.integer = static_cast<Num *>(tok)->value;
+            } else if (tok->tag == Tag::REAL)
+            {
+                value.real = static_cast<Real *>(tok)->value;
+            } else if (tok->tag >= Tag::AND)
+            {
+                value.symbol = static_cast<Word *>(tok)->symbol;
+            }
+
+            size_t fromEnd = tags.size() - next;
+            push(tok->tag, start, length, value);
+            next = tags.size() - fromEnd;
+
+            if (tok->tag == EOF)
+            {
+                Lexer::line = savedLine;
+                return 0;
+            }
+        }
+        span *= 2;
+    }
+}
+
+void IncrementalLexer::push(int tag, size_t position, size_t length, Value value)
+{
+    if (tokenGap == tokenGapEnd)
+    {
+        moveTokenGap(tokenGap, 1);
+    }
+    tags[tokenGap] = static_cast<int16_t>(tag);
+    positions[tokenGap] = static_cast<uint32_t>(position);
+    lengths[tokenGap] = static_cast<uint32_t>(length);
+    values[tokenGap] = value;
+    tokenGap++;
+}
+
+void IncrementalLexer::moveTextGap(size_t at, size_t room)
+{
+    if (textGapEnd - textGap < room)
+    {
+        size_t extra = std::max(room, textSize() / 8 + kMinWindow);
+        widenGap(buffer, textGapEnd, extra);
+        textGapEnd += extra;
+    }
+    shiftGap(buffer, textGap, textGapEnd, at);
+    textGapEnd = at + (textGapEnd - textGap);
+    textGap = at;
+}
+
+void IncrementalLexer::moveTokenGap(size_t at, size_t room)
+{
+    if (tokenGapEnd - tokenGap < room)
+    {
+        size_t extra = std::max(room, size() / 8 + 64);
+        widenGap(tags, tokenGapEnd, extra);
+        widenGap(positions, tokenGapEnd, extra);
+        widenGap(lengths, tokenGapEnd, extra);
+        widenGap(values, tokenGapEnd, extra);
+        tokenGapEnd += extra;
+    }
+
+    shiftGap(tags, tokenGap, tokenGapEnd, at);
+    shiftGap(positions, tokenGap, tokenGapEnd, at);
+    shiftGap(lengths, tokenGap, tokenGapEnd, at);
+    shiftGap(values, tokenGap, tokenGapEnd, at);
+
+    size_t width = tokenGapEnd - tokenGap;
+    if (at < tokenGap)
+    {
+        flip(positions, at + width, tokenGapEnd, textSize());
+    } else
+    {
+        flip(positions, tokenGap, at, textSize());
+    }
+    tokenGap = at;
+    tokenGapEnd = at + width;
+}
+
+void IncrementalLexer::moveLineGap(size_t at, size_t room)
+{
+    if (lineGapEnd - lineGap < room)
+    {
+        size_t extra = std::max(room, lineCount() / 8 + 64);
+        widenGap(lines, lineGapEnd, extra);
+        lineGapEnd += extra;
+    }
+
+    shiftGap(lines, lineGap, lineGapEnd, at);
+
+    size_t width = lineGapEnd - lineGap;
+    if (at < lineGap)
+    {
+        flip(lines, at + width, lineGapEnd, textSize());
+    } else
+    {
+        flip(lines, lineGap, at, textSize());
+    }
+    lineGap = at;
+    lineGapEnd = at + width;
+}
+
+void IncrementalLexer::copyText(size_t from, size_t to, std::string &out) const
+{
+    out.clear();
+    if (from < textGap)
+    {
+        out.append(&buffer[from], std::min(to, textGap) - from);
+    }
+    if (to > textGap)
+    {
+        size_t begin = std::max(from, textGap);
+        out.append(&buffer[begin + (textGapEnd - textGap)], to - begin);
+    }
+}
+
+// First token that ends at or after offset.
+size_t IncrementalLexer::tokenAt(size_t offset) const
+{
+    size_t low = 0;
+    size_t high = size() - 1;     // the EOF entry always qualifies
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (this->offset(mid) + length(mid) >= offset)
+        {
+            high = mid;
+        } else
+        {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+// Index of the first line start past offset.
+size_t IncrementalLexer::lineAfter(size_t offset) const
+{
+    size_t low = 0;
+    size_t high = lineCount();
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if (lineStart(mid + 1) > offset)
+        {
+            high = mid;
+        } else
+        {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+size_t IncrementalLexer::length(size_t i) const
+{
+    return lengths[slot(i, tokenGap, tokenGapEnd)];
+}
+
+int IncrementalLexer::line(size_t i) const
+{
+    return static_cast<int>(lineAfter(offset(i)));
+}
+
+SymbolId IncrementalLexer::symbol(size_t i) const
+{
+    return values[slot(i, tokenGap, tokenGapEnd)].symbol;
+}
+
+int64_t IncrementalLexer::intValue(size_t i) const
+{
+    return values[slot(i, tokenGap, tokenGapEnd)].integer;
+}
+
+double IncrementalLexer::realValue(size_t i) const
+{
+    return values[slot(i, tokenGap, tokenGapEnd)].real;
+}
+
+std::string IncrementalLexer::text() const
+{
+    return text(0, textSize());
+}
+
+std::string IncrementalLexer::text(size_t from, size_t to) const
+{
+    std::string out;
+    copyText(from, to, out);
+    return out;
+}
+
+size_t IncrementalLexer::lineCount() const
+{
+    return lines.size() - (lineGapEnd - lineGap);
+}
+
+size_t IncrementalLexer::lineStart(size_t n) const
+{
+    size_t i = n - 1;
+    return i < lineGap ? lines[i] : textSize() - lines[slot(i, lineGap, lineGapEnd)];
+}
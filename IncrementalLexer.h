@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Token.h"
+
+// Token stream for a buffer that is being edited. An edit re-lexes from the
+// token it touches until the new tokens line up with the old ones again, so
+// its cost follows the size of the edit rather than the size of the file.
+//
+// Text, tokens and line starts are each kept in a gap buffer with the gap at
+// the last edit. Positions after the gap are stored as distances from the
+// end of the text, which an edit further up does not change.
+class IncrementalLexer
+{
+public:
+    // What an edit did: tokens [first, first + removed) were replaced by
+    // [first, first + inserted), and likewise for line starts.
+    struct Change
+    {
+        size_t first;
+        size_t removed;
+        size_t inserted;
+        size_t firstLine;
+        size_t removedLines;
+        size_t insertedLines;
+    };
+
+    IncrementalLexer(const char *text, size_t size);
+
+    // Replaces removed bytes at offset with [text, text + length).
+    Change edit(size_t offset, size_t removed, const char *text, size_t length);
+
+    // Number of tokens, the EOF entry included.
+    size_t size() const;
+
+    int tag(size_t i) const;
+
+    size_t offset(size_t i) const;
+
+    size_t length(size_t i) const;
+
+    int line(size_t i) const;
+
+    // Only meaningful for the matching kind of token: words, Num or Real.
+    SymbolId symbol(size_t i) const;
+
+    int64_t intValue(size_t i) const;
+
+    double realValue(size_t i) const;
+
+    size_t textSize() const;
+
+    std::string text() const;
+
+    // Text of [from, to).
+    std::string text(size_t from, size_t to) const;
+
+    size_t lineCount() const;
+
+    // Offset where line n (1-based) starts.
+    size_t lineStart(size_t n) const;
+
+private:
+    union Value
+    {
+        SymbolId symbol;
+        int64_t integer;
+        double real;
+    };
+
+    // Text
+    std::vector<char> buffer;
+    size_t textGap;
+    size_t textGapEnd;
+
+    // Tokens
+    std::vector<int16_t> tags;
+    std::vector<uint32_t> positions;    // offset before the gap, distance from the end after it
+    std::vector<uint32_t> lengths;
+    std::vector<Value> values;
+    size_t tokenGap;
+    size_t tokenGapEnd;
+
+    // Line starts, stored like token positions; line 1 starts at 0
+    std::vector<uint32_t> lines;
+    size_t lineGap;
+    size_t lineGapEnd;
+
+    // Scratch copy of the text being re-lexed
+    std::string window;
+
+    size_t slot(size_t i, size_t gap, size_t gapEnd) const;
+
+    size_t tokenAt(size_t offset) const;
+
+    size_t lineAfter(size_t offset) const;
+
+    void moveTextGap(size_t at, size_t room);
+
+    void moveTokenGap(size_t at, size_t room);
+
+    void moveLineGap(size_t at, size_t room);
+
+    void copyText(size_t from, size_t to, std::string &out) const;
+
+    size_t relex(size_t from, size_t editEnd);
+
+    void push(int tag, size_t position, size_t length, Value value);
+};
+
+inline size_t IncrementalLexer::slot(size_t i, size_t gap, size_t gapEnd) const
+{
+    return i < gap ? i : i + (gapEnd - gap);
+}
+
+inline size_t IncrementalLexer::size() const
+{
+    return tags.size() - (tokenGapEnd - tokenGap);
+}
+
+inline int IncrementalLexer::tag(size_t i) const
+{
+    return i < size() ? tags[slot(i, tokenGap, tokenGapEnd)] : EOF;
+}
+
+inline size_t IncrementalLexer::textSize() const
+{
+    return buffer.size() - (textGapEnd - textGap);
+}
+
+inline size_t IncrementalLexer::offset(size_t i) const
+{
+    return i < tokenGap ? positions[i] : textSize() - positions[slot(i, tokenGap, tokenGapEnd)];
+}
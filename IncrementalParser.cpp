@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <exception>
+
+#include "IncrementalParser.h"
+#include "SourceBuffer.h"
+#include "TokenStream.h"
+#include "Error.h"
+
+namespace
+{
+// A piece that has had this many blocks reparsed is parsed whole again,
+// which lets go of the nodes the blocks replaced.
+const size_t kMaxContexts = 16;
+
+// The statement with from, somewhere in the ifs and whiles it is made of,
+// replaced by to. Nodes on the way to it are new ones in context.
+const IStatementAST *substitute(const IStatementAST *statement, const IStatementAST *from,
+                                const IStatementAST *to, ASTContext &context)
+{
+    if (statement == from)
+    {
+        return to;
+    }
+    switch (statement->GetKind())
+    {
+        case StatementKind::If:
+        {
+            auto *branch = static_cast<const IfStatementAST *>(statement);
+            auto *then = substitute(&branch->GetThenStmt(), from, to, context);
+            auto *otherwise = branch->GetElseStmt() ? substitute(branch->GetElseStmt(), from, to, context) : nullptr;
+            if (then == &branch->GetThenStmt() && otherwise == branch->GetElseStmt())
+            {
+                return statement;
+            }
+            return context.Create<IfStatementAST>(&branch->GetExpr(), then, otherwise);
+        }
+        case StatementKind::While:
+        {
+            auto *loop = static_cast<const WhileStatementAST *>(statement);
+            auto *body = substitute(&loop->GetStatement(), from, to, context);
+            if (body == &loop->GetStatement())
+            {
+                return statement;
+            }
+            return context.Create<WhileStatementAST>(&loop->GetExpr(), body);
+        }
+        default:
+            return statement;
+    }
+}
+
+// Moves a block record by tokens and its errors by errors. Both wrap
+// around, so they can be negative.
+void shift(Parser::Block &block, size_t tokens, size_t errors)
+{
+    block.begin += tokens;
+    block.end += tokens;
+    block.errors += errors;
+    block.errorsEnd += errors;
+    for (Parser::Declaration &declaration : block.declarations)
+    {
+        declaration.token += tokens;
+    }
+}
+}
+
+IncrementalParser::IncrementalParser(const char *text, size_t size)
+        : lexer(text, size), blockForm(false)
+{
+    size_t last = 0;
+    reparse(0, last);
+}
+
+size_t IncrementalParser::edit(size_t offset, size_t removed, const char *text, size_t length)
+{
+    IncrementalLexer::Change change = lexer.edit(offset, removed, text, length);
+
+    // A piece's parse depends on its own tokens and, where error recovery
+    // stopped in front of it, on the token after it; so the reparse starts
+    // with the piece holding the token before the change.
+    auto byBegin = [](size_t token, const Piece &piece) { return token < piece.begin; };
+    size_t before = change.first == 0 ? 0 : change.first - 1;
+    size_t first = std::upper_bound(pieces.begin(), pieces.end(), before, byBegin) - pieces.begin();
+    first = first == 0 ? 0 : first - 1;
+
+    // Pieces that start at or after the replaced tokens are kept; they only
+    // move by the change in the token count.
+    size_t last = first;
+    while (last < pieces.size() && (last == first || pieces[last].begin < change.first + change.removed))
+    {
+        last++;
+    }
+
+    // A program that turns into a single block, or back, is parsed anew.
+    bool form = lexer.tag(0) == '{';
+    if (form != blockForm)
+    {
+        first = 0;
+        last = pieces.size();
+    }
+    for (size_t k = last; k < pieces.size(); k++)
+    {
+        pieces[k].begin = pieces[k].begin + change.inserted - change.removed;
+        pieces[k].end = pieces[k].end + change.inserted - change.removed;
+    }
+
+    // Running out of input repeats the error before it only once, so the
+    // last piece depends on the errors in front of it too.
+    bool lastKept = last < pieces.size();
+    std::string lastError = lastKept ? lastDiagnostic(pieces.size() - 1) : std::string();
+
+    // An input the parser gives up on still leaves the pieces in order, so
+    // the rest of the edit is done before the failure is passed on.
+    std::exception_ptr failure;
+    size_t reparsed = 0;
+    try
+    {
+        if (form != blockForm || last != first + 1 || !reparseBlock(first, change, reparsed))
+        {
+            reparsed = reparse(first, last);
+        }
+    } catch (...)
+    {
+        failure = std::current_exception();
+    }
+
+    // Diagnostics carry line numbers; kept pieces that have any are
+    // reparsed when the lines before them moved.
+    if (change.insertedLines != change.removedLines)
+    {
+        for (size_t k = last; k < pieces.size();)
+        {
+            size_t next = k + 1;
+            if (!pieces[k].diagnostics.empty())
+            {
+                try
+                {
+                    reparsed += reparse(k, next);
+                } catch (...)
+                {
+                    failure = failure ? failure : std::current_exception();
+                }
+            }
+            k = next;
+        }
+    }
+
+    // Only a function that is still open at EOF can have left an error out.
+    if (lastKept && !pieces.back().function && lastDiagnostic(pieces.size() - 1) != lastError)
+    {
+        size_t k = pieces.size() - 1;
+        size_t next = pieces.size();
+        try
+        {
+            reparsed += reparse(k, next);
+        } catch (...)
+        {
+            failure = failure ? failure : std::current_exception();
+        }
+    }
+
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+    return reparsed;
+}
+
+std::vector<std::string> IncrementalParser::diagnostics() const
+{
+    std::vector<std::string> out;
+    for (const Piece &piece : pieces)
+    {
+        out.insert(out.end(), piece.diagnostics.begin(), piece.diagnostics.end());
+    }
+    return out;
+}
+
+// First token of a piece; one past the last piece is the EOF entry.
+size_t IncrementalParser::start(size_t piece) const
+{
+    return piece < pieces.size() ? pieces[piece].begin : lexer.size() - 1;
+}
+
+// The error a parse from the start has recorded last when it reaches the
+// piece, or an empty string.
+std::string IncrementalParser::lastDiagnostic(size_t piece) const
+{
+    while (piece > 0)
+    {
+        piece--;
+        if (!pieces[piece].diagnostics.empty())
+        {
+            return pieces[piece].diagnostics.back();
+        }
+    }
+    return std::string();
+}
+
+// Parses the tokens of pieces [first, last) again, taking in more pieces
+// until the tokens close every brace they open, and puts the new pieces in
+// their place. Leaves last at the first piece after the new ones and
+// returns how many tokens were parsed.
+size_t IncrementalParser::reparse(size_t first, size_t &last)
+{
+    size_t begin = pieces.empty() ? 0 : start(first);
+    blockForm = lexer.tag(0) == '{';
+
+    // Cuts are made where Parser::parseShares makes them, after a '}' that
+    // closes the outermost brace: a parse of the whole file is between two
+    // functions there too. A block program is one piece, which edit() only
+    // parses whole.
+    int depth = 0;
+    bool closed = true;
+    size_t end = begin;
+    for (;;)
+    {
+        for (; end < start(last); end++)
+        {
+            int tag = lexer.tag(end);
+            closed = false;
+            if (tag == '{')
+            {
+                depth++;
+            } else if (tag == '}' && depth > 0 && --depth == 0)
+            {
+                closed = true;
+            }
+        }
+        if ((closed && !blockForm) || last == pieces.size())
+        {
+            break;
+        }
+        last++;
+    }
+
+    size_t from = lexer.offset(begin);
+    size_t to = end < lexer.size() - 1 ? lexer.offset(end) : lexer.textSize();
+    std::string text = lexer.text(from, to);
+    TokenStream stream(new SourceBuffer(text.data(), text.size()), 1, lexer.line(begin));
+    if (stream.size() - 1 != end - begin)
+    {
+        throw Error(fmtstr("Reparsing %zu tokens at %zu gave %zu", end - begin, begin, stream.size() - 1));
+    }
+
+    auto context = std::make_shared<ASTContext>();
+    Parser parser(&stream, *context);
+    parser.maxErrors = 0;
+    std::vector<Parser::Block> blocks;
+    parser.blocks = &blocks;
+
+    // Running out of input repeats the error before it only once, even when
+    // that error belongs to a piece in front.
+    size_t seen = 0;
+    std::string previous = lastDiagnostic(first);
+    if (!previous.empty())
+    {
+        parser.diagnostics.push_back(previous);
+        seen = 1;
+    }
+
+    // The compiler takes a program that opens with '{' as that block and
+    // ignores what follows it.
+    std::vector<Piece> parsed;
+    try
+    {
+        while (parser.look->tag != EOF && (!blockForm || parsed.empty()))
+        {
+            Piece piece;
+            size_t at = parser.pos - 1;
+            piece.begin = begin + at;
+            if (blockForm)
+            {
+                piece.function = nullptr;
+                piece.body = parser.stmt();
+                piece.end = end;
+            } else
+            {
+                piece.function = parser.topFunction();
+                piece.body = piece.function ? &piece.function->GetStatement() : nullptr;
+                piece.end = begin + parser.pos - 1;
+            }
+            piece.contexts.push_back(context);
+            piece.diagnostics.assign(parser.diagnostics.begin() + seen, parser.diagnostics.end());
+            for (Parser::Block &block : blocks)
+            {
+                shift(block, 0 - at, 0 - seen);
+            }
+            piece.blocks.swap(blocks);
+            blocks.clear();
+            seen = parser.diagnostics.size();
+            parsed.push_back(std::move(piece));
+        }
+    } catch (std::exception &e)
+    {
+        // Keep the tokens covered, so that the next edit tries again.
+        Piece piece;
+        piece.begin = parsed.empty() ? begin : parsed.back().end;
+        piece.end = end;
+        piece.function = nullptr;
+        piece.body = nullptr;
+        piece.diagnostics.assign(parser.diagnostics.begin() + seen, parser.diagnostics.end());
+        piece.diagnostics.push_back(e.what() ? e.what() : "");
+        parsed.push_back(std::move(piece));
+        replace(first, last, parsed);
+        last = first + parsed.size();
+        throw;
+    }
+
+    size_t count = parsed.size();
+    replace(first, last, parsed);
+    last = first + count;
+    return end - begin;
+}
+
+// Parses the innermost block of the piece around the changed tokens again,
+// if their braces still pair up as before, and puts it in place of the old
+// one. Returns false, with nothing changed, where the piece has to be
+// parsed whole instead.
+bool IncrementalParser::reparseBlock(size_t index, const IncrementalLexer::Change &change, size_t &reparsed)
+{
+    Piece &piece = pieces[index];
+    if (!piece.body || piece.contexts.size() >= kMaxContexts || change.first <= piece.begin)
+    {
+        return false;
+    }
+    size_t first = change.first - piece.begin;
+    size_t delta = change.inserted - change.removed;
+
+    // Nothing after the block of a block program is parsed.
+    if (blockForm && first >= piece.blocks.front().end)
+    {
+        piece.end += delta;
+        reparsed = 0;
+        return true;
+    }
+
+    // Blocks are recorded in the order they open: the last one to open
+    // before the change holds it, or is inside the one that does.
+    auto opened = std::partition_point(piece.blocks.begin(), piece.blocks.end(),
+                                       [first](const Parser::Block &block) { return block.begin < first; });
+    size_t edited = opened == piece.blocks.begin() ? Parser::kNoBlock : opened - piece.blocks.begin() - 1;
+    while (edited != Parser::kNoBlock && piece.blocks[edited].end - 1 < first + change.removed)
+    {
+        edited = piece.blocks[edited].parent;
+    }
+    if (edited == Parser::kNoBlock)
+    {
+        return false;
+    }
+    const Parser::Block &old = piece.blocks[edited];
+
+    // Errors carry line numbers: those after the block must stay where
+    // they were.
+    if (change.insertedLines != change.removedLines && old.errorsEnd != piece.diagnostics.size())
+    {
+        return false;
+    }
+
+    // With the braces between its own balanced, a parse of the block ends
+    // at its '}' and leaves the rest of the function as it was.
+    size_t begin = piece.begin + old.begin;
+    size_t end = piece.begin + old.end + delta;
+    int depth = 0;
+    for (size_t k = begin + 1; k + 1 < end; k++)
+    {
+        int tag = lexer.tag(k);
+        if (tag == '{')
+        {
+            depth++;
+        } else if (tag == '}' && --depth < 0)
+        {
+            return false;
+        }
+    }
+    if (depth != 0)
+    {
+        return false;
+    }
+
+    size_t from = lexer.offset(begin);
+    size_t to = end < lexer.size() - 1 ? lexer.offset(end) : lexer.textSize();
+    std::string text = lexer.text(from, to);
+    TokenStream stream(new SourceBuffer(text.data(), text.size()), 1, lexer.line(begin));
+    if (stream.size() - 1 != end - begin)
+    {
+        return false;
+    }
+
+    auto context = std::make_shared<ASTContext>();
+    Parser parser(&stream, *context);
+    parser.maxErrors = 0;
+    std::vector<Parser::Block> blocks;
+    parser.blocks = &blocks;
+
+    // The variables in scope at its '{': the parameters, then what each
+    // block around it declared before it, each block in a scope of its own.
+    if (piece.function)
+    {
+        parser.env.enter();
+        for (const FunctionAST::Param &param : piece.function->GetParams())
+        {
+            parser.env.put(param.first, param.second);
+        }
+    }
+    std::vector<size_t> around;
+    for (size_t k = old.parent; k != Parser::kNoBlock; k = piece.blocks[k].parent)
+    {
+        around.push_back(k);
+    }
+    for (auto k = around.rbegin(); k != around.rend(); ++k)
+    {
+        parser.env.enter();
+        for (const Parser::Declaration &declaration : piece.blocks[*k].declarations)
+        {
+            if (declaration.token > old.begin)
+            {
+                break;
+            }
+            parser.env.put(declaration.name, declaration.type);
+        }
+    }
+
+    const IStatementAST *statement = nullptr;
+    try
+    {
+        statement = parser.stmt();
+    } catch (std::exception &)
+    {
+        return false;
+    }
+    if (parser.look->tag != EOF)
+    {
+        return false;
+    }
+
+    // The blocks around it get new nodes, each holding the new one below
+    // it; the statements beside them are shared with the old tree.
+    const IStatementAST *replaced = old.statement;
+    for (size_t inner = edited, outer = old.parent; outer != Parser::kNoBlock;
+         inner = outer, outer = piece.blocks[outer].parent)
+    {
+        Parser::Block &block = piece.blocks[outer];
+        std::vector<const IStatementAST *> statements;
+        for (size_t k = 0; k < block.statement->GetCount(); k++)
+        {
+            statements.push_back(&block.statement->GetStatement(k));
+        }
+        size_t slot = piece.blocks[inner].statements - block.statements;
+        statements[slot] = substitute(statements[slot], replaced, statement, *context);
+        replaced = block.statement;
+        auto composite = context->Create<CompositeStatementAST>(context->CreateList(statements.data(), statements.size()),
+                                                                statements.size());
+        block.statement = composite;
+        statement = composite;
+    }
+    if (piece.function)
+    {
+        size_t position = 0;
+        for (size_t k = 0; k < index; k++)
+        {
+            position += pieces[k].function != nullptr;
+        }
+        const FunctionAST *function = context->Create<FunctionAST>(
+                piece.function->GetReturnType(), &piece.function->GetIdentifier(),
+                std::vector<FunctionAST::Param>(piece.function->GetParams()), statement);
+        tree.ReplaceFunctions(position, 1, &function, 1);
+        piece.function = function;
+    }
+    piece.body = statement;
+
+    // The errors and block records of the block are replaced; those after
+    // it move, and the blocks around it grow.
+    size_t errors = parser.diagnostics.size() - (old.errorsEnd - old.errors);
+    piece.diagnostics.erase(piece.diagnostics.begin() + old.errors, piece.diagnostics.begin() + old.errorsEnd);
+    piece.diagnostics.insert(piece.diagnostics.begin() + old.errors, parser.diagnostics.begin(),
+                             parser.diagnostics.end());
+
+    size_t inside = edited + 1;
+    while (inside < piece.blocks.size() && piece.blocks[inside].begin < old.end)
+    {
+        inside++;
+    }
+    size_t records = blocks.size() - (inside - edited);
+    for (size_t k = 0; k < piece.blocks.size(); k++)
+    {
+        Parser::Block &block = piece.blocks[k];
+        if (k >= inside)
+        {
+            shift(block, delta, errors);
+            block.parent += block.parent != Parser::kNoBlock && block.parent >= inside ? records : 0;
+        } else if (block.begin < old.begin && block.end >= old.end)
+        {
+            block.end += delta;
+            block.errorsEnd += errors;
+            for (Parser::Declaration &declaration : block.declarations)
+            {
+                declaration.token += declaration.token > old.begin ? delta : 0;
+            }
+        }
+    }
+    for (Parser::Block &block : blocks)
+    {
+        block.parent = block.parent == Parser::kNoBlock ? old.parent : block.parent + edited;
+        block.statements += old.statements;
+        shift(block, old.begin, old.errors);
+    }
+    piece.blocks.erase(piece.blocks.begin() + edited, piece.blocks.begin() + inside);
+    piece.blocks.insert(piece.blocks.begin() + edited, blocks.begin(), blocks.end());
+
+    piece.end += delta;
+    piece.contexts.push_back(context);
+    reparsed = end - begin;
+    return true;
+}
+
+// Splices parsed in for pieces [first, last), in the program as well.
+void IncrementalParser::replace(size_t first, size_t last, std::vector<Piece> &parsed)
+{
+    size_t index = 0;
+    for (size_t k = 0; k < first; k++)
+    {
+        index += pieces[k].function != nullptr;
+    }
+    size_t removed = 0;
+    for (size_t k = first; k < last; k++)
+    {
+        removed += pieces[k].function != nullptr;
+    }
+    std::vector<const FunctionAST *> functions;
+    for (const Piece &piece : parsed)
+    {
+        if (piece.function)
+        {
+            functions.push_back(piece.function);
+        }
+    }
+    tree.ReplaceFunctions(index, removed, functions.data(), functions.size());
+
+    // The old pieces' contexts go with the last piece using them.
+    size_t common = std::min(last - first, parsed.size());
+    std::move(parsed.begin(), parsed.begin() + common, pieces.begin() + first);
+    if (last - first > common)
+    {
+        pieces.erase(pieces.begin() + first + common, pieces.begin() + last);
+    } else
+    {
+        pieces.insert(pieces.begin() + last, std::make_move_iterator(parsed.begin() + common),
+                      std::make_move_iterator(parsed.end()));
+    }
+}
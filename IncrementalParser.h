@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "IncrementalLexer.h"
+#include "Parser.h"
+#include "AST/AST.h"
+#include "AST/ASTContext.h"
+
+// Tree of a program that is being edited, a program of functions or a
+// single block as the compiler takes it. Each top-level function remembers
+// the tokens it was parsed from, and each {...} block in it its own tokens
+// and the variables it declared. An edit re-lexes incrementally and parses
+// again only the innermost block around the changed tokens, with the
+// variables in scope at its '{' declared up front; the blocks around it and
+// the function get new nodes that take it in place of the old one, and
+// every other statement is kept as is.
+//
+// Where the braces no longer pair up as they did, the edit is outside every
+// block, or the errors after the block move to other lines, the functions
+// the edit touched are parsed whole: nothing in one function depends on
+// another.
+class IncrementalParser
+{
+public:
+    IncrementalParser(const char *text, size_t size);
+
+    // Replaces removed bytes at offset with [text, text + length) and brings
+    // the tree up to date. Returns how many tokens were reparsed.
+    size_t edit(size_t offset, size_t removed, const char *text, size_t length);
+
+    // Functions of the program; none if it is a single block.
+    const ProgramAST &program() const;
+
+    // The block a program that opens with '{' is, or null.
+    const IStatementAST *block() const;
+
+    // Errors recovered from, in source order, as a full parse reports them.
+    std::vector<std::string> diagnostics() const;
+
+    const IncrementalLexer &tokens() const;
+
+private:
+    // Tokens consumed by one Parser::topFunction call, or the tokens of a
+    // block program. Pieces follow each other without gaps up to the EOF
+    // entry.
+    struct Piece
+    {
+        size_t begin;
+        size_t end;
+        const FunctionAST *function;            // null where the tokens made none
+        const IStatementAST *body;              // the function's, or the block program
+        std::vector<Parser::Block> blocks;      // tokens counted from begin,
+                                                // errors from the piece's first
+        std::vector<std::shared_ptr<ASTContext>> contexts; // hold the nodes
+        std::vector<std::string> diagnostics;
+    };
+
+    IncrementalLexer lexer;
+    std::vector<Piece> pieces;
+    ProgramAST tree;
+    bool blockForm;     // the program is a single block
+
+    size_t start(size_t piece) const;
+
+    std::string lastDiagnostic(size_t piece) const;
+
+    size_t reparse(size_t first, size_t &last);
+
+    bool reparseBlock(size_t piece, const IncrementalLexer::Change &change, size_t &reparsed);
+
+    void replace(size_t first, size_t last, std::vector<Piece> &parsed);
+};
+
+inline const ProgramAST &IncrementalParser::program() const
+{
+    return tree;
+}
+
+inline const IStatementAST *IncrementalParser::block() const
+{
+    return blockForm && !pieces.empty() ? pieces.front().body : nullptr;
+}
+
+inline const IncrementalLexer &IncrementalParser::tokens() const
+{
+    return lexer;
+}
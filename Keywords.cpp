@@ -0,0 +1,90 @@
+#include "Keywords.h"
+
+namespace
+{
+struct Reserved
+{
+    const char *text;
+    unsigned length;
+    int tag;
+};
+
+constexpr Reserved reserved[] = {
+        {"if",    2, Tag::IF},
+        {"else",  4, Tag::ELSE},
+        {"while", 5, Tag::WHILE},
+        {"do",    2, Tag::DO},
+        {"break", 5, Tag::BREAK},
+        {"return", 6, Tag::RETURN},
+        {"void",  4, Tag::VOID},
+        {"true",  4, Tag::TRUE},
+        {"false", 5, Tag::FALSE},
+        {"int",   3, Tag::BASIC},
+        {"float", 5, Tag::BASIC},
+        {"char",  4, Tag::BASIC},
+        {"bool",  4, Tag::BASIC},
+};
+
+constexpr unsigned kReserved = sizeof(reserved) / sizeof(reserved[0]);
+
+constexpr uint64_t pack(const char *s, unsigned n)
+{
+    return n == 0 ? 0 : (uint64_t) (unsigned char) s[n - 1] << (8 * (n - 1)) | pack(s, n - 1);
+}
+
+constexpr unsigned slotOf(unsigned i)
+{
+    return Keywords::hash(reserved[i].length, reserved[i].text[0], reserved[i].text[reserved[i].length - 1]);
+}
+
+constexpr Keywords::Entry entryFor(unsigned slot, unsigned i = 0)
+{
+    return i == kReserved ? Keywords::Entry{0, 0, 0}
+                          : slotOf(i) == slot ? Keywords::Entry{pack(reserved[i].text, reserved[i].length),
+                                                                reserved[i].length, reserved[i].tag}
+                                              : entryFor(slot, i + 1);
+}
+
+constexpr bool collides(unsigned i, unsigned j)
+{
+    return j == kReserved ? false : slotOf(i) == slotOf(j) || collides(i, j + 1);
+}
+
+constexpr bool perfect(unsigned i = 0)
+{
+    return i == kReserved ? true : !collides(i, i + 1) && perfect(i + 1);
+}
+
+constexpr bool fits(unsigned i = 0)
+{
+    return i == kReserved ? true : reserved[i].length <= Keywords::kMaxLength && fits(i + 1);
+}
+
+static_assert(kReserved <= Keywords::kSlots, "more keywords than hash slots");
+static_assert(fits(), "keyword longer than the packed compare allows");
+static_assert(perfect(), "keyword hash collides; retune the multipliers in Keywords::hash");
+}
+
+const Keywords::Entry Keywords::table[kSlots] = {
+        entryFor(0), entryFor(1), entryFor(2), entryFor(3),
+        entryFor(4), entryFor(5), entryFor(6), entryFor(7),
+        entryFor(8), entryFor(9), entryFor(10), entryFor(11),
+        entryFor(12), entryFor(13), entryFor(14), entryFor(15),
+        entryFor(16), entryFor(17), entryFor(18), entryFor(19),
+        entryFor(20), entryFor(21), entryFor(22), entryFor(23),
+        entryFor(24), entryFor(25), entryFor(26), entryFor(27),
+        entryFor(28), entryFor(29), entryFor(30), entryFor(31),
+};
+
+int Keywords::find(const char *s)
+{
+    size_t n = strlen(s);
+    if (n == 0 || n > kMaxLength)
+    {
+        return -1;
+    }
+
+    char padded[kMaxLength] = {};
+    memcpy(padded, s, n);
+    return find(padded, n);
+}
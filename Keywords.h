@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "Token.h"
+
+// Perfect hash over the reserved words, keyed on length plus the first and
+// last characters. The table is generated at compile time (Keywords.cpp) and
+// a static_assert there rejects any keyword set the hash cannot separate.
+class Keywords
+{
+public:
+    static const unsigned kSlots = 32;
+    static const unsigned kMaxLength = 8;
+
+    struct Entry
+    {
+        uint64_t word;      // spelling packed little-endian, zero filled
+        unsigned length;    // 0 for an empty slot
+        int tag;
+    };
+
+    static constexpr unsigned hash(size_t length, char first, char last)
+    {
+        return (unsigned) (length + 2u * (unsigned char) first + 6u * (unsigned char) last) & (kSlots - 1);
+    }
+
+    // Slot of the reserved word spelled by [p, p + n), or -1. Reads 8 bytes
+    // from p, so it must only be used on padded source buffers.
+    static int find(const char *p, size_t n);
+
+    // Same as find() for a NUL-terminated string; no read-ahead.
+    static int find(const char *s);
+
+    static const Entry table[kSlots];
+};
+
+inline int Keywords::find(const char *p, size_t n)
+{
+    if (n > kMaxLength)
+    {
+        return -1;
+    }
+
+    unsigned slot = hash(n, p[0], p[n - 1]);
+
+    uint64_t word;
+    memcpy(&word, p, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    uint64_t mask = n == 8 ? ~uint64_t(0) : (uint64_t(1) << (8 * n)) - 1;
+
+    const Entry &e = table[slot];
+    return (e.length == n) & ((word & mask) == e.word) ? (int) slot : -1;
+}
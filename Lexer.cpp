@@ -1,27 +1,31 @@
 #include "Lexer.h"
+#include "NumberScanner.h"
 #include "ConsoleCtrl.h"
+#include "SourceBuffer.h"
 #include "Error.h"
 
-using std::string;
-using std::ifstream;
-
-#define kBufSize    4096
-
-int Lexer::line = 0;
+thread_local int Lexer::line = 0;
 
 Lexer::Lexer()
+        : Lexer(SourceBuffer::stream(ConsoleCtrl::ifile))
 {
-    ifs = new ifstream(ConsoleCtrl::ifile);
-    if (!ifs->good())
-    {
-        throw Error(fmtstr("Cannot open file \"%s\"", ConsoleCtrl::ifile));
-    }
+}
+
+Lexer::Lexer(SourceBuffer *source)
+        : Lexer(source, StringInterner::Global())
+{
+}
 
-    reserve(new Word("if", Tag::IF));
-    reserve(new Word("else", Tag::ELSE));
-    reserve(new Word("while", Tag::WHILE));
-    reserve(new Word("do", Tag::DO));
-    reserve(new Word("break", Tag::BREAK));
+Lexer::Lexer(SourceBuffer *source, StringInterner &names)
+        : tokens(), keywords(), source(source), names(names)
+{
+    reserve(make<Word>("if", Tag::IF));
+    reserve(make<Word>("else", Tag::ELSE));
+    reserve(make<Word>("while", Tag::WHILE));
+    reserve(make<Word>("do", Tag::DO));
+    reserve(make<Word>("break", Tag::BREAK));
+    reserve(make<Word>("return", Tag::RETURN));
+    reserve(make<Word>("void", Tag::VOID));
 
     reserve(Word::True);
     reserve(Word::False);
@@ -30,58 +34,73 @@ Lexer::Lexer()
     reserve(Type::Char);
     reserve(Type::Bool);
 
-    buffer = new char[kBufSize + 1];
-    pCurrent = buffer;
-    buffer[kBufSize] = EOF;
+    pCurrent = source->begin();
+    pEnd = source->end();
+    pToken = pCurrent;
     peek = ' ';
     line = 1;
+}
 
-    fillBuffer();
+Lexer::~Lexer()
+{
+    delete source;
 }
 
 void Lexer::reserve(Word *w)
 {
-    words[w->lexme] = w;
+    keywords[Keywords::find(w->lexme)] = w;
 }
 
-void Lexer::fillBuffer()
+size_t Lexer::tokenOffset() const
 {
-    if (ifs->eof())
-    {
-        return;
-    }
-
-    char *pbuf = buffer;
-    pCurrent = buffer;
-    ifs->read(pbuf, kBufSize);
-
-    if (ifs->eof())
-    {
-
-        pbuf[ifs->gcount()] = EOF;
+    return pToken - source->begin() + source->consumed();
+}
 
-        ifs->close();
-    } else
+size_t Lexer::tokenLength() const
+{
+    // After a token peek holds either the character that ended it, already
+    // consumed, or the ' ' left behind when nothing was read ahead.
+    if (pCurrent == pToken || (peek == EOF && pCurrent >= pEnd) || (peek == ' ' && pCurrent[-1] != ' '))
     {
-
-
+        return pCurrent - pToken;
     }
+    return pCurrent - 1 - pToken;
 }
 
 void Lexer::readch()
 {
-    if (*pCurrent == EOF)
+    // The source is zero padded, so only a '\0' can mean we ran off the end.
+    char c = *pCurrent;
+    if (c == '\0' && pCurrent >= pEnd)
     {
-        fillBuffer();
+        if (!refill())
+        {
+            peek = EOF;
+            return;
+        }
+        c = *pCurrent;
     }
+    peek = c;
+    pCurrent++;
+}
 
-    if (*pCurrent == EOF)
-    {
-        peek = EOF;
-    } else
+bool Lexer::refill()
+{
+    // A streamed source ends its window at a line end and no token spans
+    // lines, so only the token in hand and the character before pCurrent,
+    // which tokenLength() looks at, have to be kept.
+    const char *keep = pCurrent > source->begin() && pCurrent - 1 < pToken ? pCurrent - 1 : pToken;
+    const char *kept = source->refill(keep);
+    if (kept == nullptr)
     {
-        peek = *pCurrent++;
+        return false;
     }
+
+    pCurrent = kept + (pCurrent - keep);
+    pToken = kept + (pToken - keep);
+    pEnd = source->end();
+    scan.reset();
+    return pCurrent < pEnd;
 }
 
 bool Lexer::readch(char c)
@@ -97,20 +116,22 @@ bool Lexer::readch(char c)
 
 Token *Lexer::gettok()
 {
-    for (;; readch())
+    // The last token is done with, so a refill need not keep it. Blanks
+    // can run on into the next window of a stream, hence the loop.
+    pToken = pCurrent;
+    while (peek == ' ' || peek == '\t' || peek == '\n')
     {
-        if (peek == ' ' || peek == '\t')
-        {
-            continue;
-        } else if (peek == '\n')
+        if (peek == '\n')
         {
             line++;
-        } else
-        {
-            break;
         }
+        pCurrent = scan.skipBlanks(pCurrent, line);
+        readch();
     }
 
+    // peek has already been read, so the token starts one character back.
+    pToken = peek == EOF && pCurrent >= pEnd ? pCurrent : pCurrent - 1;
+
     switch (peek)
     {
         case '&':
@@ -119,7 +140,7 @@ Token *Lexer::gettok()
                 return Word::And;
             } else
             {
-                return new Token('&');
+                return Token::single('&');
             }
 
         case '|':
@@ -128,7 +149,7 @@ Token *Lexer::gettok()
                 return Word::Or;
             } else
             {
-                return new Token('|');
+                return Token::single('|');
             }
 
         case '=':
@@ -137,7 +158,7 @@ Token *Lexer::gettok()
                 return Word::Eq;
             } else
             {
-                return new Token('=');
+                return Token::single('=');
             }
 
         case '!':
@@ -146,7 +167,7 @@ Token *Lexer::gettok()
                 return Word::Ne;
             } else
             {
-                return new Token('!');
+                return Token::single('!');
             }
 
         case '>':
@@ -155,7 +176,7 @@ Token *Lexer::gettok()
                 return Word::Ge;
             } else
             {
-                return new Token('>');
+                return Token::single('>');
             }
 
         case '<':
@@ -164,7 +185,7 @@ Token *Lexer::gettok()
                 return Word::Le;
             } else
             {
-                return new Token('<');
+                return Token::single('<');
             }
         default:break;
     }
@@ -172,31 +193,26 @@ Token *Lexer::gettok()
     if (isdigit(peek))
     {
 
-        int v = 0;
+        // Find the whole literal first, then convert it in one go.
+        const char *start = pCurrent - 1;
+        pCurrent = scan.skipDigits(pCurrent);
 
-        do
+        if (*pCurrent != '.')
         {
-            v = 10 * v + (peek - '0');
+            int64_t v = 0;
+            if (!NumberScanner::parseInteger(start, pCurrent, v))
+            {
+                error("integer constant %.*s is too large", (int) (pCurrent - start), start);
+            }
             readch();
-        } while (isdigit(peek));
-
-        if (peek != '.')
-        {
-            return new Num(v);
+            return make<Num>(v);
         } else
         {
-            float x = v;
-            float d = 10;
-            for (;;)
-            {
-                readch();
-                if (!isdigit(peek)) break;
-
-                x = x + (peek - '0') / d;
-                d = d * 10;
-            }
-
-            return new Real(x);
+            const char *dot = pCurrent;
+            pCurrent = scan.skipDigits(pCurrent + 1);
+            double x = NumberScanner::parseReal(start, dot, pCurrent);
+            readch();
+            return make<Real>(x);
         }
 
     }
@@ -204,27 +220,36 @@ Token *Lexer::gettok()
     if (isalpha(peek))
     {
 
-        auto *s = new string();
+        // peek was the first letter; the rest of the word is still in the
+        // source, so slice it out in one go instead of growing a string.
+        const char *start = pCurrent - 1;
+        pCurrent = scan.skipIdent(pCurrent);
+        peek = ' ';
 
-        do
+        size_t length = pCurrent - start;
+
+        int slot = Keywords::find(start, length);
+        if (slot >= 0)
         {
-            s->append(&peek);
-            readch();
-        } while (isalpha(peek) || isdigit(peek));
+            return keywords[slot];
+        }
 
-        Word *w = words[s->c_str()];
-        if (w != nullptr)
+        SymbolId id = names.Intern(start, length);
+        if (id >= words.size())
         {
-            return w;
+            words.resize(id + 1, nullptr);
         }
 
-        w = new Word(s->c_str(), Tag::ID);
-        words[s->c_str()] = w;
+        Word *&w = words[id];
+        if (w == nullptr)
+        {
+            w = make<Word>(id, names.GetSpelling(id), Tag::ID);
+        }
 
         return w;
     }
 
-    auto *tok = new Token(peek);
+    Token *tok = Token::single(peek);
     peek = ' ';
 
     return tok;
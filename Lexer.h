@@ -1,37 +1,68 @@
-#include <map>
-#include <fstream>
 
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "AST/Arena.h"
 #include "Token.h"
+#include "Keywords.h"
+#include "ScanKernels.h"
 
-struct cmp_cls
-{
-    bool operator()(const char *a, const char *b) const
-    {
-        return std::strcmp(a, b) < 0;
-    }
-};
+class SourceBuffer;
 
 class Lexer
 {
 public:
-    static int line;
+    // Per thread, so chunks of one file can be lexed side by side.
+    static thread_local int line;
 
     Lexer();
 
+    // Takes ownership of the source.
+    explicit Lexer(SourceBuffer *source);
+
+    // Interns identifiers into names rather than the global interner; for
+    // lexing a chunk on another thread. Keywords still use the global one.
+    Lexer(SourceBuffer *source, StringInterner &names);
+
+    // Frees every token this lexer made in one go; single-character tokens
+    // are shared and outlive it.
+    ~Lexer();
+
     Token *gettok();
 
+    // Source span of the token gettok() returned last.
+    size_t tokenOffset() const;
+
+    size_t tokenLength() const;
+
 private:
-    std::map<const char *, Word *, cmp_cls> words;
-    std::ifstream *ifs;
-    char *buffer;
-    char *pCurrent;
+    Arena tokens;    // keyword, identifier and literal tokens
+    Word *keywords[Keywords::kSlots];
+    std::vector<Word *> words;    // identifier words, indexed by symbol
+    SourceBuffer *source;
+    StringInterner &names;
+    const char *pCurrent;
+    const char *pEnd;
+    const char *pToken;
+    ScanKernels scan;
     char peek;
 
-    void reserve(Word *w);
+    template<typename T, typename... Args>
+    T *make(Args &&... args);
 
-    void fillBuffer();
+    void reserve(Word *w);
 
     void readch();
 
     bool readch(char c);
+
+    bool refill();
 };
+
+template<typename T, typename... Args>
+inline T *Lexer::make(Args &&... args)
+{
+    // Tokens have trivial destructors, so dropping the arena is enough.
+    return new(tokens.Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
@@ -0,0 +1,158 @@
+#include <cstdlib>
+#include <string>
+
+#include "NumberScanner.h"
+
+const unsigned NumberScanner::kMaxDigits;
+
+namespace
+{
+// Powers of ten that a double holds exactly.
+const double kExactPowers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+const unsigned kMaxExactPower = sizeof(kExactPowers) / sizeof(kExactPowers[0]) - 1;
+
+#ifdef __SIZEOF_INT128__
+#define NUMBER_SCANNER_EISEL_LEMIRE 1
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+// 5^-d as a 128-bit fixed-point fraction, shifted so the top bit is set and
+// rounded up: {high, low} for d = 0..27 fraction digits. Within that range
+// the 128-bit product is always precise enough to round from.
+const uint64_t kReciprocalsOfFive[][2] = {
+        {0x8000000000000000ull, 0x0000000000000000ull},
+        {0xccccccccccccccccull, 0xcccccccccccccccdull},
+        {0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull},
+        {0x83126e978d4fdf3bull, 0x645a1cac083126eaull},
+        {0xd1b71758e219652bull, 0xd3c36113404ea4a9ull},
+        {0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull},
+        {0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull},
+        {0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull},
+        {0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull},
+        {0x89705f4136b4a597ull, 0x31680a88f8953031ull},
+        {0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull},
+        {0xafebff0bcb24aafeull, 0xf78f69a51539d749ull},
+        {0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull},
+        {0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull},
+        {0xb424dc35095cd80full, 0x538484c19ef38c95ull},
+        {0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull},
+        {0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull},
+        {0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull},
+        {0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull},
+        {0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull},
+        {0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull},
+        {0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull},
+        {0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull},
+        {0xc16d9a0095928a27ull, 0x75b7053c0f178294ull},
+        {0x9abe14cd44753b52ull, 0xc4926a9672793543ull},
+        {0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull},
+        {0xc612062576589ddaull, 0x95364afe032a819eull},
+        {0x9e74d1b791e07e48ull, 0x775ea264cf55347eull},
+};
+
+const unsigned kMaxReciprocal = sizeof(kReciprocalsOfFive) / sizeof(kReciprocalsOfFive[0]) - 1;
+
+// Eisel and Lemire's algorithm, cut down to what a literal here can be:
+// mantissa * 10^-digits with a nonzero mantissa of at most 19 digits and
+// no more than kMaxReciprocal fraction digits, which rules out subnormals,
+// infinities and the cases where it would need a fallback.
+double eiselLemire(uint64_t mantissa, unsigned digits)
+{
+    const int kExplicitBits = 52;
+    const int kMinimumExponent = -1023;
+
+    int lz = __builtin_clzll(mantissa);
+    uint64_t w = mantissa << lz;
+
+    // w * 5^-digits; the low half of the reciprocal only matters when the
+    // bits we round on could still change.
+    uint128_t product = (uint128_t) w * kReciprocalsOfFive[digits][0];
+    uint64_t high = uint64_t(product >> 64);
+    uint64_t low = uint64_t(product);
+    if ((high & 0x1FF) == 0x1FF)
+    {
+        uint64_t carry = uint64_t(((uint128_t) w * kReciprocalsOfFive[digits][1]) >> 64);
+        low += carry;
+        if (low < carry)
+        {
+            high++;
+        }
+    }
+
+    int upperBit = int(high >> 63);
+    int shift = upperBit + 64 - kExplicitBits - 3;
+    uint64_t bits = high >> shift;
+
+    // floor(log2(10^q)) + 63 for q = -digits, then the exponent bias.
+    int q = -int(digits);
+    int power2 = (((152170 + 65536) * q) >> 16) + 63 + upperBit - lz - kMinimumExponent;
+
+    // A product exactly halfway between two doubles rounds to even, so
+    // do not round up an odd result that is exactly a tie.
+    if (low <= 1 && q >= -4 && (bits & 3) == 1 && (bits << shift) == high)
+    {
+        bits &= ~uint64_t(1);
+    }
+
+    bits += bits & 1;
+    bits >>= 1;
+    if (bits >= (uint64_t(2) << kExplicitBits))
+    {
+        bits = uint64_t(1) << kExplicitBits;
+        power2++;
+    }
+    bits &= ~(uint64_t(1) << kExplicitBits);
+    bits |= uint64_t(power2) << kExplicitBits;
+
+    double result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+#endif
+}
+
+double NumberScanner::parseReal(const char *p, const char *dot, const char *end)
+{
+    const char *first = p;
+    while (first != dot && *first == '0')
+    {
+        first++;
+    }
+    size_t fractionDigits = end - (dot + 1);
+    size_t significant = (dot - first) + fractionDigits;
+
+    if (significant <= kMaxDigits)
+    {
+        uint64_t mantissa = accumulate(accumulate(0, first, dot), dot + 1, end);
+
+        // Clinger's fast path: the digits and the scale are both exact
+        // doubles, so one correctly rounded division is the answer.
+        if (fractionDigits <= kMaxExactPower && mantissa <= (uint64_t(1) << 53))
+        {
+            return (double) mantissa / kExactPowers[fractionDigits];
+        }
+
+#ifdef NUMBER_SCANNER_EISEL_LEMIRE
+        if (fractionDigits <= kMaxReciprocal)
+        {
+            return eiselLemire(mantissa, (unsigned) fractionDigits);
+        }
+#endif
+    }
+
+    // Very long literals; let the C library round them.
+    char buffer[64];
+    size_t length = end - p;
+    if (length < sizeof(buffer))
+    {
+        memcpy(buffer, p, length);
+        buffer[length] = '\0';
+        return strtod(buffer, nullptr);
+    }
+    std::string text(p, end);
+    return strtod(text.c_str(), nullptr);
+}
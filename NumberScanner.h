@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Decimal literal parsing for the lexer. Callers have already found the
+// digit runs, so these only turn them into values: integers eight digits at
+// a time with SWAR arithmetic, reals correctly rounded.
+class NumberScanner
+{
+public:
+    // Largest integer literal: INT64_MAX has 19 digits.
+    static const unsigned kMaxDigits = 19;
+
+    // Value of the digits [p, end). Returns false if it does not fit in an
+    // int64_t.
+    static bool parseInteger(const char *p, const char *end, int64_t &value);
+
+    // Value of the literal [p, end) with its '.' at dot, rounded to the
+    // nearest double. Either digit run may be empty.
+    static double parseReal(const char *p, const char *dot, const char *end);
+
+private:
+    // Value of the eight digits at p; all of them must be digits.
+    static uint64_t eightDigits(const char *p);
+
+    // Same for four digits.
+    static uint32_t fourDigits(const char *p);
+
+    // Accumulates the digits [p, end) onto value; at most kMaxDigits overall.
+    static uint64_t accumulate(uint64_t value, const char *p, const char *end);
+};
+
+inline uint64_t NumberScanner::eightDigits(const char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    // Pairwise combine neighbouring digits, then pairs of pairs, then halves:
+    // three multiplies instead of eight.
+    v -= 0x3030303030303030ull;
+    v = (v * 10) + (v >> 8);
+    v = (((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32)))
+         + (((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    return v;
+}
+
+inline uint32_t NumberScanner::fourDigits(const char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    v -= 0x30303030u;
+    v = (v * 10) + (v >> 8);
+    return ((v & 0x000000FFu) * 100) + ((v >> 16) & 0x000000FFu);
+}
+
+inline uint64_t NumberScanner::accumulate(uint64_t value, const char *p, const char *end)
+{
+    for (; end - p >= 8; p += 8)
+    {
+        value = value * 100000000u + eightDigits(p);
+    }
+    if (end - p >= 4)
+    {
+        value = value * 10000u + fourDigits(p);
+        p += 4;
+    }
+    for (; p != end; p++)
+    {
+        value = value * 10 + (uint64_t) (*p - '0');
+    }
+    return value;
+}
+
+inline bool NumberScanner::parseInteger(const char *p, const char *end, int64_t &value)
+{
+    while (end - p > 1 && *p == '0')
+    {
+        p++;
+    }
+    if (end - p > (ptrdiff_t) kMaxDigits)
+    {
+        return false;
+    }
+
+    // Nineteen digits always fit in 64 unsigned bits, so overflow can only
+    // show up as a value past INT64_MAX.
+    uint64_t v = accumulate(0, p, end);
+    if (v > (uint64_t) INT64_MAX)
+    {
+        return false;
+    }
+    value = (int64_t) v;
+    return true;
+}
@@ -1,26 +1,171 @@
+#include <algorithm>
+#include <exception>
 #include <memory>
+#include <thread>
 #include <cassert>
+#include <climits>
 #include <iostream>
 
 #include "Parser.h"
 #include "Lexer.h"
+#include "TokenStream.h"
 #include "Error.h"
 #include "ConsoleCtrl.h"
-#include "Symbol.h"
 #include "AST/AST.h"
+#include "AST/ExpressionDAG.h"
+#include "AST/StackGuard.h"
 
 
-Parser::Parser(Lexer *l)
+namespace
+{
+// Binding strength of the binary operators, loosest first; 0 means the
+// token is not one.
+enum Precedence
+{
+    kNone,
+    kOr,
+    kAnd,
+    kEquality,
+    kRelational,
+    kAdditive,
+    kMultiplicative
+};
+
+struct BinaryOperator
+{
+    int tag;
+    int precedence;
+    BinaryExpressionAST::Operator op;
+};
+
+// A new binary operator needs only a line here and its case in codegen.
+const BinaryOperator kBinaryOperators[] = {
+    {Tag::OR,  kOr,             BinaryExpressionAST::Or},
+    {Tag::AND, kAnd,            BinaryExpressionAST::And},
+    {Tag::EQ,  kEquality,       BinaryExpressionAST::Equals},
+    {Tag::NE,  kEquality,       BinaryExpressionAST::NotEquals},
+    {'<',      kRelational,     BinaryExpressionAST::Less},
+    {Tag::LE,  kRelational,     BinaryExpressionAST::LessOrEquals},
+    {'>',      kRelational,     BinaryExpressionAST::Greater},
+    {Tag::GE,  kRelational,     BinaryExpressionAST::GreaterOrEquals},
+    {'+',      kAdditive,       BinaryExpressionAST::Plus},
+    {'-',      kAdditive,       BinaryExpressionAST::Minus},
+    {'*',      kMultiplicative, BinaryExpressionAST::Mul},
+    {'/',      kMultiplicative, BinaryExpressionAST::Div},
+    {'%',      kMultiplicative, BinaryExpressionAST::Mod},
+};
+
+// The list above indexed by token tag, so the parser finds an operator with
+// one load; EOF and every other tag map to kNone.
+class OperatorTable
+{
+public:
+    OperatorTable()
+    {
+        for (auto &op : ops)
+        {
+            op.precedence = kNone;
+        }
+        for (const auto &op : kBinaryOperators)
+        {
+            ops[op.tag] = op;
+        }
+    }
+
+    const BinaryOperator &operator[](int tag) const
+    {
+        return static_cast<unsigned>(tag) < kSize ? ops[tag] : ops[0];
+    }
+
+private:
+    static const unsigned kSize = Tag::WHILE + 1;
+    BinaryOperator ops[kSize];
+};
+
+const OperatorTable kOperators;
+
+// Below this many tokens a share of the functions is not worth a thread.
+const size_t kMinShare = 1 << 14;
+
+// A run of whole functions, parsed on a thread of its own.
+struct Share
+{
+    size_t begin;
+    size_t end;
+    ASTContext context;
+    std::vector<const FunctionAST *> functions;
+    std::vector<std::string> diagnostics;
+    ExpressionDAG::Stats shared;
+    std::exception_ptr failure;
+};
+}
+
+
+const size_t Parser::kNoBlock;
+
+Parser::Parser(Lexer *l, ASTContext &context)
+        : context(context)
 {
-    top = nullptr;
     used = 0;
+    maxErrors = 1;
+    dag = nullptr;
+    blocks = nullptr;
+    block = kNoBlock;
     this->lexer = l;
+    this->stream = nullptr;
+    this->pos = 0;
+    this->end = 0;
+    move();
+}
+
+Parser::Parser(TokenStream *s, ASTContext &context)
+        : Parser(s, context, 0, s->size())
+{
+}
+
+Parser::Parser(TokenStream *s, ASTContext &context, size_t begin, size_t end)
+        : context(context)
+{
+    used = 0;
+    maxErrors = 1;
+    dag = nullptr;
+    blocks = nullptr;
+    block = kNoBlock;
+    this->lexer = nullptr;
+    this->stream = s;
+    this->pos = begin;
+    this->end = end;
     move();
 }
 
 void Parser::move()
 {
-    look = lexer->gettok();
+    if (stream)
+    {
+        // Keep diagnostics pointing at the token being parsed, not at the
+        // end of the file where the lexer stopped.
+        Lexer::line = stream->line(std::min(pos, end));
+        look = pos < end ? stream->token(pos, literals) : Token::single(static_cast<char>(EOF));
+        pos++;
+    }
+    else
+    {
+        look = lexer->gettok();
+    }
+}
+
+// Tag of the token k places after look; peekTag(0) is look->tag.
+int Parser::peekTag(size_t k)
+{
+    if (k == 0)
+    {
+        return look->tag;
+    }
+    if (!stream)
+    {
+        error("looking %zu tokens ahead needs the pre-lexed token stream", k);
+    }
+    return pos - 1 + k < end ? stream->tag(pos - 1 + k) : EOF;
 }
 
 void Parser::match(int t)
@@ -175,106 +320,314 @@ Type *Parser::dims(Type *p)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
-std::unique_ptr<IExpressionAST> Parser::boolean()
+// program: function {function}
+const ProgramAST *Parser::program(unsigned threads)
 {
-    auto left = join();
+    auto program = context.Create<ProgramAST>();
 
-    while (look->tag == Tag::OR)
+    if (stream && threads > 1)
     {
-        move();
-        left = std::unique_ptr<BinaryExpressionAST>(new BinaryExpressionAST(std::move(left), join(), BinaryExpressionAST::Or));
+        parseShares(program, threads);
+        return program;
     }
 
-    return left;
+    while (look->tag != EOF)
+    {
+        auto function = topFunction();
+        if (function)
+        {
+            program->AddFunction(function);
+        }
+    }
+    return program;
 }
 
-std::unique_ptr<IExpressionAST> Parser::join()
+// Finds where the functions end by matching braces on the token stream and
+// cuts the rest of the stream into about equal shares between them. Each
+// share gets a parser and a context of its own; the functions are gathered
+// in source order and the contexts merged into ours.
+void Parser::parseShares(ProgramAST *program, unsigned threads)
 {
-    auto left = equality();
+    size_t first = pos - 1;
+    size_t last = std::min(end, stream->size() - 1);    // the EOF entry
 
-    while (look->tag == Tag::AND)
+    std::vector<size_t> cuts;
+    int depth = 0;
+    for (size_t i = first; i < last; i++)
     {
-        move();
-        left = std::unique_ptr<BinaryExpressionAST>(new BinaryExpressionAST(std::move(left), equality(), BinaryExpressionAST::And));
+        int tag = stream->tag(i);
+        if (tag == '{')
+        {
+            depth++;
+        } else if (tag == '}' && depth > 0 && --depth == 0)
+        {
+            cuts.push_back(i + 1);
+        }
+    }
+
+    size_t count = std::min<size_t>(threads, (last - first) / kMinShare);
+    std::vector<std::unique_ptr<Share>> shares;
+    size_t begin = first;
+    for (size_t k = 1; k <= count && begin < last; k++)
+    {
+        size_t to = last;
+        if (k < count)
+        {
+            auto cut = std::lower_bound(cuts.begin(), cuts.end(), first + (last - first) * k / count);
+            to = cut == cuts.end() ? last : *cut;
+        }
+        if (to <= begin)
+        {
+            continue;
+        }
+        shares.emplace_back(new Share);
+        shares.back()->begin = begin;
+        shares.back()->end = to;
+        begin = to;
+    }
+    if (shares.empty())
+    {
+        shares.emplace_back(new Share);
+        shares.back()->begin = first;
+        shares.back()->end = last;
     }
 
-    return left;
+    // Nodes are only shared within a share: a builder is tied to the
+    // context its nodes go into.
+    size_t limit = maxErrors;
+    bool sharing = dag != nullptr;
+    auto parse = [this, limit, sharing](Share &share) {
+        Parser parser(stream, share.context, share.begin, share.end);
+        parser.maxErrors = limit;
+        std::unique_ptr<ExpressionDAG> builder(sharing ? new ExpressionDAG(share.context) : nullptr);
+        parser.dag = builder.get();
+        try
+        {
+            while (parser.look->tag != EOF)
+            {
+                auto function = parser.topFunction();
+                if (function)
+                {
+                    share.functions.push_back(function);
+                }
+            }
+        } catch (...)
+        {
+            share.failure = std::current_exception();
+        }
+        share.diagnostics.swap(parser.diagnostics);
+        if (builder)
+        {
+            share.shared = builder->GetStats();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t k = 1; k < shares.size(); k++)
+    {
+        workers.emplace_back(parse, std::ref(*shares[k]));
+    }
+    parse(*shares[0]);
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    for (auto &share : shares)
+    {
+        diagnostics.insert(diagnostics.end(), share->diagnostics.begin(), share->diagnostics.end());
+        if (maxErrors != 0 && diagnostics.size() >= maxErrors)
+        {
+            // Every share counted its errors on its own; the one that
+            // reaches the limit over all of them ends the parse.
+            std::string fatal = diagnostics[maxErrors - 1];
+            diagnostics.resize(maxErrors - 1);
+            throw SourceError(fmtstr("%s", fatal.c_str()));
+        }
+        if (share->failure)
+        {
+            std::rethrow_exception(share->failure);
+        }
+
+        context.Absorb(share->context);
+        if (dag)
+        {
+            dag->AddStats(share->shared);
+        }
+        for (auto function : share->functions)
+        {
+            program->AddFunction(function);
+        }
+    }
+
+    pos = last;
+    move();
 }
 
-std::unique_ptr<IExpressionAST> Parser::equality()
+// function: ('void' | type) id '(' [type id {',' type id}] ')' block
+const FunctionAST *Parser::function()
 {
-    auto left = rel();
+    boost::optional<ExpressionType> returnType;
+    if (look->tag == Tag::VOID)
+    {
+        move();
+    }
+    else
+    {
+        returnType = basicType();
+    }
 
-    while (look->tag == Tag::EQ || look->tag == Tag::NE) {
+    auto * name = static_cast<Word*>(look);
+    match(Tag::ID);
+    match('(');
 
-        move();
-        // TODO: implement not equal operator
-        left = std::unique_ptr<BinaryExpressionAST>(new BinaryExpressionAST(std::move(left), rel(), BinaryExpressionAST::Equals));
+    // Parameters get a scope of their own, around the body's.
+    env.enter();
+    std::vector<FunctionAST::Param> params;
+    if (look->tag != ')')
+    {
+        for (;;)
+        {
+            ExpressionType type = basicType();
+            auto * param = static_cast<Word*>(look);
+            match(Tag::ID);
+            if (!env.put(param->symbol, type))
+            {
+                error("parameter '%s' declared twice", param->toString());
+            }
+            params.emplace_back(param->symbol, type);
+
+            if (look->tag != ',')
+            {
+                break;
+            }
+            move();
+        }
+    }
+    match(')');
+
+    if (look->tag != '{')
+    {
+        error("syntax error: function body expected");
     }
+    auto body = stmt();
+    env.leave();
 
-    return left;
+    auto identifier = context.Create<IdentifierAST>(name->symbol);
+    return context.Create<FunctionAST>(returnType, identifier, std::move(params), body);
 }
 
-std::unique_ptr<IExpressionAST> Parser::rel()
+// A function at the top level, or nullptr if a syntax error in it was
+// recovered from.
+const FunctionAST *Parser::topFunction()
 {
-    auto left = expr();
+    if (maxErrors == 1)
+    {
+        return function();
+    }
 
-    switch (look->tag)
+    size_t mark = pending.size();
+    size_t scopes = env.depth();
+    size_t opened = blocks ? blocks->size() : 0;
+    size_t open = block;
+    bool stray = look->tag == '}';
+    try
     {
-    case '<':
-    case '>':
-    case Tag::LE:
-    case Tag::GE:
+        return function();
+    } catch (SourceError &e)
     {
-        move();
-        // TODO: implement >, <=, >= operators
-        return std::unique_ptr<BinaryExpressionAST>(new BinaryExpressionAST(std::move(left), expr(), BinaryExpressionAST::Less));
-    }
-    default:
-        return left;
+        if (!recover(e))
+        {
+            throw;
+        }
+        pending.resize(mark);
+        while (env.depth() > scopes)
+        {
+            env.leave();
+        }
+        dropBlocks(opened, open);
+
+        // No block is open out here for a stray '}' to close, and
+        // synchronize() stops in front of it.
+        if (stray && look->tag == '}')
+        {
+            move();
+        }
+        return nullptr;
     }
 }
 
-std::unique_ptr<IExpressionAST> Parser::expr()
+// Basic types as the tree knows them; a char is an int.
+ExpressionType Parser::basicType()
 {
-    auto left = term();
+    Token *t = look;
+    match(Tag::BASIC);
 
-    while (look->tag == '+' || look->tag == '-')
+    if (t == Type::Float)
     {
-        BinaryExpressionAST::Operator op = look->tag == '+' ? BinaryExpressionAST::Plus : BinaryExpressionAST::Minus;
-        move();
-        left = std::unique_ptr<BinaryExpressionAST>(new BinaryExpressionAST(std::move(left), term(), op));
+        return ExpressionType::Float;
+    }
+    else if (t == Type::Bool)
+    {
+        return ExpressionType::Bool;
     }
+    return ExpressionType::Int;
+}
 
-    return left;
+const IExpressionAST *Parser::boolean()
+{
+    return binary(kOr);
 }
 
-std::unique_ptr<IExpressionAST> Parser::term()
+// Arithmetic only: what array indices and element values may hold.
+const IExpressionAST *Parser::expr()
+{
+    return binary(kAdditive);
+}
+
+// Precedence climbing: takes operators that bind at least as tightly as
+// minPrecedence, parsing each right operand one level tighter so that
+// operators of equal precedence group to the left.
+const IExpressionAST *Parser::binary(int minPrecedence)
 {
     auto left = unary();
 
-    while (look->tag == '*' || look->tag == '/')
+    for (;;)
     {
-        BinaryExpressionAST::Operator op = look->tag == '*' ? BinaryExpressionAST::Mul : BinaryExpressionAST::Div;
+        const BinaryOperator &op = kOperators[look->tag];
+        if (op.precedence < minPrecedence)
+        {
+            return left;
+        }
 
         move();
-        left = std::unique_ptr<BinaryExpressionAST>(new BinaryExpressionAST(std::move(left), unary(), op));
+        auto right = binary(op.precedence + 1);
+        left = dag ? dag->Binary(left, right, op.op) : context.Create<BinaryExpressionAST>(left, right, op.op);
     }
-
-    return left;
 }
 
-std::unique_ptr<IExpressionAST> Parser::unary()
+const IExpressionAST *Parser::unary()
 {
+    // Every nested expression comes through here, and every nested
+    // statement through stmt(), so these two checks bound the recursion.
+    if (StackGuard::IsNearEnd())
+    {
+        const IExpressionAST *expr = nullptr;
+        StackGuard::Grow([&] { expr = unary(); });
+        return expr;
+    }
+
     if (look->tag == '-')
     {
         move();
-        return std::unique_ptr<UnaryAST>(new UnaryAST(unary(), UnaryAST::Minus));
+        auto operand = unary();
+        return dag ? dag->Unary(operand, UnaryAST::Minus) : context.Create<UnaryAST>(operand, UnaryAST::Minus);
     }
     else if (look->tag == '!')
     {
         move();
-        return std::unique_ptr<UnaryAST>(new UnaryAST(unary(), UnaryAST::Negation));
+        auto operand = unary();
+        return dag ? dag->Unary(operand, UnaryAST::Negation) : context.Create<UnaryAST>(operand, UnaryAST::Negation);
     }
     else
     {
@@ -282,7 +635,7 @@ std::unique_ptr<IExpressionAST> Parser::unary()
     }
 }
 
-std::unique_ptr<IExpressionAST> Parser::factor()
+const IExpressionAST *Parser::factor()
 {
     switch (look->tag)
     {
@@ -301,8 +654,15 @@ std::unique_ptr<IExpressionAST> Parser::factor()
                 assert(false);
             }
 
+            // Literals are lexed as 64-bit, but int is still 32 bits wide.
+            if (num->value > INT_MAX)
+            {
+                error("integer constant %lld does not fit in int", (long long) num->value);
+            }
+
             move();
-            return std::unique_ptr<LiteralConstantAST>(new LiteralConstantAST(num->value));
+            int value = static_cast<int>(num->value);
+            return dag ? dag->Literal(value) : context.Create<LiteralConstantAST>(value);
         }
         case Tag::REAL:
         {
@@ -313,41 +673,47 @@ std::unique_ptr<IExpressionAST> Parser::factor()
             }
 
             move();
-            return std::unique_ptr<LiteralConstantAST>(new LiteralConstantAST(num->value));
+            return dag ? dag->Literal(num->value) : context.Create<LiteralConstantAST>(num->value);
         }
         case Tag::TRUE:
         {
             move();
-            return std::unique_ptr<LiteralConstantAST>(new LiteralConstantAST(true));
+            return dag ? dag->Literal(true) : context.Create<LiteralConstantAST>(true);
         }
         case Tag::FALSE:
         {
             move();
-            return std::unique_ptr<LiteralConstantAST>(new LiteralConstantAST(false));
+            return dag ? dag->Literal(false) : context.Create<LiteralConstantAST>(false);
         }
         case Tag::ID:
         {
-            Id *id = top->get(look);
-            if (id == nullptr) {
-                // error("'%s' undeclared", look->toString());
-            }
-
-            auto * token = dynamic_cast<Word*>(look);
-            assert(token);
-
+            auto * token = static_cast<Word*>(look);
             move();
-            auto identifier = std::unique_ptr<IdentifierAST>(new IdentifierAST(token->lexme));
+
+            // Functions may be defined after their callers, so only
+            // variables are checked.
+            if (look->tag == '(')
+            {
+                return call(token->symbol);
+            }
+            const Env::Symbol *symbol = env.get(token->symbol);
+            if (!symbol)
+            {
+                error("'%s' undeclared", token->toString());
+            }
 
             if (look->tag != '[')
             {
-                return identifier;
+                // Shared names are told apart by type, as one may be
+                // redeclared with another type in a later function.
+                return dag ? dag->Identifier(token->symbol, symbol->type) : context.Create<IdentifierAST>(token->symbol);
             }
             else
             {
                 match('[');
                 auto index = expr();
                 match(']');
-                return std::unique_ptr<ArrayElementAccessAST>(new ArrayElementAccessAST(identifier->GetName(), std::move(index)));
+                return dag ? dag->ArrayAccess(token->symbol, index) : context.Create<ArrayElementAccessAST>(token->symbol, index);
             }
         }
         default:
@@ -356,8 +722,147 @@ std::unique_ptr<IExpressionAST> Parser::factor()
     }
 }
 
-std::unique_ptr<IStatementAST> Parser::stmt()
+// Arguments are gathered on a stack shared by nested calls, the way
+// statements are for nested blocks.
+const FunctionCallExprAST *Parser::call(SymbolId name)
+{
+    match('(');
+
+    size_t mark = arguments.size();
+    if (look->tag != ')')
+    {
+        arguments.push_back(boolean());
+        while (look->tag == ',')
+        {
+            move();
+            arguments.push_back(boolean());
+        }
+    }
+    match(')');
+
+    size_t count = arguments.size() - mark;
+    auto call = dag ? dag->Call(name, arguments.data() + mark, count)
+                    : context.Create<FunctionCallExprAST>(name, context.CreateList(arguments.data() + mark, count), count);
+    arguments.resize(mark);
+    return call;
+}
+
+// Parses one statement of a block. Unless the first error is to stop
+// everything, a syntax error is recorded and the statement left out of the
+// tree, and parsing resumes after it.
+const IStatementAST *Parser::blockStmt()
 {
+    if (maxErrors == 1)
+    {
+        return stmt();
+    }
+
+    size_t mark = pending.size();
+    size_t scopes = env.depth();
+    size_t opened = blocks ? blocks->size() : 0;
+    size_t open = block;
+    try
+    {
+        return stmt();
+    } catch (SourceError &e)
+    {
+        if (!recover(e))
+        {
+            throw;
+        }
+        // Blocks the error broke out of leave their statements and their
+        // scopes behind.
+        pending.resize(mark);
+        while (env.depth() > scopes)
+        {
+            env.leave();
+        }
+        dropBlocks(opened, open);
+        return nullptr;
+    }
+}
+
+// Forgets the blocks recorded inside a statement left out of the tree, and
+// goes back to the block that was open when it began.
+void Parser::dropBlocks(size_t count, size_t open)
+{
+    if (blocks)
+    {
+        blocks->resize(count);
+        block = open;
+    }
+}
+
+// Records e and skips what it broke; false if e is one error too many and
+// has to end the parse.
+bool Parser::recover(const SourceError &e)
+{
+    // Running out of input leaves every open block unclosed; say so once.
+    bool again = look->tag == EOF && !diagnostics.empty() && diagnostics.back() == e.what();
+    if (!again)
+    {
+        if (maxErrors != 0 && diagnostics.size() + 1 >= maxErrors)
+        {
+            return false;
+        }
+        diagnostics.push_back(e.what());
+    }
+
+    // No call spans statements, so none is still open here.
+    arguments.clear();
+    synchronize();
+    return true;
+}
+
+// Panic mode: skips to the end of the broken statement, which is past the
+// next ';' or balanced {...} on this level, or just before the '}' that
+// closes the enclosing block.
+void Parser::synchronize()
+{
+    int depth = 0;
+    for (;;)
+    {
+        switch (look->tag)
+        {
+            case EOF:
+                return;
+            case ';':
+                move();
+                if (depth == 0)
+                {
+                    return;
+                }
+                break;
+            case '{':
+                depth++;
+                move();
+                break;
+            case '}':
+                if (depth == 0)
+                {
+                    return;
+                }
+                move();
+                if (--depth == 0)
+                {
+                    return;
+                }
+                break;
+            default:
+                move();
+        }
+    }
+}
+
+const IStatementAST *Parser::stmt()
+{
+    if (StackGuard::IsNearEnd())
+    {
+        const IStatementAST *statement = nullptr;
+        StackGuard::Grow([&] { statement = stmt(); });
+        return statement;
+    }
+
 //    IExpressionAST *expr;
 
     Expr *x;
@@ -373,7 +878,7 @@ std::unique_ptr<IStatementAST> Parser::stmt()
             match(')');
             auto thenBody = stmt();
 
-            auto conditionStatement = std::unique_ptr<IfStatementAST>(new IfStatementAST(std::move(parsedExpr), std::move(thenBody)));
+            auto conditionStatement = context.Create<IfStatementAST>(parsedExpr, thenBody);
 
             if (look->tag != Tag::ELSE)
             {
@@ -391,29 +896,71 @@ std::unique_ptr<IStatementAST> Parser::stmt()
             match('(');
             auto parsedExpr = boolean();
             match(')');
-            return std::unique_ptr<WhileStatementAST>(new WhileStatementAST(std::move(parsedExpr), std::move(stmt())));
+            return context.Create<WhileStatementAST>(parsedExpr, stmt());
 
         }
         case '{':
         {
+            size_t record = blocks ? blocks->size() : kNoBlock;
+            if (blocks)
+            {
+                blocks->push_back(Block{pos - 1, 0, block, pending.size(), diagnostics.size(), 0, {}, nullptr});
+                block = record;
+            }
             match('{');
-            auto composite = std::unique_ptr<CompositeStatementAST>(new CompositeStatementAST);
-            while (look->tag != '}')
+            env.enter();
+
+            // Statements of enclosing blocks stay below mark; ours are
+            // copied into the context in one piece once the block ends.
+            size_t mark = pending.size();
+            while (look->tag != '}' && look->tag != EOF)
             {
-                composite->AddStatement(stmt());
+                auto statement = blockStmt();
+                if (statement)
+                {
+                    pending.push_back(statement);
+                }
             }
             match('}');
+            env.leave();
+
+            size_t count = pending.size() - mark;
+            auto composite = context.Create<CompositeStatementAST>(context.CreateList(pending.data() + mark, count), count);
+            pending.resize(mark);
+            if (blocks)
+            {
+                Block &closed = (*blocks)[record];
+                closed.end = pos - 1;
+                closed.errorsEnd = diagnostics.size();
+                closed.statement = composite;
+                block = closed.parent;
+            }
             return composite;
         }
+        case Tag::RETURN:
+        {
+            match(Tag::RETURN);
+            auto value = look->tag == ';' ? nullptr : boolean();
+            match(';');
+            return context.Create<ReturnStatementAST>(value);
+        }
         case Tag::BASIC:
         {
-            match(Tag::BASIC);
-            auto * token = dynamic_cast<Word*>(look);
-            assert(token);
-            move();
+            size_t at = pos - 1;
+            ExpressionType type = basicType();
+            auto * token = static_cast<Word*>(look);
+            match(Tag::ID);
+            if (!env.put(token->symbol, type))
+            {
+                error("'%s' already declared in this scope", token->toString());
+            }
+            if (blocks && block != kNoBlock)
+            {
+                (*blocks)[block].declarations.push_back(Declaration{token->symbol, type, at});
+            }
             match(';');
-            auto identifier = std::unique_ptr<IdentifierAST>(new IdentifierAST(token->lexme));
-            return std::unique_ptr<VariableDeclarationAST>(new VariableDeclarationAST(std::move(identifier), ExpressionType::Int));
+            auto identifier = context.Create<IdentifierAST>(token->symbol);
+            return context.Create<VariableDeclarationAST>(identifier, type);
         }
         default:
         {
@@ -422,22 +969,27 @@ std::unique_ptr<IStatementAST> Parser::stmt()
             Token *t = look;
 
             match(Tag::ID);
-            Id *id = top->get(t);
 
-            if (id == nullptr)
+            // A function name is not a variable.
+            if (look->tag == '(')
             {
-                error("'%s' undeclared", t->toString());
+                auto * name = static_cast<Word*>(t);
+                auto callStatement = context.Create<FunctionCallStatementAST>(call(name->symbol));
+                match(';');
+                return callStatement;
             }
 
-            auto * token = dynamic_cast<Word*>(t);
-            assert(token);
-
-            auto identifier = std::unique_ptr<IdentifierAST>(new IdentifierAST(token->lexme));
+            auto * token = static_cast<Word*>(t);
+            if (!env.get(token->symbol))
+            {
+                error("'%s' undeclared", token->toString());
+            }
 
             if (look->tag == '=')
             {
                 match('=');
-                auto assign = std::unique_ptr<AssignStatementAST>(new AssignStatementAST(std::move(identifier), boolean()));
+                auto identifier = context.Create<IdentifierAST>(token->symbol);
+                auto assign = context.Create<AssignStatementAST>(identifier, boolean());
                 match(';');
                 return assign;
             }
@@ -447,13 +999,13 @@ std::unique_ptr<IStatementAST> Parser::stmt()
                 auto index = boolean();
                 match(']');
                 match('=');
-                auto arrayElementAssign = std::unique_ptr<ArrayElementAssignAST>(
-                        new ArrayElementAssignAST(identifier->GetName(), std::move(index), expr())
-                );
+                auto arrayElementAssign = context.Create<ArrayElementAssignAST>(token->symbol, index, expr());
                 match(';');
+                return arrayElementAssign;
             }
 
-            throw std::runtime_error("can't parse statement at symbol: " + std::string(1, char(look->tag)));
+            error("can't parse statement at symbol: %s", look->toString());
+            return nullptr;
         }
     }
 }
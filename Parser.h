@@ -1,26 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
 #include "AST/AST.h"
+#include "AST/ASTContext.h"
+#include "Symbol.h"
 
 class Lexer;
+class TokenStream;
 class Token;
 class Stmt;
-class Env;
 class Type;
 class Expr;
 class Access;
 class Id;
+class SourceError;
+class ExpressionDAG;
 
+// Nodes are built in the given context and live as long as it does.
 class Parser {
 public:
-    explicit Parser(Lexer *l);
+    // A variable a block declared, and the stream index of its statement.
+    struct Declaration {
+        SymbolId name;
+        ExpressionType type;
+        size_t token;
+    };
+
+    // A {...} block as it was parsed, enough to parse it again on its own.
+    // Blocks are recorded in the order they open; one inside a statement
+    // that fails is dropped with it.
+    struct Block {
+        size_t begin;           // stream index of its '{'
+        size_t end;             // stream index after its '}'
+        size_t parent;          // of the block around it, or kNoBlock
+        size_t statements;      // pending.size() as it opened; the parent's
+                                // subtracted gives its place in the parent
+        size_t errors;          // diagnostics.size() as it opened
+        size_t errorsEnd;       // and as it closed
+        std::vector<Declaration> declarations; // in its scope, in order
+        const CompositeStatementAST *statement;
+    };
+
+    static const size_t kNoBlock = size_t(-1);
 
+    Parser(Lexer *l, ASTContext &context);
+
+    // Walks a pre-lexed stream instead of pulling tokens one at a time.
+    Parser(TokenStream *s, ASTContext &context);
+
+    // Walks tokens [begin, end) of the stream and sees EOF after them.
+    Parser(TokenStream *s, ASTContext &context, size_t begin, size_t end);
+
+    ASTContext &context;
+    std::vector<const IStatementAST *> pending;    // statements of the blocks being parsed
+    std::vector<const IExpressionAST *> arguments; // arguments of the calls being parsed
+    std::vector<std::string> diagnostics;           // errors recovered from, in order
+    size_t  maxErrors;  // errors before giving up: 1 stops at the first, 0 never gives up
+    ExpressionDAG *dag; // builds the expressions, sharing repeated ones, when set
     Lexer   *lexer;
+    TokenStream *stream;
+    size_t  pos;        // stream index of the token after look
+    size_t  end;        // stream index where the parser's input ends
+    Arena   literals;   // Num and Real tokens made from the stream
     Token   *look;
 //    IStatementAST *astRoot;
-    Env     *top;
+    Env     env;        // variables in scope
+    std::vector<Block> *blocks; // records the blocks parsed, when set
+    size_t  block;      // innermost open block in blocks
     int     used;
     
     void    move();
     void    match(int t);
+    int     peekTag(size_t k);
 //    void    decls();
     Type    *type();
     Type    *dims(Type *p);
@@ -29,13 +82,22 @@ public:
 //    Access  *offset(Id *a);
 //    void program();
 
-    std::unique_ptr<IStatementAST> stmt();
-    std::unique_ptr<IExpressionAST> boolean();
-    std::unique_ptr<IExpressionAST> join();
-    std::unique_ptr<IExpressionAST> equality();
-    std::unique_ptr<IExpressionAST> rel();
-    std::unique_ptr<IExpressionAST> expr();
-    std::unique_ptr<IExpressionAST> term();
-    std::unique_ptr<IExpressionAST> unary();
-    std::unique_ptr<IExpressionAST> factor();
+    const ProgramAST *program(unsigned threads = 1);
+    const FunctionAST *function();
+    const FunctionAST *topFunction();
+    ExpressionType basicType();
+    const IStatementAST *stmt();
+    const IStatementAST *blockStmt();
+    bool    recover(const SourceError &e);
+    void    synchronize();
+    const IExpressionAST *boolean();
+    const IExpressionAST *expr();
+    const IExpressionAST *binary(int minPrecedence);
+    const IExpressionAST *unary();
+    const IExpressionAST *factor();
+    const FunctionCallExprAST *call(SymbolId name);
+
+private:
+    void    dropBlocks(size_t count, size_t open);
+    void    parseShares(ProgramAST *program, unsigned threads);
 };
@@ -0,0 +1,215 @@
+#include "ScanKernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+namespace
+{
+typedef void (*ClassifyFn)(const char *, ScanKernels::Masks &);
+
+void scalarClassify(const char *p, ScanKernels::Masks &m)
+{
+    m.blank = m.ident = m.digit = m.newline = 0;
+
+    for (unsigned i = 0; i < ScanKernels::kWindow; i++)
+    {
+        char c = p[i];
+        uint64_t bit = uint64_t(1) << i;
+
+        bool digit = (unsigned) (c - '0') < 10u;
+        bool alpha = (unsigned) ((c | 0x20) - 'a') < 26u;
+
+        m.blank |= (c == ' ' || c == '\t' || c == '\n') ? bit : 0;
+        m.newline |= c == '\n' ? bit : 0;
+        m.digit |= digit ? bit : 0;
+        m.ident |= (digit || alpha) ? bit : 0;
+    }
+}
+
+#ifdef SCAN_X86
+
+// The range checks shift each range down to start at -128, so a single signed
+// compare tests both ends: c is in [lo, lo + n) iff c + (128 - lo) < -128 + n.
+
+__attribute__((target("sse2")))
+void sse2Classify(const char *p, ScanKernels::Masks &m)
+{
+    const __m128i sp = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i alphaBias = _mm_set1_epi8((char) (128 - 'a'));
+    const __m128i alphaLimit = _mm_set1_epi8((char) (-128 + 26));
+    const __m128i digitBias = _mm_set1_epi8((char) (128 - '0'));
+    const __m128i digitLimit = _mm_set1_epi8((char) (-128 + 10));
+
+    m.blank = m.ident = m.digit = m.newline = 0;
+
+    for (unsigned i = 0; i < ScanKernels::kWindow; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+
+        __m128i isNl = _mm_cmpeq_epi8(v, nl);
+        __m128i blank = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, sp), _mm_cmpeq_epi8(v, tab)), isNl);
+        __m128i digit = _mm_cmplt_epi8(_mm_add_epi8(v, digitBias), digitLimit);
+        __m128i alpha = _mm_cmplt_epi8(_mm_add_epi8(_mm_or_si128(v, caseBit), alphaBias), alphaLimit);
+
+        m.blank |= uint64_t((unsigned) _mm_movemask_epi8(blank)) << i;
+        m.newline |= uint64_t((unsigned) _mm_movemask_epi8(isNl)) << i;
+        m.digit |= uint64_t((unsigned) _mm_movemask_epi8(digit)) << i;
+        m.ident |= uint64_t((unsigned) _mm_movemask_epi8(_mm_or_si128(alpha, digit))) << i;
+    }
+}
+
+__attribute__((target("avx2")))
+void avx2Classify(const char *p, ScanKernels::Masks &m)
+{
+    const __m256i sp = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i alphaBias = _mm256_set1_epi8((char) (128 - 'a'));
+    const __m256i alphaLimit = _mm256_set1_epi8((char) (-128 + 26));
+    const __m256i digitBias = _mm256_set1_epi8((char) (128 - '0'));
+    const __m256i digitLimit = _mm256_set1_epi8((char) (-128 + 10));
+
+    m.blank = m.ident = m.digit = m.newline = 0;
+
+    for (unsigned i = 0; i < ScanKernels::kWindow; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (p + i));
+
+        __m256i isNl = _mm256_cmpeq_epi8(v, nl);
+        __m256i blank = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, sp), _mm256_cmpeq_epi8(v, tab)), isNl);
+        __m256i digit = _mm256_cmpgt_epi8(digitLimit, _mm256_add_epi8(v, digitBias));
+        __m256i alpha = _mm256_cmpgt_epi8(alphaLimit, _mm256_add_epi8(_mm256_or_si256(v, caseBit), alphaBias));
+
+        m.blank |= uint64_t((unsigned) _mm256_movemask_epi8(blank)) << i;
+        m.newline |= uint64_t((unsigned) _mm256_movemask_epi8(isNl)) << i;
+        m.digit |= uint64_t((unsigned) _mm256_movemask_epi8(digit)) << i;
+        m.ident |= uint64_t((unsigned) _mm256_movemask_epi8(_mm256_or_si256(alpha, digit))) << i;
+    }
+}
+
+#endif
+
+const ClassifyFn classifiers[] = {
+        scalarClassify,
+#ifdef SCAN_X86
+        sse2Classify,
+        avx2Classify,
+#endif
+};
+
+ScanKernels::Level currentLevel = ScanKernels::detect();
+ClassifyFn classify = classifiers[currentLevel];
+
+inline int popcount(uint64_t v)
+{
+    int n = 0;
+    for (; v != 0; v &= v - 1)
+    {
+        n++;
+    }
+    return n;
+}
+}
+
+ScanKernels::ScanKernels()
+        : base(nullptr)
+{
+}
+
+void ScanKernels::load(const char *p)
+{
+    base = p;
+    classify(p, masks);
+}
+
+void ScanKernels::reset()
+{
+    base = nullptr;
+}
+
+const char *ScanKernels::skipBlanksSlow(const char *p, int &lines)
+{
+    // Called when the run covers the rest of the window: count what is left
+    // of it, then keep going one whole window at a time.
+    for (;;)
+    {
+        unsigned off = window(p);
+        uint64_t other = ~masks.blank >> off;
+        uint64_t nl = masks.newline >> off;
+
+        if (other != 0)
+        {
+            unsigned n = (unsigned) __builtin_ctzll(other);
+            lines += popcount(nl & ((uint64_t(1) << n) - 1));
+            return p + n;
+        }
+        lines += popcount(nl);
+        p += kWindow - off;
+    }
+}
+
+const char *ScanKernels::skipRunSlow(const char *p, const uint64_t &run)
+{
+    // `run` refers to one of our masks, so it follows each reload.
+    for (;;)
+    {
+        unsigned off = window(p);
+        uint64_t other = ~run >> off;
+        if (other != 0)
+        {
+            return p + __builtin_ctzll(other);
+        }
+        p += kWindow - off;
+    }
+}
+
+ScanKernels::Level ScanKernels::detect()
+{
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return SSE2;
+    }
+#endif
+    return Scalar;
+}
+
+ScanKernels::Level ScanKernels::level()
+{
+    return currentLevel;
+}
+
+void ScanKernels::setLevel(Level l)
+{
+    if (l > detect())
+    {
+        l = detect();
+    }
+    currentLevel = l;
+    classify = classifiers[l];
+}
+
+const char *ScanKernels::toString(Level l)
+{
+    switch (l)
+    {
+        case Scalar:
+            return "scalar";
+        case SSE2:
+            return "sse2";
+        case AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
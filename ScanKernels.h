@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+
+// Run scanners for the lexer's hot loops. Each skip function takes a pointer
+// into a SourceBuffer and returns the first byte that is not part of the run.
+//
+// Bytes are classified 64 at a time into bit masks (one bit per byte), so
+// finding the end of a short run is a shift and a count-trailing-zeros, and
+// the vector work is shared by all the runs inside one window. Classifying
+// reads 64 bytes past the current position, which the buffer's zero padding
+// makes safe; '\0' never belongs to a run, so scans stop at end().
+class ScanKernels
+{
+public:
+    enum Level
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    ScanKernels();
+
+    // Spaces, tabs and newlines; newlines are added to `lines`.
+    const char *skipBlanks(const char *p, int &lines);
+
+    // [A-Za-z0-9]
+    const char *skipIdent(const char *p);
+
+    // [0-9]
+    const char *skipDigits(const char *p);
+
+    // Drops the cached window; needed when the bytes under it change.
+    void reset();
+
+    // Best level the CPU supports; picked once at startup.
+    static Level detect();
+
+    static Level level();
+
+    // Forces a lower level, e.g. to compare kernels in benchmarks.
+    static void setLevel(Level l);
+
+    static const char *toString(Level l);
+
+    static const unsigned kWindow = 64;
+
+    // One bit per byte of a window.
+    struct Masks
+    {
+        uint64_t blank;
+        uint64_t ident;
+        uint64_t digit;
+        uint64_t newline;
+    };
+
+private:
+    // Offset of p inside the cached window, reclassifying if it is outside.
+    unsigned window(const char *p);
+
+    void load(const char *p);
+
+    const char *skipBlanksSlow(const char *p, int &lines);
+
+    const char *skipRunSlow(const char *p, const uint64_t &run);
+
+    const char *base;
+    Masks masks;
+};
+
+// The common case - the run ends inside the current window - is inlined into
+// the lexer; crossing into the next window goes through the slow path.
+
+inline unsigned ScanKernels::window(const char *p)
+{
+    uintptr_t off = (uintptr_t) p - (uintptr_t) base;
+    if (off >= kWindow)
+    {
+        load(p);
+        off = 0;
+    }
+    return (unsigned) off;
+}
+
+inline const char *ScanKernels::skipBlanks(const char *p, int &lines)
+{
+    unsigned off = window(p);
+    uint64_t other = ~masks.blank >> off;
+    if (other == 0)
+    {
+        return skipBlanksSlow(p, lines);
+    }
+
+    unsigned n = (unsigned) __builtin_ctzll(other);
+    for (uint64_t nl = (masks.newline >> off) & ((uint64_t(1) << n) - 1); nl != 0; nl &= nl - 1)
+    {
+        lines++;
+    }
+    return p + n;
+}
+
+inline const char *ScanKernels::skipIdent(const char *p)
+{
+    unsigned off = window(p);
+    uint64_t other = ~masks.ident >> off;
+    return other != 0 ? p + __builtin_ctzll(other) : skipRunSlow(p, masks.ident);
+}
+
+inline const char *ScanKernels::skipDigits(const char *p)
+{
+    unsigned off = window(p);
+    uint64_t other = ~masks.digit >> off;
+    return other != 0 ? p + __builtin_ctzll(other) : skipRunSlow(p, masks.digit);
+}
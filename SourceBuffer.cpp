@@ -0,0 +1,273 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "SourceBuffer.h"
+#include "Error.h"
+
+#define kReadChunk  (64 * 1024)
+
+namespace
+{
+void closeInput(int fd)
+{
+    if (fd != STDIN_FILENO)
+    {
+        close(fd);
+    }
+}
+
+bool isMappable(int fd, size_t &size)
+{
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        size = (size_t) st.st_size;
+        return true;
+    }
+    return false;
+}
+}
+
+SourceBuffer::SourceBuffer(const char *path)
+        : base(nullptr), length(0), mappedBytes(0),
+          fd(-1), capacity(0), filled(0), dropped(0), held('\0')
+{
+    int in = openPath(path);
+
+    size_t size;
+    if (isMappable(in, size) && map(in, size))
+    {
+        closeInput(in);
+        return;
+    }
+
+    readAll(in);
+    closeInput(in);
+}
+
+SourceBuffer::SourceBuffer(const char *text, size_t size)
+        : base(nullptr), length(0), mappedBytes(0),
+          fd(-1), capacity(0), filled(0), dropped(0), held('\0')
+{
+    copy(text, size);
+}
+
+SourceBuffer::SourceBuffer()
+        : base(nullptr), length(0), mappedBytes(0),
+          fd(-1), capacity(0), filled(0), dropped(0), held('\0')
+{
+}
+
+SourceBuffer *SourceBuffer::stream(const char *path, size_t window)
+{
+    int in = openPath(path);
+    std::unique_ptr<SourceBuffer> source(new SourceBuffer());
+
+    size_t size;
+    if (isMappable(in, size) && source->map(in, size))
+    {
+        closeInput(in);
+        return source.release();
+    }
+
+    // One more byte than the window, for the '\0' after a full one.
+    source->capacity = window > 0 ? window : kWindow;
+    source->base = (char *) calloc(source->capacity + 1 + kPadding, 1);
+    source->fd = in;
+    source->refill(source->base);
+    return source.release();
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    if (mappedBytes != 0)
+    {
+        munmap(base, mappedBytes);
+    } else
+    {
+        free(base);
+    }
+    if (fd >= 0)
+    {
+        closeInput(fd);
+    }
+}
+
+const char *SourceBuffer::begin() const
+{
+    return base;
+}
+
+const char *SourceBuffer::end() const
+{
+    return base + length;
+}
+
+size_t SourceBuffer::size() const
+{
+    return length;
+}
+
+size_t SourceBuffer::consumed() const
+{
+    return dropped;
+}
+
+const char *SourceBuffer::refill(const char *keep)
+{
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    // Slide the kept text and the partial line after it to the front.
+    // This is the only copying a stream does, and it is one line at most.
+    base[length] = held;
+    size_t start = (size_t) (keep - base);
+    size_t seen = length - start;
+    filled -= start;
+    memmove(base, keep, filled);
+    dropped += start;
+
+    // [seen, filled) holds no newline yet, so read until one turns up.
+    size_t scanned = seen;
+    for (;;)
+    {
+        size_t end = filled;
+        while (end > scanned && base[end - 1] != '\n')
+        {
+            end--;
+        }
+        if (end > scanned)
+        {
+            length = end;
+            break;
+        }
+        scanned = filled;
+
+        if (filled == capacity)
+        {
+            // A line longer than the window: the window has to grow.
+            capacity *= 2;
+            base = (char *) realloc(base, capacity + 1 + kPadding);
+        }
+
+        ssize_t n = read(fd, base + filled, capacity - filled);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            throw Error(fmtstr("Cannot read input: %s", strerror(errno)));
+        }
+        if (n == 0)
+        {
+            closeInput(fd);
+            fd = -1;
+            length = filled;
+            break;
+        }
+        filled += (size_t) n;
+    }
+
+    held = base[length];
+    base[length] = '\0';
+    return base;
+}
+
+bool SourceBuffer::map(int fd, size_t size)
+{
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t total = (size + kPadding + page - 1) / page * page;
+
+    // Reserve zeroed pages for the file plus padding, then map the file over
+    // the front of the reservation. The tail of the last file page and the
+    // remaining anonymous pages read as zero, which gives us the sentinel.
+    void *area = mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED)
+    {
+        return false;
+    }
+
+    void *file = mmap(area, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (file == MAP_FAILED)
+    {
+        munmap(area, total);
+        return false;
+    }
+
+    madvise(area, total, MADV_SEQUENTIAL);
+
+    base = (char *) area;
+    length = size;
+    mappedBytes = total;
+
+    return true;
+}
+
+void SourceBuffer::readAll(int fd)
+{
+    size_t capacity = kReadChunk;
+    char *data = (char *) malloc(capacity + kPadding);
+    size_t used = 0;
+
+    for (;;)
+    {
+        if (used == capacity)
+        {
+            capacity *= 2;
+            data = (char *) realloc(data, capacity + kPadding);
+        }
+
+        ssize_t n = read(fd, data + used, capacity - used);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            free(data);
+            throw Error(fmtstr("Cannot read input: %s", strerror(errno)));
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        used += (size_t) n;
+    }
+
+    memset(data + used, 0, kPadding);
+
+    base = data;
+    length = used;
+}
+
+int SourceBuffer::openPath(const char *path)
+{
+    if (!strcmp(path, "-"))
+    {
+        return STDIN_FILENO;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        throw Error(fmtstr("Cannot open file \"%s\"", path));
+    }
+    return fd;
+}
+
+void SourceBuffer::copy(const char *text, size_t size)
+{
+    base = (char *) malloc(size + kPadding);
+    memcpy(base, text, size);
+    memset(base + size, 0, kPadding);
+    length = size;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+
+// Whole source text as one contiguous read-only range.
+// Regular files are memory-mapped; pipes and other unmappable inputs are read
+// into a single heap block. Either way [begin(), end()) is followed by at least
+// kPadding zero bytes, so scanners may read ahead and only need to compare
+// against end() after they hit a '\0'.
+//
+// A stream instead holds a window of whole lines of the input and is moved
+// along with refill(), so memory stays bounded by the window and the longest
+// line however long the input is. The window is followed by a '\0' and then
+// kPadding readable bytes. Path "-" is standard input.
+class SourceBuffer
+{
+public:
+    static const size_t kPadding = 64;
+
+    static const size_t kWindow = 64 * 1024;
+
+    explicit SourceBuffer(const char *path);
+
+    SourceBuffer(const char *text, size_t size);
+
+    // Streams path through a window of about window bytes, unless it is a
+    // regular file, which is mapped whole as above.
+    static SourceBuffer *stream(const char *path, size_t window = kWindow);
+
+    ~SourceBuffer();
+
+    const char *begin() const;
+
+    const char *end() const;
+
+    size_t size() const;
+
+    // Bytes of a stream already dropped in front of begin().
+    size_t consumed() const;
+
+    // Streams only: drops the text before keep, which must lie in the
+    // window, and reads on to the end of the next line. Returns where the
+    // kept text now is; the window only stays as it was if the input has
+    // just ended. Returns nullptr, changing nothing, once it has.
+    const char *refill(const char *keep);
+
+private:
+    SourceBuffer();
+
+    SourceBuffer(const SourceBuffer &) = delete;
+
+    SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+    bool map(int fd, size_t size);
+
+    void readAll(int fd);
+
+    void copy(const char *text, size_t size);
+
+    static int openPath(const char *path);
+
+    char *base;
+    size_t length;
+    size_t mappedBytes;
+
+    // Streams only
+    int fd;                 // -1 once the input is used up
+    size_t capacity;        // window bytes, padding not included
+    size_t filled;          // read so far; [length, filled) is a partial line
+    size_t dropped;
+    char held;              // the byte the '\0' after the window covers
+};
@@ -1,27 +1,127 @@
 #include "Symbol.h"
 
-using std::map;
+namespace
+{
+const size_t kInitialSlots = 64;
 
-Env::Env(Env &v)
+size_t home(SymbolId name, size_t mask)
 {
-    prev = &v;
+    return (size_t) ((name * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
 }
 
-void Env::put(Token *t, Id *i)
+Env::Env()
+        : slots(kInitialSlots), count(0)
 {
-    table[t] = i;
+    for (Symbol &s : slots)
+    {
+        s.name = StringInterner::kNoSymbol;
+    }
 }
 
-Id *Env::get(Token *t)
+void Env::enter()
 {
-    for (Env *e = this; nullptr != e; e = e->prev) {
-        
-        Id *found = e->table[t];
-        if (found != nullptr) {
-            return found;
+    marks.push_back(log.size());
+}
+
+void Env::leave()
+{
+    size_t mark = marks.back();
+    marks.pop_back();
+
+    while (log.size() > mark)
+    {
+        const Undo &undo = log.back();
+        size_t slot = find(undo.name);
+        if (undo.previous.name == StringInterner::kNoSymbol)
+        {
+            erase(slot);
+            count--;
+        } else
+        {
+            slots[slot] = undo.previous;
         }
+        log.pop_back();
+    }
+}
+
+size_t Env::depth() const
+{
+    return marks.size();
+}
+
+bool Env::put(SymbolId name, ExpressionType type)
+{
+    if (2 * (count + 1) > slots.size())
+    {
+        grow();
+    }
+
+    size_t slot = find(name);
+    Symbol &s = slots[slot];
+    if (s.name == name && s.depth == depth())
+    {
+        return false;
+    }
+
+    log.push_back(Undo{name, s});
+    if (s.name == StringInterner::kNoSymbol)
+    {
+        count++;
     }
-    
-    return nullptr;
+    s = Symbol{name, type, depth()};
+    return true;
 }
 
+const Env::Symbol *Env::get(SymbolId name) const
+{
+    const Symbol &s = slots[find(name)];
+    return s.name == name ? &s : nullptr;
+}
+
+// Slot holding name, or the empty slot where it would go.
+size_t Env::find(SymbolId name) const
+{
+    size_t mask = slots.size() - 1;
+    size_t slot = home(name, mask);
+    while (slots[slot].name != name && slots[slot].name != StringInterner::kNoSymbol)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Empties slot and moves later entries of its probe run back into the hole,
+// so that no lookup stops short of them.
+void Env::erase(size_t slot)
+{
+    size_t mask = slots.size() - 1;
+    for (size_t next = (slot + 1) & mask; slots[next].name != StringInterner::kNoSymbol; next = (next + 1) & mask)
+    {
+        size_t want = home(slots[next].name, mask);
+        bool between = slot <= next ? slot < want && want <= next : slot < want || want <= next;
+        if (!between)
+        {
+            slots[slot] = slots[next];
+            slot = next;
+        }
+    }
+    slots[slot].name = StringInterner::kNoSymbol;
+}
+
+void Env::grow()
+{
+    std::vector<Symbol> old(2 * slots.size());
+    old.swap(slots);
+    for (Symbol &s : slots)
+    {
+        s.name = StringInterner::kNoSymbol;
+    }
+    for (const Symbol &s : old)
+    {
+        if (s.name != StringInterner::kNoSymbol)
+        {
+            slots[find(s.name)] = s;
+        }
+    }
+}
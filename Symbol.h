@@ -1,19 +1,54 @@
-#include <map>
+#pragma once
 
-class Token;
-class Id;
+#include <cstddef>
+#include <vector>
 
+#include "AST/ExpressionType.h"
+#include "AST/StringInterner.h"
+
+// Names in scope while parsing. One open-addressing table maps each name to
+// its innermost declaration, so a lookup costs the same at any depth and a
+// miss allocates nothing. Every declaration logs what it replaced, and
+// leaving a scope plays the log back to where the scope began.
 class Env {
-private:
-    std::map<Token*, Id*>   table;
-    
-protected:
-    Env *prev;
-    
 public:
-    
-    Env(Env &v);
-    
-    void put(Token *t, Id *i);
-    Id *get(Token *t);
+    struct Symbol {
+        SymbolId name;          // StringInterner::kNoSymbol in an empty slot
+        ExpressionType type;
+        size_t depth;           // of the scope that declared it
+    };
+
+    Env();
+
+    void enter();
+
+    // Forgets the innermost scope's names and brings back what they hid.
+    void leave();
+
+    // Scopes entered and not yet left.
+    size_t depth() const;
+
+    // Declares name in the innermost scope; false if it is declared there
+    // already.
+    bool put(SymbolId name, ExpressionType type);
+
+    // Innermost declaration of name, or nullptr. Valid until the next put.
+    const Symbol *get(SymbolId name) const;
+
+private:
+    struct Undo {
+        SymbolId name;
+        Symbol previous;        // previous.name is kNoSymbol if there was none
+    };
+
+    std::vector<Symbol> slots;  // a power of two, at most half full
+    size_t count;
+    std::vector<Undo> log;
+    std::vector<size_t> marks;  // log size where each open scope began
+
+    size_t find(SymbolId name) const;
+
+    void erase(size_t slot);
+
+    void grow();
 };
@@ -1,3 +1,5 @@
+#include <cstring>
+
 #include "Token.h"
 #include "Error.h"
 
@@ -11,6 +13,20 @@ const char *Token::toString()
     return fmtstr("%c", tag);
 }
 
+static std::vector<Token> makeSingles()
+{
+    std::vector<Token> tokens;
+    tokens.reserve(256);
+    for (int i = 0; i < 256; i++)
+    {
+        // Same tag new Token(peek) used to get, sign extension included.
+        tokens.emplace_back((char) i);
+    }
+    return tokens;
+}
+
+std::vector<Token> Token::singles = makeSingles();
+
 Word *Word::True = new Word("true", Tag::TRUE);
 Word *Word::False = new Word("false", Tag::FALSE);
 Word *Word::And = new Word("&&", Tag::AND);
@@ -23,8 +39,19 @@ Word *Word::Minus = new Word("minus", Tag::MINUS);
 Word *Word::Temp = new Word("t", Tag::TEMP);
 
 Word::Word(const char *s, int tag)
+        : Word(StringInterner::Global().Intern(s, strlen(s)), tag)
+{
+}
+
+Word::Word(SymbolId id, int tag)
+        : Word(id, StringInterner::Global().GetSpelling(id), tag)
+{
+}
+
+Word::Word(SymbolId id, const char *s, int tag)
         : Token(tag)
 {
+    this->symbol = id;
     this->lexme = s;
 }
 
@@ -78,7 +105,7 @@ const char *Array::toString()
     return fmtstr("[%d] %s", size, of->toString());
 }
 
-Num::Num(int v)
+Num::Num(int64_t v)
         : Token(Tag::NUM)
 {
     this->value = v;
@@ -86,10 +113,10 @@ Num::Num(int v)
 
 const char *Num::toString()
 {
-    return fmtstr("%d", value);
+    return fmtstr("%lld", (long long) value);
 }
 
-Real::Real(float v)
+Real::Real(double v)
         : Token(Tag::REAL)
 {
     this->value = v;
@@ -1,3 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "AST/StringInterner.h"
+
 class Tag
 {
 public:
@@ -20,8 +27,10 @@ public:
         NUM,
         OR,
         REAL,
+        RETURN,
         TEMP,
         TRUE,
+        VOID,
         WHILE
     };
 };
@@ -34,15 +43,32 @@ public:
     Token(int t);
 
     virtual const char *toString();
+
+    // Shared token for a single character; the table lives for the whole run.
+    static Token *single(char c);
+
+private:
+    static std::vector<Token> singles;
 };
 
+inline Token *Token::single(char c)
+{
+    return &singles[(unsigned char) c];
+}
+
 class Word : public Token
 {
 public:
     const char *lexme;
+    SymbolId symbol;
 
     Word(const char *s, int tag);
 
+    Word(SymbolId id, int tag);
+
+    // For symbols from an interner other than the global one.
+    Word(SymbolId id, const char *s, int tag);
+
     const char *toString() override;
 
 public:
@@ -90,9 +116,9 @@ public:
 class Num : public Token
 {
 public:
-    int value;
+    int64_t value;
 public:
-    explicit Num(int v);
+    explicit Num(int64_t v);
 
     const char *toString() override;
 };
@@ -100,9 +126,9 @@ public:
 class Real : public Token
 {
 public:
-    float value;
+    double value;
 public:
-    explicit Real(float v);
+    explicit Real(double v);
 
     const char *toString() override;
 };
@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <thread>
+
+#include "TokenStream.h"
+#include "Lexer.h"
+#include "SourceBuffer.h"
+#include "Error.h"
+
+namespace
+{
+// Below this a piece is not worth a thread of its own.
+const size_t kMinChunk = 1 << 20;
+}
+
+// One piece of the source and the columns lexed from it. Every piece but the
+// first interns identifiers privately, so no locking is needed; the names
+// are moved into the global interner, in source order, when stitching.
+struct TokenStream::Chunk
+{
+    Lexer *lexer = nullptr;
+    bool global = false;
+    int firstLine = 1;              // of the piece in the whole source
+    size_t begin = 0;               // offset of the piece in the source
+    size_t size = 0;
+    StringInterner names;
+    std::vector<int16_t> tags;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<int> lines;
+    std::vector<Value> values;
+    std::vector<Word *> words;      // by global symbol
+    std::exception_ptr failure;
+
+    // Filled in while stitching.
+    size_t keep = 0;                // entries that make it into the stream
+    size_t at = 0;                  // where they go
+    std::vector<SymbolId> remap;    // private symbol to global symbol
+};
+
+TokenStream::TokenStream(SourceBuffer *source, unsigned threads, int firstLine)
+{
+    if (source->size() > UINT32_MAX)
+    {
+        size_t size = source->size();
+        delete source;
+        throw Error(fmtstr("Input of %zu bytes is too large for a token stream", size));
+    }
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    split(source, threads, firstLine, chunks);
+
+    std::vector<std::thread> workers;
+    for (size_t k = 1; k < chunks.size(); k++)
+    {
+        workers.emplace_back(&TokenStream::lex, std::ref(*chunks[k]));
+    }
+    lex(*chunks[0]);
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    for (auto &chunk : chunks)
+    {
+        if (chunk->failure)
+        {
+            for (Lexer *lexer : lexers)
+            {
+                delete lexer;
+            }
+            std::rethrow_exception(chunk->failure);
+        }
+    }
+
+    // Stitching: work out where every piece lands and settle its names
+    // in order, then copy the pieces into place side by side.
+    size_t total = 0;
+    size_t used = 0;
+    for (bool done = false; !done; used++)
+    {
+        done = prepare(*chunks[used], used + 1 == chunks.size(), total);
+    }
+
+    if (used == 1)
+    {
+        // Lexed in one piece: nothing to adjust.
+        Chunk &chunk = *chunks[0];
+        tags.swap(chunk.tags);
+        offsets.swap(chunk.offsets);
+        lengths.swap(chunk.lengths);
+        lines.swap(chunk.lines);
+        values.swap(chunk.values);
+        return;
+    }
+
+    tags.resize(total);
+    offsets.resize(total);
+    lengths.resize(total);
+    lines.resize(total);
+    values.resize(total);
+
+    workers.clear();
+    for (size_t k = 1; k < used; k++)
+    {
+        workers.emplace_back(&TokenStream::place, this, std::ref(*chunks[k]));
+    }
+    place(*chunks[0]);
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+TokenStream::~TokenStream()
+{
+    for (Lexer *lexer : lexers)
+    {
+        delete lexer;
+    }
+}
+
+void TokenStream::split(SourceBuffer *source, unsigned threads, int firstLine, std::vector<std::unique_ptr<Chunk>> &out)
+{
+    size_t size = source->size();
+    size_t pieces = threads;
+    if (pieces > size / kMinChunk)
+    {
+        pieces = size / kMinChunk;
+    }
+
+    if (pieces <= 1)
+    {
+        out.emplace_back(new Chunk);
+        out[0]->lexer = new Lexer(source);
+        out[0]->global = true;
+        out[0]->firstLine = firstLine;
+        out[0]->size = size;
+        lexers.push_back(out[0]->lexer);
+        return;
+    }
+
+    // No token spans a line, so a piece may start right after any newline
+    // and the lexer will see exactly the tokens it would have seen anyway.
+    // Each piece is told the line it starts on, so that the lines of its
+    // tokens and of its errors are those of the whole source.
+    const char *text = source->begin();
+    size_t begin = 0;
+    int line = firstLine;
+    for (size_t k = 1; k <= pieces && begin < size; k++)
+    {
+        size_t end = size;
+        if (k < pieces)
+        {
+            const void *nl = memchr(text + size * k / pieces, '\n', size - size * k / pieces);
+            end = nl ? static_cast<const char *>(nl) - text + 1 : size;
+        }
+        if (end <= begin)
+        {
+            continue;
+        }
+
+        auto *chunk = new Chunk;
+        out.emplace_back(chunk);
+        chunk->global = out.size() == 1;
+        chunk->firstLine = line;
+        chunk->begin = begin;
+        chunk->size = end - begin;
+        line += static_cast<int>(std::count(text + begin, text + end, '\n'));
+
+        // Each piece gets its own zero-padded copy, which the lexer needs
+        // to find its end.
+        auto *piece = new SourceBuffer(text + begin, end - begin);
+        chunk->lexer = chunk->global ? new Lexer(piece) : new Lexer(piece, chunk->names);
+        lexers.push_back(chunk->lexer);
+
+        begin = end;
+    }
+    delete source;
+}
+
+void TokenStream::lex(Chunk &chunk)
+{
+    try
+    {
+        Lexer &lexer = *chunk.lexer;
+
+        // The line count is per thread and the lexer was built on another.
+        Lexer::line = chunk.firstLine;
+
+        // Typical code has a token every three or four bytes; reserving for
+        // one every two avoids regrowth, and untouched capacity costs no memory.
+        size_t guess = chunk.size / 2 + 1;
+        chunk.tags.reserve(guess);
+        chunk.offsets.reserve(guess);
+        chunk.lengths.reserve(guess);
+        chunk.lines.reserve(guess);
+        chunk.values.reserve(guess);
+
+        for (;;)
+        {
+            Token *tok = lexer.gettok();
+
+            Value value;
+            value.integer = 0;
+            if (tok->tag == Tag::NUM)
+            {
+                value.integer = static_cast<Num *>(tok)->value;
+            } else if (tok->tag == Tag::REAL)
+            {
+                value.real = static_cast<Real *>(tok)->value;
+            } else if (tok->tag >= Tag::AND)
+            {
+                // Every other tag past the character range belongs to a Word.
+                auto *w = static_cast<Word *>(tok);
+                value.symbol = w->symbol;
+
+                if (chunk.global || w->tag != Tag::ID)
+                {
+                    if (w->symbol >= chunk.words.size())
+                    {
+                        chunk.words.resize(w->symbol + 1, nullptr);
+                    }
+                    chunk.words[w->symbol] = w;
+                }
+            }
+
+            chunk.tags.push_back(static_cast<int16_t>(tok->tag));
+            chunk.offsets.push_back(static_cast<uint32_t>(lexer.tokenOffset()));
+            chunk.lengths.push_back(static_cast<uint32_t>(lexer.tokenLength()));
+            chunk.lines.push_back(Lexer::line);
+            chunk.values.push_back(value);
+
+            if (tok->tag == EOF)
+            {
+                break;
+            }
+        }
+    } catch (...)
+    {
+        chunk.failure = std::current_exception();
+    }
+}
+
+// Decides where a piece's tokens go and maps its private symbols to global
+// ones; returns true once the stream is complete.
+bool TokenStream::prepare(Chunk &chunk, bool last, size_t &at)
+{
+    size_t n = chunk.tags.size();
+
+    // A piece ends in an EOF entry of its own, which only stays if this is
+    // the real end: the last piece, or a stray EOF byte the single-threaded
+    // lexer would have stopped at too.
+    bool done = last || chunk.offsets[n - 1] < chunk.size;
+    chunk.keep = done ? n : n - 1;
+    chunk.at = at;
+    at += chunk.keep;
+
+    for (size_t s = 0; s < chunk.words.size(); s++)
+    {
+        if (chunk.words[s])
+        {
+            wordFor(SymbolId(s), chunk.words[s]);
+        }
+    }
+
+    if (!chunk.global)
+    {
+        // Private ids are handed out in order of first use, so interning them
+        // piece by piece gives the ids a single lexer would have.
+        StringInterner &global = StringInterner::Global();
+        chunk.remap.resize(chunk.names.GetCount() + 1, StringInterner::kNoSymbol);
+        for (SymbolId id = 1; id < chunk.remap.size(); id++)
+        {
+            SymbolId symbol = global.Intern(chunk.names.GetSpelling(id), chunk.names.GetLength(id));
+            chunk.remap[id] = symbol;
+            if (symbol >= words.size() || !words[symbol])
+            {
+                wordFor(symbol, new(tokens.Allocate(sizeof(Word), alignof(Word))) Word(symbol, Tag::ID));
+            }
+        }
+    }
+
+    return done;
+}
+
+void TokenStream::place(Chunk &chunk)
+{
+    for (size_t i = 0, j = chunk.at; i < chunk.keep; i++, j++)
+    {
+        Value value = chunk.values[i];
+        if (!chunk.global && chunk.tags[i] == Tag::ID)
+        {
+            value.symbol = chunk.remap[value.symbol];
+        }
+
+        tags[j] = chunk.tags[i];
+        offsets[j] = static_cast<uint32_t>(chunk.offsets[i] + chunk.begin);
+        lengths[j] = chunk.lengths[i];
+        lines[j] = chunk.lines[i];
+        values[j] = value;
+    }
+}
+
+void TokenStream::wordFor(SymbolId id, Word *w)
+{
+    if (id >= words.size())
+    {
+        words.resize(id + 1, nullptr);
+    }
+    if (!words[id])
+    {
+        words[id] = w;
+    }
+}
+
+uint32_t TokenStream::offset(size_t i) const
+{
+    return i < offsets.size() ? offsets[i] : offsets.back();
+}
+
+uint32_t TokenStream::length(size_t i) const
+{
+    return i < lengths.size() ? lengths[i] : 0;
+}
+
+int TokenStream::line(size_t i) const
+{
+    return i < lines.size() ? lines[i] : lines.back();
+}
+
+SymbolId TokenStream::symbol(size_t i) const
+{
+    return values[i].symbol;
+}
+
+int64_t TokenStream::intValue(size_t i) const
+{
+    return values[i].integer;
+}
+
+double TokenStream::realValue(size_t i) const
+{
+    return values[i].real;
+}
+
+Token *TokenStream::token(size_t i)
+{
+    return token(i, tokens);
+}
+
+Token *TokenStream::token(size_t i, Arena &arena) const
+{
+    int t = tag(i);
+    switch (t)
+    {
+        case Tag::NUM:
+            return new(arena.Allocate(sizeof(Num), alignof(Num))) Num(values[i].integer);
+        case Tag::REAL:
+            return new(arena.Allocate(sizeof(Real), alignof(Real))) Real(values[i].real);
+        default:
+            if (t >= Tag::AND)
+            {
+                return words[values[i].symbol];
+            }
+            return Token::single(static_cast<char>(t));
+    }
+}
+
+size_t TokenStream::chunks() const
+{
+    return lexers.size();
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "AST/Arena.h"
+#include "Token.h"
+
+class Lexer;
+class SourceBuffer;
+
+// The whole file lexed up front into parallel arrays, one entry per token
+// and a final EOF entry. The parser walks it by index, so it can look any
+// number of tokens ahead, and lexing shows up on its own in a profile.
+class TokenStream
+{
+public:
+    // Takes ownership of the source. Given more than one thread, a large
+    // source is cut at newlines and the pieces are lexed in parallel; the
+    // stream comes out exactly as if it had been lexed on one thread. Lines
+    // are numbered from firstLine, for sources cut out of a larger file.
+    explicit TokenStream(SourceBuffer *source, unsigned threads = 1, int firstLine = 1);
+
+    ~TokenStream();
+
+    // Number of tokens, the EOF entry included.
+    size_t size() const;
+
+    // Indices past the end read as EOF.
+    int tag(size_t i) const;
+
+    uint32_t offset(size_t i) const;
+
+    uint32_t length(size_t i) const;
+
+    int line(size_t i) const;
+
+    // Only meaningful for the matching kind of token: words, Num or Real.
+    SymbolId symbol(size_t i) const;
+
+    int64_t intValue(size_t i) const;
+
+    double realValue(size_t i) const;
+
+    // A Token object for entry i, for code that still works on tokens.
+    // Literal tokens are made on demand and live as long as the stream.
+    Token *token(size_t i);
+
+    // The same, with literal tokens made in the caller's arena; parsers on
+    // several threads can share the stream this way.
+    Token *token(size_t i, Arena &arena) const;
+
+    // How many pieces the source was lexed in.
+    size_t chunks() const;
+
+private:
+    TokenStream(const TokenStream &) = delete;
+
+    TokenStream &operator=(const TokenStream &) = delete;
+
+    union Value
+    {
+        SymbolId symbol;
+        int64_t integer;
+        double real;
+    };
+
+    struct Chunk;
+
+    std::vector<Lexer *> lexers;    // own the keyword and identifier words
+    std::vector<int16_t> tags;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<int> lines;
+    std::vector<Value> values;
+    std::vector<Word *> words;      // indexed by symbol
+    Arena tokens;                   // literal and stitched identifier tokens
+
+    void split(SourceBuffer *source, unsigned threads, int firstLine, std::vector<std::unique_ptr<Chunk>> &out);
+
+    static void lex(Chunk &chunk);
+
+    bool prepare(Chunk &chunk, bool last, size_t &at);
+
+    void place(Chunk &chunk);
+
+    void wordFor(SymbolId id, Word *w);
+};
+
+inline size_t TokenStream::size() const
+{
+    return tags.size();
+}
+
+inline int TokenStream::tag(size_t i) const
+{
+    return i < tags.size() ? tags[i] : EOF;
+}
@@ -0,0 +1,83 @@
+#include "Bench.h"
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+struct Result
+{
+	std::string name;
+	double seconds;
+	double rate;
+	std::string unit;
+};
+
+std::vector<Result> g_results;
+
+std::string Quote(const std::string& text)
+{
+	std::string out = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+		}
+		out += c;
+	}
+	return out + "\"";
+}
+}
+
+double Bench::Measure(const std::function<void()>& body, double minSeconds)
+{
+	using Clock = std::chrono::steady_clock;
+
+	double best = 0;
+	double total = 0;
+	size_t runs = 0;
+
+	while (runs == 0 || total < minSeconds)
+	{
+		const auto start = Clock::now();
+		body();
+		const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		best = (runs == 0 || elapsed < best) ? elapsed : best;
+		total += elapsed;
+		++runs;
+	}
+	return best;
+}
+
+void Bench::Report(const std::string& name, double seconds, double units, const std::string& unitName)
+{
+	printf("%-32s %10.3f ms %12.2f %s/s\n", name.c_str(), seconds * 1e3, units / seconds, unitName.c_str());
+	g_results.push_back(Result{ name, seconds, units / seconds, unitName + "/s" });
+}
+
+void Bench::WriteJson(const std::string& path)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+	{
+		throw std::runtime_error("cannot write " + path);
+	}
+
+	fprintf(file, "{\n  \"hardware_threads\": %u,\n  \"benchmarks\": [", std::thread::hardware_concurrency());
+	for (size_t i = 0; i < g_results.size(); ++i)
+	{
+		const Result& result = g_results[i];
+		fprintf(file, "%s\n    { \"name\": %s, \"seconds\": %.9g, \"rate\": %.9g, \"unit\": %s }", i ? "," : "",
+			Quote(result.name).c_str(), result.seconds, result.rate, Quote(result.unit).c_str());
+	}
+	fprintf(file, "\n  ]\n}\n");
+
+	if (fclose(file) != 0)
+	{
+		throw std::runtime_error("cannot write " + path);
+	}
+}
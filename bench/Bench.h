@@ -0,0 +1,20 @@
+#pragma once
+#include <functional>
+#include <string>
+
+// Tiny timing harness for compiler_bench.
+class Bench
+{
+public:
+	// Runs body until at least minSeconds have passed (and at least once)
+	// and returns the fastest single run, in seconds.
+	static double Measure(const std::function<void()>& body, double minSeconds = 0.5);
+
+	// Prints one result line: name, time per run and throughput. The result
+	// is also kept for WriteJson.
+	static void Report(const std::string& name, double seconds, double units, const std::string& unitName);
+
+	// Writes every result reported so far to path as JSON, for comparing
+	// runs across releases.
+	static void WriteJson(const std::string& path);
+};
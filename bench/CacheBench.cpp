@@ -0,0 +1,106 @@
+#include "Bench.h"
+#include "SourceGenerator.h"
+#include "../ASTCache.h"
+#include "../Parser.h"
+#include "../SourceBuffer.h"
+#include "../TokenStream.h"
+#include "../AST/ASTContext.h"
+#include "../AST/FlatAST.h"
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace
+{
+const size_t gcMaxCacheBytes = 16 << 20;
+
+// A miss: the source is lexed and parsed and its tree stored.
+void Cold(const ASTCache& cache, const std::string& text, std::string* image = nullptr)
+{
+	const std::string key = ASTCache::key(text.data(), text.size());
+	TokenStream stream(new SourceBuffer(text.data(), text.size()));
+	ASTContext context;
+	Parser parser(&stream, context);
+	const FlatAST flat(*parser.program());
+	if (!cache.store(key, flat))
+	{
+		throw std::runtime_error("cannot write to the cache directory");
+	}
+	if (image)
+	{
+		flat.Save(*image);
+	}
+}
+
+// A hit: the stored tree is mapped and every function built from it, or
+// only the first, as a compiler asked about one function would.
+void Warm(const ASTCache& cache, const std::string& text, bool all, std::string* image = nullptr)
+{
+	std::unique_ptr<ASTCache::Entry> entry = cache.find(ASTCache::key(text.data(), text.size()));
+	if (!entry)
+	{
+		throw std::runtime_error("stored tree not found in the cache");
+	}
+	const FlatAST& tree = entry->tree();
+	ASTContext context;
+	FlatAST again;
+	for (size_t i = 0; i < (all ? tree.GetFunctionsCount() : 1); ++i)
+	{
+		const FunctionAST* function = tree.BuildFunction(tree.GetFunction(i), context);
+		if (image)
+		{
+			again.AddFunction(*function);
+		}
+	}
+	if (image)
+	{
+		again.Save(*image);
+	}
+}
+}
+
+// An unchanged source costs a hash of its text and building the nodes,
+// instead of lexing and parsing it.
+void RunCacheBench(size_t bytes)
+{
+	const std::string text = SourceGenerator::GenerateFunctions(bytes < gcMaxCacheBytes ? bytes : gcMaxCacheBytes);
+	const double megabytes = double(text.size()) / (1 << 20);
+
+	char directory[] = "/tmp/compiler_bench.XXXXXX";
+	if (!mkdtemp(directory))
+	{
+		throw std::runtime_error("cannot make a cache directory");
+	}
+	const ASTCache cache(directory);
+	const std::string file = std::string(directory) + "/" + ASTCache::key(text.data(), text.size()) + ".ast";
+
+	try
+	{
+		std::string parsed;
+		std::string built;
+		Cold(cache, text, &parsed);
+		Warm(cache, text, true, &built);
+		if (built != parsed)
+		{
+			throw std::runtime_error("tree built from the cache differs from the parsed one");
+		}
+
+		const double cold = Bench::Measure([&] { Cold(cache, text); });
+		Bench::Report("cache/cold", cold, megabytes, "MB");
+		const double warm = Bench::Measure([&] { Warm(cache, text, true); });
+		Bench::Report("cache/warm", warm, megabytes, "MB");
+		printf("%-32s %10.1fx faster than a miss\n", "", cold / warm);
+
+		const double first = Bench::Measure([&] { Warm(cache, text, false); });
+		Bench::Report("cache/warm/one-function", first, megabytes, "MB");
+	}
+	catch (...)
+	{
+		unlink(file.c_str());
+		rmdir(directory);
+		throw;
+	}
+	unlink(file.c_str());
+	rmdir(directory);
+}
@@ -0,0 +1,49 @@
+#include "Bench.h"
+#include "SourceGenerator.h"
+#include "../Parser.h"
+#include "../SourceBuffer.h"
+#include "../TokenStream.h"
+#include "../AST/ASTContext.h"
+#include "../codegen/CodegenContext.h"
+#include "../codegen/CodegenVisitor.h"
+#include "../codegen/TypeChecker.h"
+#include <stdexcept>
+
+namespace
+{
+// Every run builds a fresh LLVM module, which is far slower per byte than
+// parsing, so the input is kept small.
+const size_t gcMaxCodegenBytes = 1 << 20;
+
+// Lowers the whole program into a module of its own, as the compiler does.
+void GenerateAll(const ProgramAST& program)
+{
+	CodegenContext context;
+	Codegen codegen(context);
+	codegen.Generate(program);
+}
+}
+
+void RunCodegenBench(size_t bytes)
+{
+	// The generated functions report through print, which the language
+	// does not provide.
+	const std::string text = "void print(float value, int result)\n{\n}\n\n"
+		+ SourceGenerator::GenerateFunctions(bytes < gcMaxCodegenBytes ? bytes : gcMaxCodegenBytes);
+	TokenStream stream(new SourceBuffer(text.data(), text.size()));
+
+	ASTContext context;
+	Parser parser(&stream, context);
+	const ProgramAST* program = parser.program();
+	if (program->GetFunctionsCount() == 0)
+	{
+		throw std::runtime_error("codegen benchmark parsed nothing");
+	}
+
+	// Part of codegen, shown on its own for its share of the time.
+	const double check = Bench::Measure([&] { TypeChecker().Check(*program); });
+	Bench::Report("codegen/typecheck", check, double(program->GetFunctionsCount()), "functions");
+
+	const double seconds = Bench::Measure([&] { GenerateAll(*program); });
+	Bench::Report("codegen/functions", seconds, double(program->GetFunctionsCount()), "functions");
+}
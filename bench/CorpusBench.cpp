@@ -0,0 +1,173 @@
+#include "Bench.h"
+#include "../Lexer.h"
+#include "../Parser.h"
+#include "../SourceBuffer.h"
+#include "../TokenStream.h"
+#include "../AST/ASTContext.h"
+#include "../AST/FlatAST.h"
+#include "../codegen/CodegenContext.h"
+#include "../codegen/CodegenVisitor.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+std::string ReadFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		throw std::runtime_error("cannot read " + path);
+	}
+	std::ostringstream text;
+	text << file.rdbuf();
+	return text.str();
+}
+
+std::string BaseName(const std::string& path)
+{
+	const size_t slash = path.find_last_of('/');
+	return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+size_t LexAll(const std::string& text)
+{
+	Lexer lexer(new SourceBuffer(text.data(), text.size()));
+
+	size_t count = 0;
+	while (lexer.gettok()->tag != EOF)
+	{
+		++count;
+	}
+	return count;
+}
+
+// A program of functions or else a single block, chosen the way the
+// compiler chooses. Either way the tree is returned as a generator that
+// lowers it into a fresh module.
+std::function<void()> Parse(TokenStream& stream, ASTContext& context)
+{
+	Parser parser(&stream, context);
+	if (parser.look->tag == '{')
+	{
+		const IStatementAST* block = parser.stmt();
+		return [block] {
+			CodegenContext codegenContext;
+			Codegen(codegenContext).Generate(*block);
+		};
+	}
+	const ProgramAST* program = parser.program();
+	return [program] {
+		CodegenContext codegenContext;
+		Codegen(codegenContext).Generate(*program);
+	};
+}
+
+// Flattens the tree the compiler would build, in the same two shapes.
+void Flatten(TokenStream& stream, ASTContext& context, FlatAST& flat)
+{
+	Parser parser(&stream, context);
+	if (parser.look->tag == '{')
+	{
+		flat.AddStatement(*parser.stmt());
+		return;
+	}
+	const ProgramAST* program = parser.program();
+	for (size_t i = 0; i < program->GetFunctionsCount(); ++i)
+	{
+		flat.AddFunction(program->GetFunction(i));
+	}
+}
+
+// Builds the tree of a cache image again and, if asked, flattens it into
+// again.
+void Rebuild(const FlatAST& loaded, ASTContext& context, FlatAST* again)
+{
+	if (loaded.GetFunctionsCount() == 0 && loaded.GetSize() > 0)
+	{
+		const IStatementAST* block = loaded.BuildStatement(FlatAST::Index(loaded.GetSize() - 1), context);
+		if (again)
+		{
+			again->AddStatement(*block);
+		}
+	}
+	for (size_t i = 0; i < loaded.GetFunctionsCount(); ++i)
+	{
+		const FunctionAST* function = loaded.BuildFunction(loaded.GetFunction(i), context);
+		if (again)
+		{
+			again->AddFunction(*function);
+		}
+	}
+}
+}
+
+// Times each stage on real sources, so a change that only helps the
+// synthetic inputs shows up as such, and checks that their trees survive
+// the cache. Files the front end rejects are skipped with the reason.
+void RunCorpusBench(const std::vector<std::string>& files)
+{
+	for (const std::string& path : files)
+	{
+		const std::string text = ReadFile(path);
+		const std::string name = "corpus/" + BaseName(path);
+		const double kilobytes = double(text.size()) / 1024;
+		bool cached = true;
+
+		try
+		{
+			const double lex = Bench::Measure([&] { LexAll(text); });
+			Bench::Report(name + "/lexer", lex, kilobytes, "KB");
+
+			TokenStream stream(new SourceBuffer(text.data(), text.size()));
+			size_t nodes = 0;
+			const double parse = Bench::Measure([&] {
+				ASTContext context;
+				Parse(stream, context);
+				nodes = context.GetNodeCount();
+			});
+			Bench::Report(name + "/parser", parse, double(nodes), "nodes");
+
+			ASTContext context;
+			const std::function<void()> generate = Parse(stream, context);
+			const double codegen = Bench::Measure(generate);
+			Bench::Report(name + "/codegen", codegen, kilobytes, "KB");
+
+			// What a cache hit does instead of lexing and parsing: read the
+			// tree from its image and build the nodes. The rebuilt tree must
+			// give the same image back.
+			ASTContext flatContext;
+			FlatAST flat;
+			Flatten(stream, flatContext, flat);
+			std::string image;
+			flat.Save(image);
+			std::vector<uint64_t> aligned((image.size() + 7) / 8);
+			memcpy(aligned.data(), image.data(), image.size());
+
+			const double load = Bench::Measure([&] {
+				ASTContext loadContext;
+				Rebuild(FlatAST(aligned.data(), image.size()), loadContext, nullptr);
+			});
+			Bench::Report(name + "/cache", load, double(nodes), "nodes");
+
+			ASTContext rebuiltContext;
+			FlatAST again;
+			Rebuild(FlatAST(aligned.data(), image.size()), rebuiltContext, &again);
+			std::string second;
+			again.Save(second);
+			cached = second == image;
+		}
+		catch (const std::exception& e)
+		{
+			const std::string reason = e.what() ? e.what() : "";
+			printf("%-32s skipped: %s\n", name.c_str(), reason.substr(0, reason.find('\n')).c_str());
+		}
+		if (!cached)
+		{
+			throw std::runtime_error(path + ": tree read back from its cache image differs");
+		}
+	}
+}
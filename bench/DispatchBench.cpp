@@ -0,0 +1,304 @@
+#include "Bench.h"
+#include "SourceGenerator.h"
+#include "../Parser.h"
+#include "../SourceBuffer.h"
+#include "../TokenStream.h"
+#include "../AST/AST.h"
+#include "../AST/ASTContext.h"
+#include "../AST/SwitchVisitor.h"
+#include "../codegen/CodegenContext.h"
+#include "../codegen/CodegenVisitor.h"
+#include <cstdio>
+#include <stdexcept>
+
+namespace
+{
+const size_t gcMaxDispatchBytes = 4 << 20;
+
+// Codegen builds LLVM instructions for every node, so it gets less input.
+const size_t gcMaxExpressionCodegenBytes = 256 << 10;
+
+// Both walks count the nodes they reach and do nothing else, so what they
+// measure is the cost of getting from a node to the code for its class.
+class AcceptCount
+	: public IExpressionVisitor
+	, public IStatementVisitor
+{
+public:
+	size_t Run(const IStatementAST& statement)
+	{
+		m_count = 0;
+		statement.Accept(*this);
+		return m_count;
+	}
+
+	void Visit(const BinaryExpressionAST& node) override
+	{
+		++m_count;
+		node.GetLeft().Accept(*this);
+		node.GetRight().Accept(*this);
+	}
+
+	void Visit(const LiteralConstantAST&) override
+	{
+		++m_count;
+	}
+
+	void Visit(const UnaryAST& node) override
+	{
+		++m_count;
+		node.GetExpr().Accept(*this);
+	}
+
+	void Visit(const IdentifierAST&) override
+	{
+		++m_count;
+	}
+
+	void Visit(const FunctionCallExprAST& node) override
+	{
+		++m_count;
+		for (size_t i = 0; i < node.GetParamsCount(); ++i)
+		{
+			node.GetParam(i).Accept(*this);
+		}
+	}
+
+	void Visit(const ArrayElementAccessAST& node) override
+	{
+		++m_count;
+		node.GetIndex().Accept(*this);
+	}
+
+	void Visit(const VariableDeclarationAST& node) override
+	{
+		++m_count;
+		if (node.GetExpression())
+		{
+			node.GetExpression()->Accept(*this);
+		}
+	}
+
+	void Visit(const AssignStatementAST& node) override
+	{
+		++m_count;
+		node.GetExpr().Accept(*this);
+	}
+
+	void Visit(const ArrayElementAssignAST& node) override
+	{
+		++m_count;
+		node.GetIndex().Accept(*this);
+		node.GetExpression().Accept(*this);
+	}
+
+	void Visit(const ReturnStatementAST& node) override
+	{
+		++m_count;
+		if (node.GetExpression())
+		{
+			node.GetExpression()->Accept(*this);
+		}
+	}
+
+	void Visit(const IfStatementAST& node) override
+	{
+		++m_count;
+		node.GetExpr().Accept(*this);
+		node.GetThenStmt().Accept(*this);
+		if (node.GetElseStmt())
+		{
+			node.GetElseStmt()->Accept(*this);
+		}
+	}
+
+	void Visit(const WhileStatementAST& node) override
+	{
+		++m_count;
+		node.GetExpr().Accept(*this);
+		node.GetStatement().Accept(*this);
+	}
+
+	void Visit(const CompositeStatementAST& node) override
+	{
+		++m_count;
+		for (size_t i = 0; i < node.GetCount(); ++i)
+		{
+			node.GetStatement(i).Accept(*this);
+		}
+	}
+
+	void Visit(const PrintAST& node) override
+	{
+		++m_count;
+		for (size_t i = 0; i < node.GetParamsCount(); ++i)
+		{
+			node.GetExpression(i).Accept(*this);
+		}
+	}
+
+	void Visit(const FunctionCallStatementAST& node) override
+	{
+		++m_count;
+		node.GetCall().Accept(*this);
+	}
+
+private:
+	size_t m_count = 0;
+};
+
+class SwitchCount
+	: public ExpressionSwitch<SwitchCount, size_t>
+	, public StatementSwitch<SwitchCount, size_t>
+{
+public:
+	using ExpressionSwitch<SwitchCount, size_t>::Dispatch;
+	using StatementSwitch<SwitchCount, size_t>::Dispatch;
+
+	size_t Visit(const BinaryExpressionAST& node)
+	{
+		return 1 + Dispatch(node.GetLeft()) + Dispatch(node.GetRight());
+	}
+
+	size_t Visit(const LiteralConstantAST&)
+	{
+		return 1;
+	}
+
+	size_t Visit(const UnaryAST& node)
+	{
+		return 1 + Dispatch(node.GetExpr());
+	}
+
+	size_t Visit(const IdentifierAST&)
+	{
+		return 1;
+	}
+
+	size_t Visit(const FunctionCallExprAST& node)
+	{
+		size_t count = 1;
+		for (size_t i = 0; i < node.GetParamsCount(); ++i)
+		{
+			count += Dispatch(node.GetParam(i));
+		}
+		return count;
+	}
+
+	size_t Visit(const ArrayElementAccessAST& node)
+	{
+		return 1 + Dispatch(node.GetIndex());
+	}
+
+	size_t Visit(const VariableDeclarationAST& node)
+	{
+		return 1 + (node.GetExpression() ? Dispatch(*node.GetExpression()) : 0);
+	}
+
+	size_t Visit(const AssignStatementAST& node)
+	{
+		return 1 + Dispatch(node.GetExpr());
+	}
+
+	size_t Visit(const ArrayElementAssignAST& node)
+	{
+		return 1 + Dispatch(node.GetIndex()) + Dispatch(node.GetExpression());
+	}
+
+	size_t Visit(const ReturnStatementAST& node)
+	{
+		return 1 + (node.GetExpression() ? Dispatch(*node.GetExpression()) : 0);
+	}
+
+	size_t Visit(const IfStatementAST& node)
+	{
+		return 1 + Dispatch(node.GetExpr()) + Dispatch(node.GetThenStmt())
+			+ (node.GetElseStmt() ? Dispatch(*node.GetElseStmt()) : 0);
+	}
+
+	size_t Visit(const WhileStatementAST& node)
+	{
+		return 1 + Dispatch(node.GetExpr()) + Dispatch(node.GetStatement());
+	}
+
+	size_t Visit(const CompositeStatementAST& node)
+	{
+		size_t count = 1;
+		for (size_t i = 0; i < node.GetCount(); ++i)
+		{
+			count += Dispatch(node.GetStatement(i));
+		}
+		return count;
+	}
+
+	size_t Visit(const PrintAST& node)
+	{
+		size_t count = 1;
+		for (size_t i = 0; i < node.GetParamsCount(); ++i)
+		{
+			count += Dispatch(node.GetExpression(i));
+		}
+		return count;
+	}
+
+	size_t Visit(const FunctionCallStatementAST& node)
+	{
+		return 1 + Dispatch(node.GetCall());
+	}
+};
+
+// Lowers the block into a main function of a module of its own. Not folded:
+// the expressions are all constants and nothing would be left to lower.
+void GenerateBlock(const IStatementAST& block)
+{
+	CodegenContext context;
+	Codegen codegen(context, false);
+	codegen.Generate(block);
+}
+}
+
+// Wide expression trees, where getting to the code for a node is a large
+// part of the work done for it.
+void RunDispatchBench(size_t bytes, size_t width)
+{
+	const std::string text = SourceGenerator::GenerateExpressions(bytes < gcMaxDispatchBytes ? bytes : gcMaxDispatchBytes, width);
+	TokenStream stream(new SourceBuffer(text.data(), text.size()));
+
+	ASTContext context;
+	Parser parser(&stream, context);
+	const IStatementAST* block = parser.stmt();
+	if (!block)
+	{
+		throw std::runtime_error("dispatch benchmark parsed nothing");
+	}
+
+	AcceptCount acceptCount;
+	SwitchCount switchCount;
+	const size_t nodes = acceptCount.Run(*block);
+	if (switchCount.Dispatch(*block) != nodes)
+	{
+		throw std::runtime_error("switch dispatch reached a different number of nodes");
+	}
+
+	size_t reached = 0;
+	const double accept = Bench::Measure([&] { reached = acceptCount.Run(*block); });
+	Bench::Report("ast/dispatch/accept", accept, double(nodes), "nodes");
+	const double direct = Bench::Measure([&] { reached = switchCount.Dispatch(*block); });
+	Bench::Report("ast/dispatch/switch", direct, double(nodes), "nodes");
+	printf("%-32s %10.2f ns per node saved\n", "", (accept - direct) * 1e9 / double(nodes));
+	(void)reached;
+
+	// Codegen needs source that type-checks, with names that keep the
+	// builder from folding it.
+	const std::string arithmetic = SourceGenerator::GenerateArithmetic(
+		bytes < gcMaxExpressionCodegenBytes ? bytes : gcMaxExpressionCodegenBytes, width);
+	TokenStream arithmeticStream(new SourceBuffer(arithmetic.data(), arithmetic.size()));
+	ASTContext arithmeticContext;
+	Parser arithmeticParser(&arithmeticStream, arithmeticContext);
+	const IStatementAST* arithmeticBlock = arithmeticParser.stmt();
+	const size_t arithmeticNodes = switchCount.Dispatch(*arithmeticBlock);
+	GenerateBlock(*arithmeticBlock);
+
+	const double seconds = Bench::Measure([&] { GenerateBlock(*arithmeticBlock); });
+	Bench::Report("codegen/expressions", seconds, double(arithmeticNodes), "nodes");
+}
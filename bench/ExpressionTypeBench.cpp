@@ -0,0 +1,96 @@
+#include "Bench.h"
+#include "../AST/ExpressionType.h"
+#include <cstdio>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace
+{
+const size_t gcTypePairs = 1 << 16;
+
+// The lookups as they were, in std::map, for comparison.
+const std::map<ExpressionType, std::set<ExpressionType>> gcMapCasts = {
+	{ ExpressionType::Int, { ExpressionType::Float, ExpressionType::Bool } },
+	{ ExpressionType::Float, { ExpressionType::Int, ExpressionType::Bool } },
+	{ ExpressionType::Bool, { ExpressionType::Int, ExpressionType::Float } }
+};
+
+const std::map<std::pair<ExpressionType, ExpressionType>, ExpressionType> gcMapBinaryCasts = {
+	{ { ExpressionType::Int, ExpressionType::Float }, ExpressionType::Float },
+	{ { ExpressionType::Int, ExpressionType::Bool }, ExpressionType::Int },
+	{ { ExpressionType::Float, ExpressionType::Int }, ExpressionType::Float },
+	{ { ExpressionType::Float, ExpressionType::Bool }, ExpressionType::Float },
+	{ { ExpressionType::Bool, ExpressionType::Int }, ExpressionType::Int },
+	{ { ExpressionType::Bool, ExpressionType::Float }, ExpressionType::Float }
+};
+
+bool MapConvertible(ExpressionType from, ExpressionType to)
+{
+	if (from == to)
+	{
+		return true;
+	}
+	auto found = gcMapCasts.find(from);
+	return found != gcMapCasts.end() && found->second.count(to) != 0;
+}
+
+boost::optional<ExpressionType> MapPreferredType(ExpressionType left, ExpressionType right)
+{
+	if (left == right)
+	{
+		return left;
+	}
+	auto found = gcMapBinaryCasts.find(std::make_pair(left, right));
+	if (found == gcMapBinaryCasts.end())
+	{
+		return boost::none;
+	}
+	return found->second;
+}
+
+// Adds up the answers for every pair, so the lookups cannot be skipped.
+template <typename Convertible, typename Preferred>
+size_t Sum(const std::vector<std::pair<ExpressionType, ExpressionType>>& pairs,
+	Convertible&& convertible, Preferred&& preferred)
+{
+	size_t sum = 0;
+	for (const auto& pair : pairs)
+	{
+		const boost::optional<ExpressionType> type = preferred(pair.first, pair.second);
+		sum += convertible(pair.first, pair.second) + (type ? size_t(*type) + 1 : 0);
+	}
+	return sum;
+}
+}
+
+// What codegen and the type checker ask for every binary operator and
+// every assignment.
+void RunExpressionTypeBench()
+{
+	// Mostly numbers and booleans, as in real source.
+	std::mt19937_64 random(7);
+	std::discrete_distribution<int> type({ 8, 4, 3, 1 });
+	std::vector<std::pair<ExpressionType, ExpressionType>> pairs(gcTypePairs);
+	for (auto& pair : pairs)
+	{
+		pair = std::make_pair(ExpressionType(type(random)), ExpressionType(type(random)));
+	}
+
+	const size_t expected = Sum(pairs, MapConvertible, MapPreferredType);
+	if (Sum(pairs, Convertible, GetPreferredType) != expected)
+	{
+		throw std::runtime_error("type tables disagree with the maps they replace");
+	}
+
+	size_t sum = 0;
+	const double map = Bench::Measure([&] { sum += Sum(pairs, MapConvertible, MapPreferredType); });
+	Bench::Report("types/lookup/map", map, double(pairs.size()), "pairs");
+	const double table = Bench::Measure([&] { sum += Sum(pairs, Convertible, GetPreferredType); });
+	Bench::Report("types/lookup/table", table, double(pairs.size()), "pairs");
+	printf("%-32s %10.1fx faster, %.2f ns per pair\n", "", map / table, table * 1e9 / double(pairs.size()));
+	(void)sum;
+}
@@ -0,0 +1,204 @@
+#include "Bench.h"
+#include "SourceGenerator.h"
+#include "../Parser.h"
+#include "../SourceBuffer.h"
+#include "../TokenStream.h"
+#include "../AST/AST.h"
+#include "../AST/ASTContext.h"
+#include "../AST/FlatAST.h"
+#include <stdexcept>
+
+namespace
+{
+const size_t gcMaxFlatBytes = 16 << 20;
+
+// The pass both layouts run: counts the names read and adds up the integer
+// literals, touching every node once.
+struct Tally
+{
+	size_t names = 0;
+	long long integers = 0;
+
+	bool operator==(const Tally& other)const
+	{
+		return names == other.names && integers == other.integers;
+	}
+};
+
+class TreeTally
+	: public IExpressionVisitor
+	, public IStatementVisitor
+{
+public:
+	Tally Run(const ProgramAST& program)
+	{
+		m_tally = Tally();
+		for (size_t i = 0; i < program.GetFunctionsCount(); ++i)
+		{
+			program.GetFunction(i).GetStatement().Accept(*this);
+		}
+		return m_tally;
+	}
+
+	void Visit(const BinaryExpressionAST& node) override
+	{
+		node.GetLeft().Accept(*this);
+		node.GetRight().Accept(*this);
+	}
+
+	void Visit(const LiteralConstantAST& node) override
+	{
+		if (node.GetType() == ExpressionType::Int)
+		{
+			m_tally.integers += node.GetInt();
+		}
+	}
+
+	void Visit(const UnaryAST& node) override
+	{
+		node.GetExpr().Accept(*this);
+	}
+
+	void Visit(const IdentifierAST&) override
+	{
+		++m_tally.names;
+	}
+
+	void Visit(const FunctionCallExprAST& node) override
+	{
+		for (size_t i = 0; i < node.GetParamsCount(); ++i)
+		{
+			node.GetParam(i).Accept(*this);
+		}
+	}
+
+	void Visit(const ArrayElementAccessAST& node) override
+	{
+		node.GetIndex().Accept(*this);
+	}
+
+	void Visit(const VariableDeclarationAST& node) override
+	{
+		if (node.GetExpression())
+		{
+			node.GetExpression()->Accept(*this);
+		}
+	}
+
+	void Visit(const AssignStatementAST& node) override
+	{
+		node.GetExpr().Accept(*this);
+	}
+
+	void Visit(const ArrayElementAssignAST& node) override
+	{
+		node.GetIndex().Accept(*this);
+		node.GetExpression().Accept(*this);
+	}
+
+	void Visit(const ReturnStatementAST& node) override
+	{
+		if (node.GetExpression())
+		{
+			node.GetExpression()->Accept(*this);
+		}
+	}
+
+	void Visit(const IfStatementAST& node) override
+	{
+		node.GetExpr().Accept(*this);
+		node.GetThenStmt().Accept(*this);
+		if (node.GetElseStmt())
+		{
+			node.GetElseStmt()->Accept(*this);
+		}
+	}
+
+	void Visit(const WhileStatementAST& node) override
+	{
+		node.GetExpr().Accept(*this);
+		node.GetStatement().Accept(*this);
+	}
+
+	void Visit(const CompositeStatementAST& node) override
+	{
+		for (size_t i = 0; i < node.GetCount(); ++i)
+		{
+			node.GetStatement(i).Accept(*this);
+		}
+	}
+
+	void Visit(const PrintAST& node) override
+	{
+		for (size_t i = 0; i < node.GetParamsCount(); ++i)
+		{
+			node.GetExpression(i).Accept(*this);
+		}
+	}
+
+	void Visit(const FunctionCallStatementAST& node) override
+	{
+		node.GetCall().Accept(*this);
+	}
+
+private:
+	Tally m_tally;
+};
+
+// Every row is reachable from some function, so the pass needs no walk.
+Tally FlatTally(const FlatAST& flat)
+{
+	Tally tally;
+	for (FlatAST::Index node = 0; node < flat.GetSize(); ++node)
+	{
+		switch (flat.GetKind(node))
+		{
+		case FlatAST::Kind::Identifier:
+			++tally.names;
+			break;
+		case FlatAST::Kind::Literal:
+			if (ExpressionType(flat.GetOperator(node)) == ExpressionType::Int)
+			{
+				tally.integers += flat.GetPayload(node).integer;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return tally;
+}
+}
+
+void RunFlatASTBench(size_t bytes)
+{
+	const std::string text = SourceGenerator::GenerateFunctions(bytes < gcMaxFlatBytes ? bytes : gcMaxFlatBytes);
+	TokenStream stream(new SourceBuffer(text.data(), text.size()));
+
+	ASTContext context;
+	Parser parser(&stream, context);
+	const ProgramAST& program = *parser.program();
+
+	const FlatAST flat(program);
+	const double flatten = Bench::Measure([&] { FlatAST copy(program); });
+	Bench::Report("ast/flatten", flatten, double(flat.GetSize()), "nodes");
+
+	TreeTally treeTally;
+	Tally expected;
+	const double tree = Bench::Measure([&] { expected = treeTally.Run(program); });
+	Bench::Report("ast/walk/tree", tree, double(flat.GetSize()), "nodes");
+
+	Tally tally;
+	const double rows = Bench::Measure([&] { tally = FlatTally(flat); });
+	Bench::Report("ast/walk/flat", rows, double(flat.GetSize()), "nodes");
+
+	// The tree built back from the rows must flatten to the same rows.
+	ASTContext rebuiltContext;
+	ProgramAST rebuilt;
+	flat.BuildProgram(rebuiltContext, rebuilt);
+	const FlatAST again(rebuilt);
+	if (!(tally == expected) || !(FlatTally(again) == expected) || again.GetSize() != flat.GetSize())
+	{
+		throw std::runtime_error("flat syntax tree differs from the tree it was built from");
+	}
+}
@@ -0,0 +1,73 @@
+#include "Bench.h"
+#include "SourceGenerator.h"
+#include "../Parser.h"
+#include "../SourceBuffer.h"
+#include "../TokenStream.h"
+#include "../AST/ASTContext.h"
+#include "../AST/ConstantFolder.h"
+#include "../codegen/CodegenContext.h"
+#include "../codegen/CodegenVisitor.h"
+#include <cstdio>
+#include <stdexcept>
+
+namespace
+{
+// Codegen builds LLVM instructions for every node, so the input is small.
+const size_t gcMaxFoldBytes = 256 << 10;
+
+// Lowers the block into a main function of a module of its own, folded first
+// if fold is set, and returns the number of instructions emitted.
+size_t GenerateBlock(const IStatementAST& block, bool fold)
+{
+	CodegenContext context;
+	Codegen codegen(context, fold);
+	codegen.Generate(block);
+
+	size_t instructions = 0;
+	for (const llvm::Function& function : context.GetUtils().GetModule())
+	{
+		for (const llvm::BasicBlock& basicBlock : function)
+		{
+			instructions += basicBlock.size();
+		}
+	}
+	return instructions;
+}
+}
+
+void RunFoldBench(size_t bytes)
+{
+	const std::string text = SourceGenerator::GenerateFoldable(bytes < gcMaxFoldBytes ? bytes : gcMaxFoldBytes);
+	TokenStream stream(new SourceBuffer(text.data(), text.size()));
+
+	ASTContext context;
+	Parser parser(&stream, context);
+	const IStatementAST* block = parser.stmt();
+	if (!block)
+	{
+		throw std::runtime_error("folding benchmark parsed nothing");
+	}
+
+	const size_t nodes = context.GetNodeCount();
+	ConstantFolder folder(context);
+	const IStatementAST* folded = folder.Fold(*block);
+	const double fold = Bench::Measure([&] {
+		ASTContext scratch;
+		ConstantFolder(scratch).Fold(*block);
+	});
+	Bench::Report("ast/fold", fold, double(nodes), "nodes");
+	printf("%-32s %10zu operators folded, %zu branches pruned\n", "",
+		folder.GetStats().folded, folder.GetStats().pruned);
+
+	const size_t emitted = GenerateBlock(*block, false);
+	const size_t emittedFolded = GenerateBlock(*folded, false);
+	if (GenerateBlock(*block, true) != emittedFolded)
+	{
+		throw std::runtime_error("codegen folds differently from the folder");
+	}
+	const double plain = Bench::Measure([&] { GenerateBlock(*block, false); });
+	Bench::Report("codegen/foldable", plain, double(emitted), "instructions");
+	const double both = Bench::Measure([&] { GenerateBlock(*block, true); });
+	Bench::Report("codegen/foldable/folded", both, double(emittedFolded), "instructions");
+	printf("%-32s %10.1fx faster, %zu instructions instead of %zu\n", "", plain / both, emittedFolded, emitted);
+}
@@ -0,0 +1,116 @@
+#include "Bench.h"
+#include "SourceGenerator.h"
+#include "../IncrementalLexer.h"
+#include "../IncrementalParser.h"
+#include "../Parser.h"
+#include "../SourceBuffer.h"
+#include "../TokenStream.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace
+{
+const size_t gcFileSizes[] = { 64 << 10, 1 << 20, 16 << 20 };
+const size_t gcEditsPerRun = 256;
+const size_t gcParserFileBytes = 1 << 20;	// about 50k lines
+
+// Types a character and takes it out again, like a user fixing a typo, so
+// every run leaves the buffer as it found it. Local edits wander a little
+// from the last one, as an editor's cursor does; scattered ones jump
+// anywhere, and pay for moving the gaps across the file.
+template <typename Editor>
+void TypeAndUndo(Editor& editor, size_t size, size_t& seed, size_t& at, bool local)
+{
+	for (size_t i = 0; i < gcEditsPerRun; ++i)
+	{
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		const size_t step = size_t(seed >> 33);
+		at = (local ? at + step % 128 - 64 : step) % size;
+		editor.edit(at, 0, "x", 1);
+		editor.edit(at, 1, "", 0);
+	}
+}
+
+void CheckSameTokens(const IncrementalLexer& lexer, const std::string& text)
+{
+	const TokenStream expected(new SourceBuffer(text.data(), text.size()));
+
+	bool same = lexer.text() == text && expected.size() == lexer.size();
+	for (size_t i = 0; same && i < expected.size(); ++i)
+	{
+		same = expected.tag(i) == lexer.tag(i)
+			&& expected.offset(i) == lexer.offset(i)
+			&& expected.length(i) == lexer.length(i)
+			&& expected.line(i) == lexer.line(i);
+	}
+	if (!same)
+	{
+		throw std::runtime_error("incrementally lexed tokens differ from a fresh lex");
+	}
+}
+
+size_t ParseProgram(const std::string& text, std::vector<std::string>& diagnostics)
+{
+	TokenStream stream(new SourceBuffer(text.data(), text.size()));
+	ASTContext context;
+	Parser parser(&stream, context);
+	parser.maxErrors = 0;
+	const size_t functions = parser.program()->GetFunctionsCount();
+	diagnostics.swap(parser.diagnostics);
+	return functions;
+}
+}
+
+void RunIncrementalBench(size_t bytes)
+{
+	for (size_t size : gcFileSizes)
+	{
+		if (size > bytes)
+		{
+			break;
+		}
+		const std::string text = SourceGenerator::Generate(size);
+		const std::string suffix = std::to_string(size >> 10) + "k";
+
+		IncrementalLexer lexer(text.data(), text.size());
+		size_t seed = 1;
+		size_t at = text.size() / 2;
+		const double edits = Bench::Measure([&] { TypeAndUndo(lexer, text.size(), seed, at, true); });
+		Bench::Report("lexer/incremental/" + suffix, edits, 2 * gcEditsPerRun, "edits");
+		const double scattered = Bench::Measure([&] { TypeAndUndo(lexer, text.size(), seed, at, false); });
+		Bench::Report("lexer/incremental/" + suffix + "/scattered", scattered, 2 * gcEditsPerRun, "edits");
+		CheckSameTokens(lexer, text);
+
+		const double full = Bench::Measure([&] {
+			TokenStream stream(new SourceBuffer(text.data(), text.size()));
+		});
+		Bench::Report("lexer/relex/" + suffix, full, 1, "edits");
+		printf("%-32s %10.0fx faster per edit\n", "", full * 2 * gcEditsPerRun / edits);
+	}
+}
+
+// An edit reparses the innermost block it touches, whatever the size of the file;
+// the alternative is lexing and parsing all of it again.
+void RunIncrementalParserBench(size_t bytes)
+{
+	const std::string text = SourceGenerator::GenerateFunctions(bytes < gcParserFileBytes ? bytes : gcParserFileBytes);
+	const size_t lines = size_t(std::count(text.begin(), text.end(), '\n'));
+	const std::string suffix = std::to_string(lines / 1000) + "klines";
+
+	IncrementalParser parser(text.data(), text.size());
+	size_t seed = 1;
+	size_t at = text.size() / 2;
+	const double edits = Bench::Measure([&] { TypeAndUndo(parser, text.size(), seed, at, true); });
+	Bench::Report("parser/incremental/" + suffix, edits, 2 * gcEditsPerRun, "edits");
+
+	std::vector<std::string> diagnostics;
+	const double full = Bench::Measure([&] { ParseProgram(text, diagnostics); });
+	Bench::Report("parser/reparse/" + suffix, full, 1, "edits");
+	printf("%-32s %10.0fx faster per edit\n", "", full * 2 * gcEditsPerRun / edits);
+
+	if (parser.program().GetFunctionsCount() != ParseProgram(text, diagnostics) || parser.diagnostics() != diagnostics)
+	{
+		throw std::runtime_error("incrementally parsed program differs from a fresh parse");
+	}
+}
@@ -0,0 +1,177 @@
+#include "Bench.h"
+#include "SourceGenerator.h"
+#include "../Lexer.h"
+#include "../ScanKernels.h"
+#include "../SourceBuffer.h"
+#include "../TokenStream.h"
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+const unsigned gcThreadCounts[] = { 1, 2, 4, 8 };
+
+size_t LexAll(const std::string& text)
+{
+	Lexer lexer(new SourceBuffer(text.data(), text.size()));
+
+	size_t count = 0;
+	while (lexer.gettok()->tag != EOF)
+	{
+		++count;
+	}
+	return count;
+}
+
+// Lexes text fed through a pipe, the way a build system hands generated code
+// to the compiler, so the lexer sees it one window at a time.
+size_t LexPiped(const std::string& text)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+	{
+		throw std::runtime_error("cannot create a pipe");
+	}
+
+	std::thread writer([&] {
+		for (size_t done = 0; done < text.size();)
+		{
+			const ssize_t n = write(fds[1], text.data() + done, text.size() - done);
+			if (n <= 0)
+			{
+				break;
+			}
+			done += size_t(n);
+		}
+		close(fds[1]);
+	});
+
+	size_t count = 0;
+	{
+		Lexer lexer(SourceBuffer::stream(("/dev/fd/" + std::to_string(fds[0])).c_str()));
+		while (lexer.gettok()->tag != EOF)
+		{
+			++count;
+		}
+	}
+	writer.join();
+	close(fds[0]);
+	return count;
+}
+
+// The lexer's run-finding work with token construction stripped away, so the
+// kernels can be compared without allocator noise.
+size_t ScanRuns(const std::string& text, int& lines)
+{
+	const SourceBuffer source(text.data(), text.size());
+	ScanKernels scan;
+	const char* p = source.begin();
+
+	size_t runs = 0;
+	while (p != source.end())
+	{
+		const char* next = scan.skipBlanks(p, lines);
+		next = scan.skipIdent(next);
+		p = next == p ? p + 1 : next;
+		++runs;
+	}
+	return runs;
+}
+
+// Chunked lexing has to give exactly the single-threaded stream.
+void CheckSameStream(const TokenStream& expected, const TokenStream& actual, unsigned threads)
+{
+	bool same = expected.size() == actual.size();
+	for (size_t i = 0; same && i < expected.size(); ++i)
+	{
+		same = expected.tag(i) == actual.tag(i)
+			&& expected.offset(i) == actual.offset(i)
+			&& expected.length(i) == actual.length(i)
+			&& expected.line(i) == actual.line(i)
+			&& expected.symbol(i) == actual.symbol(i);
+	}
+	if (!same)
+	{
+		throw std::runtime_error("token stream lexed on " + std::to_string(threads) + " threads differs");
+	}
+}
+}
+
+void RunLexerBench(size_t bytes)
+{
+	const std::string text = SourceGenerator::Generate(bytes);
+	const ScanKernels::Level best = ScanKernels::detect();
+
+	const double megabytes = double(text.size()) / (1 << 20);
+
+	size_t tokens = 0;
+	double scanScalar = 0;
+	double lexScalar = 0;
+
+	for (int level = ScanKernels::Scalar; level <= best; ++level)
+	{
+		ScanKernels::setLevel(ScanKernels::Level(level));
+		const std::string suffix = ScanKernels::toString(ScanKernels::Level(level));
+
+		int lines = 0;
+		const double scan = Bench::Measure([&] { ScanRuns(text, lines); });
+		Bench::Report("lexer/scan/" + suffix, scan, megabytes, "MB");
+
+		const double lex = Bench::Measure([&] { tokens = LexAll(text); });
+		Bench::Report("lexer/gettok/" + suffix, lex, megabytes, "MB");
+
+		if (level == ScanKernels::Scalar)
+		{
+			scanScalar = scan;
+			lexScalar = lex;
+		}
+		else
+		{
+			printf("%-32s %10.2fx scan, %.2fx gettok vs scalar\n", "", scanScalar / scan, lexScalar / lex);
+		}
+	}
+	ScanKernels::setLevel(best);
+
+	// Lexing the whole file into the parser's token stream up front, split
+	// across more and more threads.
+	const TokenStream reference(new SourceBuffer(text.data(), text.size()));
+	double prelexSerial = 0;
+	for (unsigned threads : gcThreadCounts)
+	{
+		CheckSameStream(reference, TokenStream(new SourceBuffer(text.data(), text.size()), threads), threads);
+
+		const double prelex = Bench::Measure([&] {
+			TokenStream stream(new SourceBuffer(text.data(), text.size()), threads);
+		});
+		Bench::Report("lexer/prelex/" + std::to_string(threads) + "t", prelex, megabytes, "MB");
+
+		if (threads == 1)
+		{
+			prelexSerial = prelex;
+		}
+		else
+		{
+			printf("%-32s %10.2fx vs 1 thread\n", "", prelexSerial / prelex);
+		}
+	}
+	printf("%-32s %10u hardware threads\n", "", std::thread::hardware_concurrency());
+
+	printf("%-32s %10zu tokens, %zu bytes\n", "", tokens, text.size());
+
+	size_t pipedTokens = 0;
+	const double piped = Bench::Measure([&] { pipedTokens = LexPiped(text); });
+	Bench::Report("lexer/gettok/piped", piped, megabytes, "MB");
+	if (pipedTokens != tokens)
+	{
+		throw std::runtime_error("lexing through a pipe gives a different token count");
+	}
+
+	// Literal conversion dominates on data tables.
+	const std::string numbers = SourceGenerator::GenerateNumbers(bytes / 4);
+	size_t numberTokens = 0;
+	const double lexNumbers = Bench::Measure([&] { numberTokens = LexAll(numbers); });
+	Bench::Report("lexer/gettok/numbers", lexNumbers, double(numbers.size()) / (1 << 20), "MB");
+	printf("%-32s %10zu tokens, %zu bytes\n", "", numberTokens, numbers.size());
+}
@@ -0,0 +1,121 @@
+#include "Bench.h"
+#include "SourceGenerator.h"
+#include "../Parser.h"
+#include "../SourceBuffer.h"
+#include "../TokenStream.h"
+#include "../AST/ASTContext.h"
+#include "../AST/ExpressionDAG.h"
+#include <cstdio>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+// Every parse of a stream materialises its literal tokens afresh, so the
+// input stays small enough for repeated runs.
+const size_t gcMaxExpressionBytes = 1 << 20;
+const size_t gcMaxFunctionBytes = 16 << 20;
+const unsigned gcThreadCounts[] = { 1, 2, 4, 8 };
+const size_t gcMaxScopeBytes = 4 << 20;
+const size_t gcScopeDepths[] = { 16, 256, 4096 };
+
+// Parses a pre-lexed stream, so only the parser is timed. Returns the
+// number of nodes built.
+size_t ParseAll(TokenStream& stream)
+{
+	ASTContext context;
+	Parser parser(&stream, context);
+	parser.stmt();
+	return context.GetNodeCount();
+}
+
+size_t ParseProgram(TokenStream& stream, unsigned threads)
+{
+	ASTContext context;
+	Parser parser(&stream, context);
+	parser.program(threads);
+	return context.GetNodeCount();
+}
+
+size_t ParseShared(TokenStream& stream, ExpressionDAG::Stats& stats, size_t& bytes)
+{
+	ASTContext context;
+	ExpressionDAG dag(context);
+	Parser parser(&stream, context);
+	parser.dag = &dag;
+	parser.program();
+	stats = dag.GetStats();
+	bytes = context.GetBytesUsed();
+	return context.GetNodeCount();
+}
+}
+
+void RunParserBench(size_t bytes, size_t width)
+{
+	const std::string text = SourceGenerator::GenerateExpressions(bytes < gcMaxExpressionBytes ? bytes : gcMaxExpressionBytes, width);
+	TokenStream stream(new SourceBuffer(text.data(), text.size()));
+
+	const size_t nodes = ParseAll(stream);
+	if (nodes == 0)
+	{
+		throw std::runtime_error("expression benchmark parsed nothing");
+	}
+
+	const double seconds = Bench::Measure([&] { ParseAll(stream); });
+	Bench::Report("parser/expressions", seconds, double(nodes), "nodes");
+}
+
+void RunFunctionParserBench(size_t bytes)
+{
+	const std::string text = SourceGenerator::GenerateFunctions(bytes < gcMaxFunctionBytes ? bytes : gcMaxFunctionBytes);
+	TokenStream stream(new SourceBuffer(text.data(), text.size()));
+
+	const size_t nodes = ParseProgram(stream, 1);
+	for (unsigned threads : gcThreadCounts)
+	{
+		if (ParseProgram(stream, threads) != nodes)
+		{
+			throw std::runtime_error("parallel parse built a different tree");
+		}
+		const double seconds = Bench::Measure([&] { ParseProgram(stream, threads); });
+		Bench::Report("parser/functions/" + std::to_string(threads) + "t", seconds, double(nodes), "nodes");
+	}
+}
+
+// Name lookups cost the same however many scopes are open, so the rate
+// should not drop with depth. A depth of 0 runs the default set.
+void RunScopeBench(size_t bytes, size_t onlyDepth)
+{
+	std::vector<size_t> depths(std::begin(gcScopeDepths), std::end(gcScopeDepths));
+	if (onlyDepth != 0)
+	{
+		depths.assign(1, onlyDepth);
+	}
+
+	for (size_t depth : depths)
+	{
+		const std::string text = SourceGenerator::GenerateNestedScopes(bytes < gcMaxScopeBytes ? bytes : gcMaxScopeBytes, depth);
+		TokenStream stream(new SourceBuffer(text.data(), text.size()));
+
+		const size_t nodes = ParseAll(stream);
+		const double seconds = Bench::Measure([&] { ParseAll(stream); });
+		Bench::Report("parser/scopes/" + std::to_string(depth), seconds, double(nodes), "nodes");
+	}
+}
+
+// Generated functions repeat their operands and conditions; building each
+// once trades a hash lookup per node for fewer nodes.
+void RunSharingBench(size_t bytes)
+{
+	const std::string text = SourceGenerator::GenerateFunctions(bytes < gcMaxFunctionBytes ? bytes : gcMaxFunctionBytes);
+	TokenStream stream(new SourceBuffer(text.data(), text.size()));
+
+	ExpressionDAG::Stats stats;
+	size_t used = 0;
+	const size_t nodes = ParseShared(stream, stats, used);
+	const double seconds = Bench::Measure([&] { ParseShared(stream, stats, used); });
+	Bench::Report("parser/functions/shared", seconds, double(stats.requested), "nodes");
+	printf("%-32s %10.1f%% of expression nodes shared, %zu nodes and %zu bytes left\n", "",
+		100.0 * double(stats.reused) / double(stats.requested), nodes, used);
+}
@@ -0,0 +1,202 @@
+#include "SourceGenerator.h"
+#include <random>
+
+namespace
+{
+const size_t gcVariables = 256;
+
+const char* const gcLogical[] = { "||", "&&" };
+const char* const gcComparisons[] = { "==", "!=", "<", "<=", ">", ">=" };
+const char* const gcArithmetic[] = { "+", "-", "*", "/" };
+
+std::string Var(size_t index)
+{
+	return "v" + std::to_string(index % gcVariables);
+}
+
+std::string Condition(std::mt19937_64& random, int depth, size_t width);
+
+std::string Operand(std::mt19937_64& random, int depth, size_t width)
+{
+	switch (random() % 8)
+	{
+	case 0:
+		return depth > 0 ? "(" + Condition(random, depth - 1, width) + ")" : "7";
+	case 1:
+		return "!" + Operand(random, depth, width);
+	case 2:
+		return "-" + std::to_string(random() % 1000);
+	case 3:
+		return std::to_string(random() % 100) + "." + std::to_string(random() % 100);
+	case 4:
+		return random() % 2 ? "true" : "false";
+	default:
+		return std::to_string(random() % 100000);
+	}
+}
+
+// At most one comparison between sums, as in C code.
+std::string Comparison(std::mt19937_64& random, int depth, size_t width)
+{
+	std::string out = Operand(random, depth, width);
+	for (size_t i = 0, n = random() % width; i < n; ++i)
+	{
+		out += std::string(" ") + gcArithmetic[random() % 4] + " " + Operand(random, depth, width);
+	}
+	if (random() % 3)
+	{
+		out += std::string(" ") + gcComparisons[random() % 6] + " " + Operand(random, depth, width);
+	}
+	return out;
+}
+
+std::string Condition(std::mt19937_64& random, int depth, size_t width)
+{
+	std::string out = Comparison(random, depth, width);
+	for (size_t i = 0, n = random() % width; i < n; ++i)
+	{
+		out += std::string(" ") + gcLogical[random() % 2] + " " + Comparison(random, depth, width);
+	}
+	return out;
+}
+}
+
+std::string SourceGenerator::Generate(size_t bytes)
+{
+	std::string out = "{\n";
+	for (size_t i = 0; i < gcVariables; ++i)
+	{
+		out += "    int " + Var(i) + ";\n";
+	}
+
+	for (size_t i = 0; out.size() < bytes; ++i)
+	{
+		out += "    " + Var(i) + " = " + Var(i * 7) + " + " + std::to_string(i) + " * (" + Var(i * 3) + " - "
+			+ std::to_string(i % 97) + "." + std::to_string(i % 1000) + ");\n";
+
+		if (i % 8 == 0)
+		{
+			out += "    if (" + Var(i + 1) + " <= " + Var(i + 2) + " && " + Var(i + 3) + " != 4)\n"
+				"    {\n"
+				"        while (" + Var(i + 5) + " >= 6 || !" + Var(i + 7) + ")\n"
+				"            " + Var(i + 8) + " = " + Var(i + 9) + " / 10;\n"
+				"    }\n"
+				"    else\n"
+				"        " + Var(i) + " = 2;\n";
+		}
+	}
+
+	out += "}\n";
+	return out;
+}
+
+std::string SourceGenerator::GenerateNumbers(size_t bytes)
+{
+	std::mt19937_64 random(1);
+	std::string out = "{\n    float t;\n";
+	while (out.size() < bytes)
+	{
+		out += "    t = " + std::to_string(random() % 10000000000ull) + " + " + std::to_string(random() % 1000) + "."
+			+ std::to_string(random() % 100000000000000ull) + " * " + std::to_string(random() % 100000) + "."
+			+ std::to_string(random() % 1000000) + ";\n";
+	}
+	out += "}\n";
+	return out;
+}
+
+std::string SourceGenerator::GenerateExpressions(size_t bytes, size_t width)
+{
+	std::mt19937_64 random(1);
+	std::string out = "{\n";
+	while (out.size() < bytes)
+	{
+		out += "    while (" + Condition(random, 3, width);
+		out += ") {}\n";
+	}
+	out += "}\n";
+	return out;
+}
+
+std::string SourceGenerator::GenerateArithmetic(size_t bytes, size_t width)
+{
+	std::mt19937_64 random(1);
+	std::string out = "{\n    int v0;\n    int v1;\n    int v2;\n    int v3;\n";
+	for (size_t i = 0; out.size() < bytes; ++i)
+	{
+		// Every other operand is a name, so the builder cannot fold the
+		// expression into one constant. Divisors are never zero.
+		out += "    " + Var(i % 4) + " = " + Var(i * 3 % 4);
+		for (size_t j = 1; j <= width; ++j)
+		{
+			const char* op = gcArithmetic[random() % 4];
+			out += std::string(" ") + op + " ";
+			out += j % 2 ? std::to_string(random() % 99 + 1) : Var(random() % 4);
+		}
+		out += ";\n";
+	}
+	out += "}\n";
+	return out;
+}
+
+std::string SourceGenerator::GenerateFoldable(size_t bytes)
+{
+	std::mt19937_64 random(1);
+	std::string out = "{\n    int v0;\n    int v1;\n    int v2;\n    int v3;\n";
+	for (size_t i = 0; out.size() < bytes; ++i)
+	{
+		const std::string size = std::to_string(random() % 64 + 1);
+		const std::string scale = std::to_string(random() % 16 + 1);
+		out += "    " + Var(i % 4) + " = " + Var(i * 3 % 4) + " + (" + size + " * " + scale + " - "
+			+ std::to_string(random() % 100) + ") / " + std::to_string(random() % 99 + 1) + ";\n";
+		out += "    if (" + size + " > " + scale + " && !" + (random() % 2 ? "true" : "false") + ")\n"
+			"        " + Var((i + 1) % 4) + " = " + Var((i + 2) % 4) + " * " + scale + ";\n"
+			"    else\n"
+			"        " + Var((i + 2) % 4) + " = " + Var((i + 3) % 4) + " - " + size + ";\n";
+		if (i % 4 == 0)
+		{
+			out += "    while (" + scale + " < 0)\n"
+				"        " + Var(i % 4) + " = " + Var(i % 4) + " + 1;\n";
+		}
+	}
+	out += "}\n";
+	return out;
+}
+
+std::string SourceGenerator::GenerateFunctions(size_t bytes)
+{
+	std::string out;
+	for (size_t i = 0; out.size() < bytes; ++i)
+	{
+		const std::string name = "f" + std::to_string(i);
+		const std::string callee = "f" + std::to_string(i / 2);
+		out += "int " + name + "(int a, float b, bool c)\n"
+			"{\n"
+			"    int d;\n"
+			"    while (a < " + std::to_string(i % 100) + " && c)\n"
+			"    {\n"
+			"        print(a * 2 + b / 3.5, " + callee + "(a - 1, b, !c));\n"
+			"        if (a % 7 == 0)\n"
+			"            return " + callee + "(a / 2, b * b, c) + 1;\n"
+			"    }\n"
+			"    return a - (b >= 1.5) * " + std::to_string(i) + ";\n"
+			"}\n\n";
+	}
+	return out;
+}
+
+std::string SourceGenerator::GenerateNestedScopes(size_t bytes, size_t depth)
+{
+	std::string out = "{\n";
+	while (out.size() < bytes)
+	{
+		for (size_t level = 0; level < depth; ++level)
+		{
+			const std::string a = "a" + std::to_string(level);
+			const std::string b = "b" + std::to_string(level);
+			out += "{ int " + a + "; float " + b + "; " + a + " = a0 + " + a + "; " + b + " = b0 * " + b + ";\n";
+		}
+		out += std::string(depth, '}') + "\n";
+	}
+	out += "}\n";
+	return out;
+}
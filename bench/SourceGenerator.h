@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+
+// Builds syntactically valid programs of roughly the requested size, shaped
+// like the machine-generated sources the compiler is tuned for.
+class SourceGenerator
+{
+public:
+	static std::string Generate(size_t bytes);
+
+	// A data table: mostly long integer and real literals.
+	static std::string GenerateNumbers(size_t bytes);
+
+	// Long conditions over every operator and nesting depth; constants only,
+	// so the result parses without any declarations. Each level chains up to
+	// width - 1 operators.
+	static std::string GenerateExpressions(size_t bytes, size_t width = 4);
+
+	// Assignments of long integer expressions, width operators each, over a
+	// few declared names; unlike GenerateExpressions, all of it type-checks,
+	// so codegen accepts it.
+	static std::string GenerateArithmetic(size_t bytes, size_t width = 4);
+
+	// Settings spelled out as constants, as in generated or macro-expanded
+	// code: constant subexpressions, and branches and loops on constant
+	// conditions.
+	static std::string GenerateFoldable(size_t bytes);
+
+	// Many small functions that call each other.
+	static std::string GenerateFunctions(size_t bytes);
+
+	// Blocks nested depth deep, each declaring names and using the
+	// outermost ones.
+	static std::string GenerateNestedScopes(size_t bytes, size_t depth);
+};
@@ -0,0 +1,91 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+
+void RunLexerBench(size_t bytes);
+void RunIncrementalBench(size_t bytes);
+void RunIncrementalParserBench(size_t bytes);
+void RunParserBench(size_t bytes, size_t width);
+void RunFunctionParserBench(size_t bytes);
+void RunScopeBench(size_t bytes, size_t depth);
+void RunSharingBench(size_t bytes);
+void RunFlatASTBench(size_t bytes);
+void RunCacheBench(size_t bytes);
+void RunDispatchBench(size_t bytes, size_t width);
+void RunFoldBench(size_t bytes);
+void RunExpressionTypeBench();
+void RunCodegenBench(size_t bytes);
+void RunCorpusBench(const std::vector<std::string>& files);
+
+int main(int argc, const char* argv[])
+{
+	size_t megabytes = 64;
+	size_t depth = 0;
+	size_t width = 4;
+	std::string json;
+	std::vector<std::string> corpus;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "-size") && i + 1 < argc)
+		{
+			megabytes = size_t(atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "-depth") && i + 1 < argc)
+		{
+			depth = size_t(atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "-width") && i + 1 < argc && atoi(argv[i + 1]) > 0)
+		{
+			width = size_t(atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "-json") && i + 1 < argc)
+		{
+			json = argv[++i];
+		}
+		else if (argv[i][0] != '-')
+		{
+			corpus.push_back(argv[i]);
+		}
+		else
+		{
+			fprintf(stderr, "Usage: compiler_bench [-size <megabytes>] [-depth <scopes>] [-width <operators>]\n"
+				"                      [-json <file>] [source files...]\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	try
+	{
+		RunLexerBench(megabytes << 20);
+		RunIncrementalBench(megabytes << 20);
+		RunParserBench(megabytes << 20, width);
+		RunFunctionParserBench(megabytes << 20);
+		RunScopeBench(megabytes << 20, depth);
+		RunSharingBench(megabytes << 20);
+		RunIncrementalParserBench(megabytes << 20);
+		RunFlatASTBench(megabytes << 20);
+		RunCacheBench(megabytes << 20);
+		RunDispatchBench(megabytes << 20, width);
+		RunFoldBench(megabytes << 20);
+		RunExpressionTypeBench();
+		RunCodegenBench(megabytes << 20);
+		RunCorpusBench(corpus);
+
+		if (!json.empty())
+		{
+			Bench::WriteJson(json);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
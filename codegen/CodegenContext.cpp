@@ -42,6 +42,7 @@ CodegenContext::CodegenContext()
 	: m_utils()
 	, m_scopes()
 	, m_printf(CreatePrintfBuiltinFunction(m_utils))
+	, m_constantFolder(m_foldedNodes)
 {
 }
 
@@ -55,17 +56,17 @@ void CodegenContext::PopScope()
 	m_scopes.PopScope();
 }
 
-void CodegenContext::Define(const std::string& name, llvm::AllocaInst* value)
+void CodegenContext::Define(SymbolId name, llvm::AllocaInst* value)
 {
 	m_scopes.Define(name, value);
 }
 
-void CodegenContext::Assign(const std::string& name, llvm::AllocaInst* value)
+void CodegenContext::Assign(SymbolId name, llvm::AllocaInst* value)
 {
 	m_scopes.Assign(name, value);
 }
 
-llvm::AllocaInst* CodegenContext::GetVariable(const std::string& name)
+llvm::AllocaInst* CodegenContext::GetVariable(SymbolId name)
 {
 	auto variable = m_scopes.GetValue(name);
 	return variable.value_or(nullptr);
@@ -87,6 +88,11 @@ void CodegenContext::AddFunction(const std::string& name, llvm::Function* func)
 	m_functions[name] = func;
 }
 
+void CodegenContext::RemoveFunction(const std::string& name)
+{
+	m_functions.erase(name);
+}
+
 llvm::Function* CodegenContext::GetFunction(const std::string& name)
 {
 	auto found = m_functions.find(name);
@@ -97,6 +103,16 @@ llvm::Function* CodegenContext::GetFunction(const std::string& name)
 	return nullptr;
 }
 
+TypeChecker& CodegenContext::GetTypeChecker()
+{
+	return m_typeChecker;
+}
+
+ConstantFolder& CodegenContext::GetConstantFolder()
+{
+	return m_constantFolder;
+}
+
 void CodegenContext::Dump(std::ostream& out)
 {
 	llvm::raw_os_ostream os(out);
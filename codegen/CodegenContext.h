@@ -1,5 +1,8 @@
 #pragma once
 #include "ScopeChain.h"
+#include "TypeChecker.h"
+#include "../AST/ASTContext.h"
+#include "../AST/ConstantFolder.h"
 #include <ostream>
 
 #pragma warning(push, 0)
@@ -44,17 +47,26 @@ public:
 	void PushScope();
 	void PopScope();
 
-	void Define(const std::string& name, llvm::AllocaInst* value);
-	void Assign(const std::string& name, llvm::AllocaInst* value);
+	void Define(SymbolId name, llvm::AllocaInst* value);
+	void Assign(SymbolId name, llvm::AllocaInst* value);
 
-	llvm::AllocaInst* GetVariable(const std::string& name);
+	llvm::AllocaInst* GetVariable(SymbolId name);
 
 	llvm::Function* GetPrintf();
 	CodegenUtils& GetUtils();
 
 	void AddFunction(const std::string& name, llvm::Function* func);
+	// For a function whose codegen failed after it was added.
+	void RemoveFunction(const std::string& name);
 	llvm::Function* GetFunction(const std::string& name);
 
+	// Knows the functions generated so far, as codegen does.
+	TypeChecker& GetTypeChecker();
+
+	// Folds each tree once it is type checked; the nodes it builds live as
+	// long as the context.
+	ConstantFolder& GetConstantFolder();
+
 	void Dump(std::ostream& out);
 
 private:
@@ -63,4 +75,7 @@ private:
 
 	llvm::Function* m_printf; // builtin function
 	std::unordered_map<std::string, llvm::Function*> m_functions; // user defined
+	TypeChecker m_typeChecker;
+	ASTContext m_foldedNodes;
+	ConstantFolder m_constantFolder;
 };
@@ -1,4 +1,5 @@
 #include "CodegenVisitor.h"
+#include "../AST/StackGuard.h"
 #include <boost/format.hpp>
 
 namespace
@@ -58,11 +59,10 @@ llvm::Type* ToLLVMType(ExpressionType type, llvm::LLVMContext& context)
 
 llvm::Value* ConvertToIntegerValue(
 	llvm::Value* value,
+	ExpressionType type,
 	llvm::LLVMContext& llvmContext,
 	llvm::IRBuilder<>& builder)
 {
-	const ExpressionType type = ToExpressionType(value->getType());
-
 	switch (type)
 	{
 	case ExpressionType::Int:
@@ -81,11 +81,10 @@ llvm::Value* ConvertToIntegerValue(
 
 llvm::Value* ConvertToFloatValue(
 	llvm::Value* value,
+	ExpressionType type,
 	llvm::LLVMContext& llvmContext,
 	llvm::IRBuilder<>& builder)
 {
-	const ExpressionType type = ToExpressionType(value->getType());
-
 	switch (type)
 	{
 	case ExpressionType::Int:
@@ -103,11 +102,10 @@ llvm::Value* ConvertToFloatValue(
 
 llvm::Value* ConvertToBooleanValue(
 	llvm::Value* value,
+	ExpressionType expressionType,
 	llvm::LLVMContext& llvmContext,
 	llvm::IRBuilder<>& builder)
 {
-	const ExpressionType expressionType = ToExpressionType(value->getType());
-
 	switch (expressionType)
 	{
 	case ExpressionType::Int:
@@ -128,6 +126,7 @@ llvm::Value* ConvertToBooleanValue(
 
 llvm::Value* CastValue(
 	llvm::Value* value,
+	ExpressionType from,
 	ExpressionType type,
 	llvm::LLVMContext& llvmContext,
 	llvm::IRBuilder<> & builder)
@@ -135,11 +134,11 @@ llvm::Value* CastValue(
 	switch (type)
 	{
 	case ExpressionType::Int:
-		return ConvertToIntegerValue(value, llvmContext, builder);
+		return ConvertToIntegerValue(value, from, llvmContext, builder);
 	case ExpressionType::Float:
-		return ConvertToFloatValue(value, llvmContext, builder);
+		return ConvertToFloatValue(value, from, llvmContext, builder);
 	case ExpressionType::Bool:
-		return ConvertToBooleanValue(value, llvmContext, builder);
+		return ConvertToBooleanValue(value, from, llvmContext, builder);
 	}
 	return nullptr;
 }
@@ -158,16 +157,24 @@ llvm::Value* CreateIntegerBinaryExpression(
 	{
 	case BinaryExpressionAST::Or:
 		return builder.CreateOr(
-			ConvertToBooleanValue(left, llvmContext, builder), 
-			ConvertToBooleanValue(right, llvmContext, builder), "ortmp");
+			ConvertToBooleanValue(left, ExpressionType::Int, llvmContext, builder), 
+			ConvertToBooleanValue(right, ExpressionType::Int, llvmContext, builder), "ortmp");
 	case BinaryExpressionAST::And:
 		return builder.CreateAnd(
-			ConvertToBooleanValue(left, llvmContext, builder),
-			ConvertToBooleanValue(right, llvmContext, builder), "andtmp");
+			ConvertToBooleanValue(left, ExpressionType::Int, llvmContext, builder),
+			ConvertToBooleanValue(right, ExpressionType::Int, llvmContext, builder), "andtmp");
 	case BinaryExpressionAST::Equals:
 		return builder.CreateICmpEQ(left, right, "eqtmp");
+	case BinaryExpressionAST::NotEquals:
+		return builder.CreateICmpNE(left, right, "netmp");
 	case BinaryExpressionAST::Less:
 		return builder.CreateICmpSLT(left, right, "lttmp");
+	case BinaryExpressionAST::LessOrEquals:
+		return builder.CreateICmpSLE(left, right, "letmp");
+	case BinaryExpressionAST::Greater:
+		return builder.CreateICmpSGT(left, right, "gttmp");
+	case BinaryExpressionAST::GreaterOrEquals:
+		return builder.CreateICmpSGE(left, right, "getmp");
 	case BinaryExpressionAST::Plus:
 		return builder.CreateAdd(left, right, "addtmp");
 	case BinaryExpressionAST::Minus:
@@ -198,16 +205,24 @@ llvm::Value* CreateFloatBinaryExpression(
 	{
 	case BinaryExpressionAST::Or:
 		return builder.CreateOr(
-			ConvertToBooleanValue(left, llvmContext, builder),
-			ConvertToBooleanValue(right, llvmContext, builder), "ortmp");
+			ConvertToBooleanValue(left, ExpressionType::Float, llvmContext, builder),
+			ConvertToBooleanValue(right, ExpressionType::Float, llvmContext, builder), "ortmp");
 	case BinaryExpressionAST::And:
 		return builder.CreateAnd(
-			ConvertToBooleanValue(left, llvmContext, builder),
-			ConvertToBooleanValue(right, llvmContext, builder), "andtmp");
+			ConvertToBooleanValue(left, ExpressionType::Float, llvmContext, builder),
+			ConvertToBooleanValue(right, ExpressionType::Float, llvmContext, builder), "andtmp");
 	case BinaryExpressionAST::Equals:
 		return builder.CreateFCmpOEQ(left, right, "eqtmp");
+	case BinaryExpressionAST::NotEquals:
+		return builder.CreateFCmpUNE(left, right, "netmp");
 	case BinaryExpressionAST::Less:
 		return builder.CreateFCmpOLT(left, right, "lttmp");
+	case BinaryExpressionAST::LessOrEquals:
+		return builder.CreateFCmpOLE(left, right, "letmp");
+	case BinaryExpressionAST::Greater:
+		return builder.CreateFCmpOGT(left, right, "gttmp");
+	case BinaryExpressionAST::GreaterOrEquals:
+		return builder.CreateFCmpOGE(left, right, "getmp");
 	case BinaryExpressionAST::Plus:
 		return builder.CreateFAdd(left, right, "addtmp");
 	case BinaryExpressionAST::Minus:
@@ -243,8 +258,16 @@ llvm::Value* CreateBooleanBinaryExpression(
 		return builder.CreateAnd(left, right, "bandtmp");
 	case BinaryExpressionAST::Equals:
 		return builder.CreateICmpEQ(left, right, "beqtmp");
+	case BinaryExpressionAST::NotEquals:
+		return builder.CreateICmpNE(left, right, "bnetmp");
 	case BinaryExpressionAST::Less:
 		return builder.CreateICmpSLT(left, right, "blttmp");
+	case BinaryExpressionAST::LessOrEquals:
+		return builder.CreateICmpSLE(left, right, "bletmp");
+	case BinaryExpressionAST::Greater:
+		return builder.CreateICmpSGT(left, right, "bgttmp");
+	case BinaryExpressionAST::GreaterOrEquals:
+		return builder.CreateICmpSGE(left, right, "bgetmp");
 	case BinaryExpressionAST::Plus:
 	case BinaryExpressionAST::Minus:
 	case BinaryExpressionAST::Mul:
@@ -257,10 +280,9 @@ llvm::Value* CreateBooleanBinaryExpression(
 	throw std::logic_error("CreateBooleanBinaryExpression() - undefined binary expression ast operator");
 }
 
-llvm::Value* CreateNegativeValue(llvm::Value* value, llvm::IRBuilder<> & builder)
+llvm::Value* CreateNegativeValue(llvm::Value* value, ExpressionType type, llvm::IRBuilder<> & builder)
 {
-	const ExpressionType type = ToExpressionType(value->getType());
-	switch (ToExpressionType(value->getType()))
+	switch (type)
 	{
 	case ExpressionType::Int:
 		return builder.CreateNeg(value, "negtmp");
@@ -274,9 +296,9 @@ llvm::Value* CreateNegativeValue(llvm::Value* value, llvm::IRBuilder<> & builder
 	}
 }
 
-llvm::Value* CreateValueNegation(llvm::Value* value, llvm::LLVMContext& llvmContext, llvm::IRBuilder<> & builder)
+llvm::Value* CreateValueNegation(llvm::Value* value, ExpressionType type, llvm::LLVMContext& llvmContext, llvm::IRBuilder<> & builder)
 {
-	return builder.CreateNot(ConvertToBooleanValue(value, llvmContext, builder));
+	return builder.CreateNot(ConvertToBooleanValue(value, type, llvmContext, builder));
 }
 
 llvm::Value* CreateDefaultValue(ExpressionType type, llvm::LLVMContext& llvmContext, llvm::IRBuilder<> & builder)
@@ -309,6 +331,17 @@ llvm::Value* CreateDefaultValue(ExpressionType type, llvm::LLVMContext& llvmCont
 	}
 }
 
+// Filled in by TypeChecker, which sees every function before codegen does.
+const std::vector<ExpressionType>& GetParamTypes(CodegenContext& context, const std::string& name)
+{
+	const std::vector<ExpressionType>* params = context.GetTypeChecker().GetParams(name);
+	if (!params)
+	{
+		throw std::logic_error("function '" + name + "' hasn't been type checked");
+	}
+	return *params;
+}
+
 class ContextScopeHelper
 {
 public:
@@ -331,23 +364,22 @@ private:
 // Expression codegen visitor
 ExpressionCodegen::ExpressionCodegen(CodegenContext& context)
 	: m_context(context)
-	, m_stack()
 {
 }
 
 llvm::Value* ExpressionCodegen::Visit(const IExpressionAST& node)
 {
-	node.Accept(*this);
-	if (!m_stack.empty())
+	if (StackGuard::IsNearEnd())
 	{
-		llvm::Value* value = m_stack.back();
-		m_stack.pop_back();
+		llvm::Value* value = nullptr;
+		StackGuard::Grow([&] { value = Visit(node); });
 		return value;
 	}
-	throw std::logic_error("internal error while generating code for expression");
+
+	return Dispatch(node);
 }
 
-void ExpressionCodegen::Visit(const BinaryExpressionAST& node)
+llvm::Value* ExpressionCodegen::Visit(const BinaryExpressionAST& node)
 {
 	CodegenUtils& utils = m_context.GetUtils();
 
@@ -357,34 +389,37 @@ void ExpressionCodegen::Visit(const BinaryExpressionAST& node)
 	llvm::Value* left = Visit(node.GetLeft());
 	llvm::Value* right = Visit(node.GetRight());
 
-	if (ToExpressionType(left->getType()) != ToExpressionType(right->getType()))
+	const ExpressionType leftType = node.GetLeft().GetType();
+	const ExpressionType rightType = node.GetRight().GetType();
+	ExpressionType type = leftType;
+
+	if (leftType != rightType)
 	{
-		const auto castType = GetPreferredType(
-			ToExpressionType(left->getType()),
-			ToExpressionType(right->getType()));
+		const auto castType = GetPreferredType(leftType, rightType);
 
 		if (!castType)
 		{
 			const auto fmt = boost::format("can't codegen operator '%1%' on operands with types '%2%' and '%3%'")
 				% ToString(node.GetOperator())
-				% ToString(ToExpressionType(left->getType()))
-				% ToString(ToExpressionType(right->getType()));
+				% ToString(leftType)
+				% ToString(rightType);
 			throw std::runtime_error(fmt.str());
 		}
 
-		switch (*castType)
+		type = *castType;
+		switch (type)
 		{
 		case ExpressionType::Int:
-			left = ConvertToIntegerValue(left, llvmContext, builder);
-			right = ConvertToIntegerValue(right, llvmContext, builder);
+			left = ConvertToIntegerValue(left, leftType, llvmContext, builder);
+			right = ConvertToIntegerValue(right, rightType, llvmContext, builder);
 			break;
 		case ExpressionType::Float:
-			left = ConvertToFloatValue(left, llvmContext, builder);
-			right = ConvertToFloatValue(right, llvmContext, builder);
+			left = ConvertToFloatValue(left, leftType, llvmContext, builder);
+			right = ConvertToFloatValue(right, rightType, llvmContext, builder);
 			break;
 		case ExpressionType::Bool:
-			left = ConvertToBooleanValue(left, llvmContext, builder);
-			right = ConvertToBooleanValue(right, llvmContext, builder);
+			left = ConvertToBooleanValue(left, leftType, llvmContext, builder);
+			right = ConvertToBooleanValue(right, rightType, llvmContext, builder);
 			break;
 		case ExpressionType::String:
 			throw std::runtime_error("can't codegen binary operator for string");
@@ -397,53 +432,48 @@ void ExpressionCodegen::Visit(const BinaryExpressionAST& node)
 
 	assert(ToExpressionType(left->getType()) == ToExpressionType(right->getType()));
 
-	switch (ToExpressionType(left->getType()))
+	switch (type)
 	{
 	case ExpressionType::Int:
-		m_stack.push_back(CreateIntegerBinaryExpression(left, right, node.GetOperator(), llvmContext, builder));
-		break;
+		return CreateIntegerBinaryExpression(left, right, node.GetOperator(), llvmContext, builder);
 	case ExpressionType::Float:
-		m_stack.push_back(CreateFloatBinaryExpression(left, right, node.GetOperator(), llvmContext, builder));
-		break;
+		return CreateFloatBinaryExpression(left, right, node.GetOperator(), llvmContext, builder);
 	case ExpressionType::Bool:
-		m_stack.push_back(CreateBooleanBinaryExpression(left, right, node.GetOperator(), llvmContext, builder));
-		break;
+		return CreateBooleanBinaryExpression(left, right, node.GetOperator(), llvmContext, builder);
 	default:
 		throw std::runtime_error("can't codegen binary operator '" +
-			ToString(node.GetOperator()) + "' for " + ToString(ToExpressionType(left->getType())));
+			ToString(node.GetOperator()) + "' for " + ToString(type));
 	}
 }
 
-void ExpressionCodegen::Visit(const LiteralConstantAST& node)
+llvm::Value* ExpressionCodegen::Visit(const LiteralConstantAST& node)
 {
 	CodegenUtils& utils = m_context.GetUtils();
 
 	llvm::LLVMContext& llvmContext = utils.GetLLVMContext();
 	llvm::IRBuilder<>& builder = utils.GetBuilder();
-	const LiteralConstantAST::Value& constant = node.GetValue();
 
-	// TODO: use boost::static_visitor
-	if (constant.type() == typeid(int))
+	if (node.GetType() == ExpressionType::Int)
 	{
-		const int number = boost::get<int>(constant);
+		const int number = node.GetInt();
 		llvm::Value* value = llvm::ConstantInt::get(llvm::Type::getInt32Ty(llvmContext), number);
-		m_stack.push_back(value);
+		return value;
 	}
-	else if (constant.type() == typeid(double))
+	else if (node.GetType() == ExpressionType::Float)
 	{
-		const double number = boost::get<double>(constant);
+		const double number = node.GetFloat();
 		llvm::Value* value = llvm::ConstantFP::get(llvm::Type::getDoubleTy(llvmContext), number);
-		m_stack.push_back(value);
+		return value;
 	}
-	else if (constant.type() == typeid(bool))
+	else if (node.GetType() == ExpressionType::Bool)
 	{
-		const bool boolean = boost::get<bool>(constant);
+		const bool boolean = node.GetBool();
 		llvm::Value* value = llvm::ConstantInt::get(llvm::Type::getInt1Ty(llvmContext), uint64_t(boolean));
-		m_stack.push_back(value);
+		return value;
 	}
-	else if (constant.type() == typeid(std::string))
+	else if (node.GetType() == ExpressionType::String)
 	{
-		const std::string str = boost::get<std::string>(constant);
+		const std::string str = node.GetString();
 		llvm::Type* i8 = llvm::Type::getInt8Ty(llvmContext);
 		llvm::Constant* constantString = llvm::ConstantDataArray::getString(llvmContext, str, true);
 		llvm::ArrayType* arrayType = llvm::ArrayType::get(i8, str.length() + 1);
@@ -453,7 +483,7 @@ void ExpressionCodegen::Visit(const LiteralConstantAST& node)
 		llvm::StoreInst* storeInst = builder.CreateStore(constantString, allocaInst);
 		(void)storeInst;
 
-		m_stack.push_back(builder.CreateBitCast(allocaInst, llvm::Type::getInt8PtrTy(llvmContext), "str_to_i8_ptr"));
+		return builder.CreateBitCast(allocaInst, llvm::Type::getInt8PtrTy(llvmContext), "str_to_i8_ptr");
 	}
 	else
 	{
@@ -462,39 +492,36 @@ void ExpressionCodegen::Visit(const LiteralConstantAST& node)
 	}
 }
 
-void ExpressionCodegen::Visit(const UnaryAST& node)
+llvm::Value* ExpressionCodegen::Visit(const UnaryAST& node)
 {
 	CodegenUtils& utils = m_context.GetUtils();
 	llvm::IRBuilder<> & builder = utils.GetBuilder();
 	llvm::LLVMContext& llvmContext = utils.GetLLVMContext();
 
 	llvm::Value* value = Visit(node.GetExpr());
-	const ExpressionType type = ToExpressionType(value->getType());
+	const ExpressionType type = node.GetExpr().GetType();
 
 	switch (node.GetOperator())
 	{
 	case UnaryAST::Plus:
-		m_stack.push_back(value);
-		break;
+		return value;
 	case UnaryAST::Minus:
-		m_stack.push_back(CreateNegativeValue(value, builder));
-		break;
+		return CreateNegativeValue(value, type, builder);
 	case UnaryAST::Negation:
-		m_stack.push_back(CreateValueNegation(value, llvmContext, builder));
-		break;
+		return CreateValueNegation(value, type, llvmContext, builder);
 	default:
 		assert(false);
 		throw std::logic_error("Visit(UnaryAST): undefined unary operator");
 	}
 }
 
-void ExpressionCodegen::Visit(const IdentifierAST& node)
+llvm::Value* ExpressionCodegen::Visit(const IdentifierAST& node)
 {
 	CodegenUtils& utils = m_context.GetUtils();
 	llvm::IRBuilder<>& builder = utils.GetBuilder();
 
-	const std::string& name = node.GetName();
-	llvm::AllocaInst* variable = m_context.GetVariable(name);
+	const std::string name = node.GetName();
+	llvm::AllocaInst* variable = m_context.GetVariable(node.GetSymbol());
 
 	if (!variable)
 	{
@@ -502,10 +529,10 @@ void ExpressionCodegen::Visit(const IdentifierAST& node)
 	}
 
 	llvm::Value* value = builder.CreateLoad(variable, name + "Value");
-	m_stack.push_back(value);
+	return value;
 }
 
-void ExpressionCodegen::Visit(const FunctionCallExprAST& node)
+llvm::Value* ExpressionCodegen::Visit(const FunctionCallExprAST& node)
 {
 	CodegenUtils& utils = m_context.GetUtils();
 
@@ -524,34 +551,33 @@ void ExpressionCodegen::Visit(const FunctionCallExprAST& node)
 		throw std::runtime_error((fmt % node.GetName() % func->arg_size() % node.GetParamsCount()).str());
 	}
 
-	size_t index = 0;
+	const std::vector<ExpressionType>& paramTypes = GetParamTypes(m_context, node.GetName());
 	std::vector<llvm::Value*> params;
 
-	for (llvm::Argument& arg : func->args())
+	for (size_t index = 0; index < paramTypes.size(); ++index)
 	{
 		llvm::Value* value = Visit(node.GetParam(index));
+		const ExpressionType type = node.GetParam(index).GetType();
 
-		if (ToExpressionType(value->getType()) != ToExpressionType(arg.getType()))
+		if (type != paramTypes[index])
 		{
-			llvm::Value* casted = CastValue(value, ToExpressionType(arg.getType()), llvmContext, builder);
+			llvm::Value* casted = CastValue(value, type, paramTypes[index], llvmContext, builder);
 			if (!casted)
 			{
 				auto fmt = boost::format("function '%1%' expects '%2%' as parameter, '%3%' given (can't cast)")
 					% func->getName().str()
-					% ToString(ToExpressionType(arg.getType()))
-					% ToString(ToExpressionType(value->getType()));
+					% ToString(paramTypes[index])
+					% ToString(type);
 				throw std::runtime_error(fmt.str());
 			}
 
-			assert(ToExpressionType(casted->getType()) == ToExpressionType(arg.getType()));
+			assert(ToExpressionType(casted->getType()) == ToExpressionType(func->getFunctionType()->getParamType(unsigned(index))));
 			params.push_back(casted);
-			++index;
 			continue;
 		}
 
-		assert(ToExpressionType(value->getType()) == ToExpressionType(arg.getType()));
+		assert(ToExpressionType(value->getType()) == ToExpressionType(func->getFunctionType()->getParamType(unsigned(index))));
 		params.push_back(value);
-		++index;
 	}
 
 	if (func->getReturnType()->getTypeID() == llvm::Type::VoidTyID)
@@ -559,16 +585,16 @@ void ExpressionCodegen::Visit(const FunctionCallExprAST& node)
 		throw std::runtime_error("function '" + func->getName().str() + "' returns void - you can't store the result");
 	}
 	llvm::Value* value = builder.CreateCall(func, params, "calltmp");
-	m_stack.push_back(value);
+	return value;
 }
 
-void ExpressionCodegen::Visit(const ArrayElementAccessAST& node)
+llvm::Value* ExpressionCodegen::Visit(const ArrayElementAccessAST& node)
 {
 	CodegenUtils& utils = m_context.GetUtils();
 	llvm::IRBuilder<>& builder = utils.GetBuilder();
 	llvm::LLVMContext& llvmContext = utils.GetLLVMContext();
 
-	llvm::AllocaInst* variable = m_context.GetVariable(node.GetName());
+	llvm::AllocaInst* variable = m_context.GetVariable(node.GetSymbol());
 	if (!variable)
 	{
 		throw std::runtime_error("variable '" + node.GetName() + "' is not defined");
@@ -579,7 +605,7 @@ void ExpressionCodegen::Visit(const ArrayElementAccessAST& node)
 		throw std::runtime_error("variable '" + node.GetName() + "' can't be accessed via index");
 	}
 
-	llvm::Value* index = ConvertToIntegerValue(Visit(node.GetIndex()), llvmContext, builder);
+	llvm::Value* index = ConvertToIntegerValue(Visit(node.GetIndex()), node.GetIndex().GetType(), llvmContext, builder);
 	llvm::Value* elementPtr = builder.CreateGEP(builder.CreateLoad(variable, "load_ptr"), index, "get_element_ptr");
 	llvm::Value* value = builder.CreateLoad(llvm::Type::getInt8Ty(llvmContext), elementPtr, "load_arr_element");
 
@@ -587,19 +613,26 @@ void ExpressionCodegen::Visit(const ArrayElementAccessAST& node)
 	{
 		value = builder.CreateIntCast(value, llvm::Type::getInt32Ty(llvmContext), false, "icasttmp");
 	}
-	m_stack.push_back(value);
+	return value;
 }
 
 // Statement codegen visitor
-StatementCodegen::StatementCodegen(CodegenContext& context)
+StatementCodegen::StatementCodegen(CodegenContext& context, boost::optional<ExpressionType> returnType)
 	: m_context(context)
 	, m_expressionCodegen(context)
+	, m_returnType(returnType)
 {
 }
 
 void StatementCodegen::Visit(const IStatementAST& node)
 {
-	node.Accept(*this);
+	if (StackGuard::IsNearEnd())
+	{
+		StackGuard::Grow([&] { Visit(node); });
+		return;
+	}
+
+	Dispatch(node);
 }
 
 llvm::BasicBlock* StatementCodegen::GetLastBasicBlockBranch()
@@ -613,8 +646,9 @@ void StatementCodegen::Visit(const VariableDeclarationAST& node)
 	llvm::IRBuilder<>& builder = utils.GetBuilder();
 	llvm::LLVMContext& llvmContext = utils.GetLLVMContext();
 
-	const std::string& name = node.GetIdentifier().GetName();
-	if (m_context.GetVariable(name))
+	const SymbolId symbol = node.GetIdentifier().GetSymbol();
+	const std::string name = node.GetIdentifier().GetName();
+	if (m_context.GetVariable(symbol))
 	{
 		throw std::runtime_error("variable '" + name + "' is already defined");
 	}
@@ -625,19 +659,19 @@ void StatementCodegen::Visit(const VariableDeclarationAST& node)
 	llvm::Value* defaultValue = CreateDefaultValue(node.GetType(), llvmContext, builder);
 	builder.CreateStore(defaultValue, variable);
 
-	m_context.Define(name, variable);
+	m_context.Define(symbol, variable);
 
 	if (const IExpressionAST* expression = node.GetExpression())
 	{
 		llvm::Value* value = m_expressionCodegen.Visit(*expression);
 
-		if (ToExpressionType(value->getType()) != node.GetType())
+		if (expression->GetType() != node.GetType())
 		{
-			llvm::Value* casted = CastValue(value, node.GetType(), llvmContext, builder);
+			llvm::Value* casted = CastValue(value, expression->GetType(), node.GetType(), llvmContext, builder);
 			if (!casted)
 			{
 				auto fmt = boost::format("can't set expression of type '%1%' to variable '%2%' of type '%3%'")
-					% ToString(ToExpressionType(value->getType()))
+					% ToString(expression->GetType())
 					% name
 					% ToString(node.GetType());
 				throw std::runtime_error(fmt.str());
@@ -661,24 +695,26 @@ void StatementCodegen::Visit(const AssignStatementAST& node)
 	llvm::IRBuilder<>& builder = utils.GetBuilder();
 	llvm::LLVMContext& llvmContext = utils.GetLLVMContext();
 
-	const std::string& name = node.GetIdentifier().GetName();
-	llvm::AllocaInst* variable = m_context.GetVariable(name);
+	const std::string name = node.GetIdentifier().GetName();
+	llvm::AllocaInst* variable = m_context.GetVariable(node.GetIdentifier().GetSymbol());
 	if (!variable)
 	{
 		throw std::runtime_error("can't assign because variable '" + name + "' is not defined");
 	}
 
 	llvm::Value* value = m_expressionCodegen.Visit(node.GetExpr());
+	const ExpressionType type = node.GetExpr().GetType();
+	const ExpressionType variableType = node.GetIdentifier().GetType();
 
-	if (ToExpressionType(value->getType()) != ToExpressionType(variable->getType()->getPointerElementType()))
+	if (type != variableType)
 	{
-		llvm::Value* casted = CastValue(value, ToExpressionType(variable->getType()->getPointerElementType()), llvmContext, builder);
+		llvm::Value* casted = CastValue(value, type, variableType, llvmContext, builder);
 		if (!casted)
 		{
 			auto fmt = boost::format("can't set expression of type '%1%' to variable '%2%' of type '%3%'")
-				% ToString(ToExpressionType(value->getType()))
+				% ToString(type)
 				% name
-				% ToString(ToExpressionType(variable->getType()->getPointerElementType()));
+				% ToString(variableType);
 			throw std::runtime_error(fmt.str());
 		}
 
@@ -698,7 +734,7 @@ void StatementCodegen::Visit(const ArrayElementAssignAST& node)
 	llvm::IRBuilder<>& builder = utils.GetBuilder();
 	llvm::LLVMContext& llvmContext = utils.GetLLVMContext();
 
-	llvm::AllocaInst* variable = m_context.GetVariable(node.GetName());
+	llvm::AllocaInst* variable = m_context.GetVariable(node.GetSymbol());
 	if (!variable)
 	{
 		throw std::runtime_error("variable '" + node.GetName() + "' is not defined");
@@ -709,9 +745,11 @@ void StatementCodegen::Visit(const ArrayElementAssignAST& node)
 		throw std::runtime_error("variable '" + node.GetName() + "' can't be accessed via index");
 	}
 
-	llvm::Value* index = ConvertToIntegerValue(m_expressionCodegen.Visit(node.GetIndex()), llvmContext, builder);
+	llvm::Value* index = ConvertToIntegerValue(
+		m_expressionCodegen.Visit(node.GetIndex()), node.GetIndex().GetType(), llvmContext, builder);
 
-	llvm::Value* value = ConvertToIntegerValue(m_expressionCodegen.Visit(node.GetExpression()), llvmContext, builder);
+	llvm::Value* value = ConvertToIntegerValue(
+		m_expressionCodegen.Visit(node.GetExpression()), node.GetExpression().GetType(), llvmContext, builder);
 	if (value->getType()->getTypeID() == llvm::Type::IntegerTyID && value->getType()->getIntegerBitWidth() != 8)
 	{
 		value = builder.CreateIntCast(value, llvm::Type::getInt8Ty(llvmContext), false, "icasttmp");
@@ -732,32 +770,33 @@ void StatementCodegen::Visit(const ReturnStatementAST& node)
 	llvm::LLVMContext& llvmContext = utils.GetLLVMContext();
 
 	llvm::Function* func = builder.GetInsertBlock()->getParent();
-	if (func->getReturnType()->getTypeID() == llvm::Type::VoidTyID)
+	if (!m_returnType)
 	{
 		if (node.GetExpression())
 		{
-			llvm::Value* value = m_expressionCodegen.Visit(*node.GetExpression());
-			const ExpressionType type = ToExpressionType(value->getType());
+			m_expressionCodegen.Visit(*node.GetExpression());
+			const ExpressionType type = node.GetExpression()->GetType();
 			throw std::runtime_error("function '" + func->getName().str() + "' can't return value of type " + ToString(type));
 		}
 		builder.CreateRet(nullptr);
 		return;
 	}
 
-	const ExpressionType funcReturnType = ToExpressionType(func->getReturnType());
+	const ExpressionType funcReturnType = *m_returnType;
 	if (!node.GetExpression())
 	{
 		throw std::runtime_error("return statement must have expression of type" + ToString(funcReturnType));
 	}
 
 	llvm::Value* value = m_expressionCodegen.Visit(*node.GetExpression());
-	if (ToExpressionType(value->getType()) != funcReturnType)
+	const ExpressionType type = node.GetExpression()->GetType();
+	if (type != funcReturnType)
 	{
-		value = CastValue(value, funcReturnType, llvmContext, builder);
+		value = CastValue(value, type, funcReturnType, llvmContext, builder);
 		if (!value)
 		{
 			auto fmt = boost::format("returning expression of type %1% must be at least convertible to function return type (%2%)")
-				% ToString(ToExpressionType(value->getType()))
+				% ToString(type)
 				% ToString(funcReturnType);
 			throw std::runtime_error(fmt.str());
 		}
@@ -781,7 +820,7 @@ void StatementCodegen::Visit(const IfStatementAST& node)
 	llvm::BasicBlock* continueBlock = llvm::BasicBlock::Create(llvmContext, "continue", func);
 
 	llvm::Value* value = m_expressionCodegen.Visit(node.GetExpr());
-	value = ConvertToBooleanValue(value, llvmContext, builder);
+	value = ConvertToBooleanValue(value, node.GetExpr().GetType(), llvmContext, builder);
 	builder.CreateCondBr(value, thenBlock, elseBlock);
 
 	auto putBrAfterBranchInsertionIfNecessary = [&](llvm::BasicBlock* branch) {
@@ -829,20 +868,21 @@ void StatementCodegen::Visit(const WhileStatementAST& node)
 	llvm::BasicBlock* body = llvm::BasicBlock::Create(llvmContext, "loop", func);
 	llvm::BasicBlock* afterLoop = llvm::BasicBlock::Create(llvmContext, "afterloop", func);
 
+	const ExpressionType type = node.GetExpr().GetType();
 	llvm::Value* value = ConvertToBooleanValue(
-		m_expressionCodegen.Visit(node.GetExpr()), llvmContext, builder);
+		m_expressionCodegen.Visit(node.GetExpr()), type, llvmContext, builder);
 	builder.CreateCondBr(value, body, afterLoop);
 
 	auto putBrAfterBranchInsertionIfNecessary = [&](llvm::BasicBlock* branch) {
 		if (!branch->getTerminator())
 		{
-			value = ConvertToBooleanValue(m_expressionCodegen.Visit(node.GetExpr()), llvmContext, builder);
+			value = ConvertToBooleanValue(m_expressionCodegen.Visit(node.GetExpr()), type, llvmContext, builder);
 			builder.CreateCondBr(value, body, afterLoop);
 		}
 		if (!m_branchContinueStack.empty() && !m_branchContinueStack.back()->getTerminator())
 		{
 			builder.SetInsertPoint(m_branchContinueStack.back());
-			value = ConvertToBooleanValue(m_expressionCodegen.Visit(node.GetExpr()), llvmContext, builder);
+			value = ConvertToBooleanValue(m_expressionCodegen.Visit(node.GetExpr()), type, llvmContext, builder);
 			builder.CreateCondBr(value, body, afterLoop);
 		}
 		if (!m_branchContinueStack.empty())
@@ -866,7 +906,7 @@ void StatementCodegen::Visit(const CompositeStatementAST& node)
 
 	for (size_t i = 0; i < node.GetCount(); ++i)
 	{
-		node.GetStatement(i).Accept(*this);
+		Visit(node.GetStatement(i));
 		if (builder.GetInsertBlock()->getTerminator())
 		{
 			break;
@@ -886,13 +926,13 @@ void StatementCodegen::Visit(const PrintAST& node)
 	for (size_t i = 0; i < expressions.size(); ++i)
 	{
 		expressions[i] = m_expressionCodegen.Visit(node.GetExpression(i));
-		if (ToExpressionType(expressions[i]->getType()) == ExpressionType::Bool)
+		if (node.GetExpression(i).GetType() == ExpressionType::Bool)
 		{
-			expressions[i] = ConvertToIntegerValue(expressions[i], llvmContext, builder);
+			expressions[i] = ConvertToIntegerValue(expressions[i], ExpressionType::Bool, llvmContext, builder);
 		}
 	}
 
-	if (expressions.empty() || ToExpressionType(expressions.front()->getType()) != ExpressionType::String)
+	if (expressions.empty() || node.GetExpression(0).GetType() != ExpressionType::String)
 	{
 		throw std::runtime_error("print statement requires string as first argument");
 	}
@@ -927,41 +967,41 @@ void StatementCodegen::Visit(const FunctionCallStatementAST& node)
 		throw std::runtime_error((fmt % call.GetName() % func->arg_size() % call.GetParamsCount()).str());
 	}
 
-	size_t index = 0;
+	const std::vector<ExpressionType>& paramTypes = GetParamTypes(m_context, call.GetName());
 	std::vector<llvm::Value*> params;
 
-	for (llvm::Argument& arg : func->args())
+	for (size_t index = 0; index < paramTypes.size(); ++index)
 	{
 		llvm::Value* value = m_expressionCodegen.Visit(call.GetParam(index));
+		const ExpressionType type = call.GetParam(index).GetType();
 
-		if (ToExpressionType(value->getType()) != ToExpressionType(arg.getType()))
+		if (type != paramTypes[index])
 		{
-			llvm::Value* casted = CastValue(value, ToExpressionType(arg.getType()), llvmContext, builder);
+			llvm::Value* casted = CastValue(value, type, paramTypes[index], llvmContext, builder);
 			if (!casted)
 			{
 				auto fmt = boost::format("function '%1%' expects '%2%' as parameter, '%3%' given (can't cast)")
 					% func->getName().str()
-					% ToString(ToExpressionType(arg.getType()))
-					% ToString(ToExpressionType(value->getType()));
+					% ToString(paramTypes[index])
+					% ToString(type);
 				throw std::runtime_error(fmt.str());
 			}
 
-			assert(ToExpressionType(casted->getType()) == ToExpressionType(arg.getType()));
+			assert(ToExpressionType(casted->getType()) == ToExpressionType(func->getFunctionType()->getParamType(unsigned(index))));
 			params.push_back(casted);
-			++index;
 			continue;
 		}
 
-		assert(ToExpressionType(value->getType()) == ToExpressionType(arg.getType()));
+		assert(ToExpressionType(value->getType()) == ToExpressionType(func->getFunctionType()->getParamType(unsigned(index))));
 		params.push_back(value);
-		++index;
 	}
 
 	builder.CreateCall(func, params);
 }
 
-Codegen::Codegen(CodegenContext& context)
+Codegen::Codegen(CodegenContext& context, bool fold)
 	: m_context(context)
+	, m_fold(fold)
 {
 }
 
@@ -975,6 +1015,8 @@ void Codegen::Generate(const ProgramAST& program)
 
 void Codegen::Generate(const IStatementAST& statement)
 {
+	m_context.GetTypeChecker().Check(statement);
+
 	CodegenUtils& utils = m_context.GetUtils();
 
 	llvm::LLVMContext& llvmContext = utils.GetLLVMContext();
@@ -992,8 +1034,14 @@ void Codegen::Generate(const IStatementAST& statement)
 	llvm::BasicBlock* bb = llvm::BasicBlock::Create(llvmContext, name + "_entry", llvmFunc);
 	builder.SetInsertPoint(bb);
 
-	StatementCodegen statementCodegen(m_context);
-	statementCodegen.Visit(statement);
+	StatementCodegen statementCodegen(m_context, ExpressionType::Int);
+	statementCodegen.Visit(Fold(statement));
+
+	// Running off the end of the block returns 0, as from C's main.
+	if (!builder.GetInsertBlock()->getTerminator())
+	{
+		builder.CreateRet(llvm::ConstantInt::get(returnType, 0));
+	}
 
 	std::string output;
 	llvm::raw_string_ostream out(output);
@@ -1010,13 +1058,17 @@ void Codegen::Generate(const IStatementAST& statement)
 
 void Codegen::GenerateFunc(const FunctionAST& func)
 {
+	// One function at a time, so that errors come in the order they did
+	// when codegen found them itself.
+	m_context.GetTypeChecker().Check(func);
+
 	CodegenUtils& utils = m_context.GetUtils();
 
 	llvm::LLVMContext& llvmContext = utils.GetLLVMContext();
 	llvm::IRBuilder<>& builder = utils.GetBuilder();
 	llvm::Module& llvmModule = utils.GetModule();
 
-	const std::string& name = func.GetIdentifier().GetName();
+	const std::string name = func.GetIdentifier().GetName();
 
 	llvm::Type* returnType = func.GetReturnType() ?
 		ToLLVMType(*func.GetReturnType(), llvmContext) :
@@ -1033,6 +1085,9 @@ void Codegen::GenerateFunc(const FunctionAST& func)
 	llvm::Function* llvmFunc = llvm::Function::Create(
 		funcType, llvm::Function::ExternalLinkage, name, &llvmModule);
 
+	// Registered before the body so that it can call itself.
+	m_context.AddFunction(name, llvmFunc);
+
 	ContextScopeHelper scopedContext(m_context);
 
 	llvm::BasicBlock* bb = llvm::BasicBlock::Create(llvmContext, name + "_entry", llvmFunc);
@@ -1043,17 +1098,28 @@ void Codegen::GenerateFunc(const FunctionAST& func)
 	{
 		assert(index < func.GetParams().size());
 		const FunctionAST::Param& param = func.GetParams()[index];
-		argument.setName(func.GetParams()[index].first);
+		const std::string paramName = StringInterner::Global().GetString(param.first);
+		argument.setName(paramName);
 
-		llvm::AllocaInst* variable = builder.CreateAlloca(ToLLVMType(param.second, llvmContext), nullptr, param.first + "Ptr");
+		llvm::AllocaInst* variable = builder.CreateAlloca(ToLLVMType(param.second, llvmContext), nullptr, paramName + "Ptr");
 		m_context.Define(param.first, variable);
 		builder.CreateStore(&argument, variable);
 
 		++index;
 	}
 
-	StatementCodegen statementCodegen(m_context);
-	statementCodegen.Visit(func.GetStatement());
+	// A function that fails from here on is taken back out of the context,
+	// so that no later call reaches its half-built or erased IR.
+	StatementCodegen statementCodegen(m_context, func.GetReturnType());
+	try
+	{
+		statementCodegen.Visit(Fold(func.GetStatement()));
+	}
+	catch (...)
+	{
+		m_context.RemoveFunction(name);
+		throw;
+	}
 
 	if (llvm::BasicBlock* lastContinueBranch = statementCodegen.GetLastBasicBlockBranch())
 	{
@@ -1077,6 +1143,7 @@ void Codegen::GenerateFunc(const FunctionAST& func)
 		if (!basicBlock.getTerminator())
 		{
 			//llvmFunc->dump();
+			m_context.RemoveFunction(name);
 			throw std::runtime_error("every path must have return statement");
 		}
 	}
@@ -1087,9 +1154,13 @@ void Codegen::GenerateFunc(const FunctionAST& func)
 	if (llvm::verifyFunction(*llvmFunc, &out))
 	{
 		//utils.GetModule().dump();
+		m_context.RemoveFunction(name);
 		llvmFunc->eraseFromParent();
 		throw std::runtime_error(out.str());
 	}
+}
 
-	m_context.AddFunction(func.GetIdentifier().GetName(), llvmFunc);
+const IStatementAST& Codegen::Fold(const IStatementAST& statement)
+{
+	return m_fold ? *m_context.GetConstantFolder().Fold(statement) : statement;
 }
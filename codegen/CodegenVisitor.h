@@ -1,61 +1,73 @@
 #pragma once
 #include "../AST/AST.h"
+#include "../AST/SwitchVisitor.h"
 #include "CodegenContext.h"
 #include <vector>
 
-class ExpressionCodegen : public IExpressionVisitor
+// Dispatches on the node kind rather than through Accept, so each node
+// costs a switch instead of two virtual calls and its value is returned
+// directly.
+class ExpressionCodegen : public ExpressionSwitch<ExpressionCodegen, llvm::Value*>
 {
 public:
 	explicit ExpressionCodegen(CodegenContext& context);
 	llvm::Value* Visit(const IExpressionAST& node);
 
 private:
-	void Visit(const BinaryExpressionAST& node) override;
-	void Visit(const LiteralConstantAST& node) override;
-	void Visit(const UnaryAST& node) override;
-	void Visit(const IdentifierAST& node) override;
-	void Visit(const FunctionCallExprAST& node) override;
-	void Visit(const ArrayElementAccessAST& node) override;
+	friend class ExpressionSwitch<ExpressionCodegen, llvm::Value*>;
+
+	llvm::Value* Visit(const BinaryExpressionAST& node);
+	llvm::Value* Visit(const LiteralConstantAST& node);
+	llvm::Value* Visit(const UnaryAST& node);
+	llvm::Value* Visit(const IdentifierAST& node);
+	llvm::Value* Visit(const FunctionCallExprAST& node);
+	llvm::Value* Visit(const ArrayElementAccessAST& node);
 
 private:
 	CodegenContext& m_context;
-	std::vector<llvm::Value*> m_stack;
 };
 
-class StatementCodegen : public IStatementVisitor
+class StatementCodegen : public StatementSwitch<StatementCodegen, void>
 {
 public:
-	explicit StatementCodegen(CodegenContext& context);
+	// returnType is that of the function being generated, none for void.
+	StatementCodegen(CodegenContext& context, boost::optional<ExpressionType> returnType);
 	void Visit(const IStatementAST& node);
 	llvm::BasicBlock* GetLastBasicBlockBranch();
 
 private:
-	void Visit(const VariableDeclarationAST& node) override;
-	void Visit(const ReturnStatementAST& node) override;
-	void Visit(const AssignStatementAST& node) override;
-	void Visit(const ArrayElementAssignAST& node) override;
-	void Visit(const IfStatementAST& node) override;
-	void Visit(const WhileStatementAST& node) override;
-	void Visit(const CompositeStatementAST& node) override;
-	void Visit(const PrintAST& node) override;
-	void Visit(const FunctionCallStatementAST& node) override;
+	friend class StatementSwitch<StatementCodegen, void>;
+
+	void Visit(const VariableDeclarationAST& node);
+	void Visit(const ReturnStatementAST& node);
+	void Visit(const AssignStatementAST& node);
+	void Visit(const ArrayElementAssignAST& node);
+	void Visit(const IfStatementAST& node);
+	void Visit(const WhileStatementAST& node);
+	void Visit(const CompositeStatementAST& node);
+	void Visit(const PrintAST& node);
+	void Visit(const FunctionCallStatementAST& node);
 
 private:
 	CodegenContext& m_context;
 	ExpressionCodegen m_expressionCodegen;
+	boost::optional<ExpressionType> m_returnType;
 	std::vector<llvm::BasicBlock*> m_branchContinueStack;
 };
 
 class Codegen
 {
 public:
-	explicit Codegen(CodegenContext& context);
+	// With fold, each tree is constant folded after it is type checked.
+	explicit Codegen(CodegenContext& context, bool fold = true);
 	void Generate(const ProgramAST& program);
 	void Generate(const IStatementAST& statement);
 
 private:
 	void GenerateFunc(const FunctionAST& func);
+	const IStatementAST& Fold(const IStatementAST& statement);
 
 private:
 	CodegenContext& m_context;
+	const bool m_fold;
 };
@@ -1,9 +1,10 @@
 #pragma once
 #include <vector>
-#include <string>
 #include <unordered_map>
 #include <boost/optional.hpp>
 
+#include "../AST/StringInterner.h"
+
 template <typename Value>
 class ScopeChain
 {
@@ -11,12 +12,12 @@ public:
 	void PushScope();
 	void PopScope();
 
-	void Define(const std::string& name, const Value& value);
-	bool Assign(const std::string& name, const Value& value);
-	boost::optional<Value> GetValue(const std::string& name);
+	void Define(SymbolId name, const Value& value);
+	bool Assign(SymbolId name, const Value& value);
+	boost::optional<Value> GetValue(SymbolId name);
 
 private:
-	std::vector<std::unordered_map<std::string, Value>> m_scopes;
+	std::vector<std::unordered_map<SymbolId, Value>> m_scopes;
 };
 
 template <typename Value>
@@ -36,7 +37,7 @@ void ScopeChain<Value>::PushScope()
 }
 
 template <typename Value>
-void ScopeChain<Value>::Define(const std::string& name, const Value& value)
+void ScopeChain<Value>::Define(SymbolId name, const Value& value)
 {
 	if (m_scopes.empty())
 	{
@@ -46,7 +47,7 @@ void ScopeChain<Value>::Define(const std::string& name, const Value& value)
 }
 
 template <typename Value>
-bool ScopeChain<Value>::Assign(const std::string& name, const Value& value)
+bool ScopeChain<Value>::Assign(SymbolId name, const Value& value)
 {
 	for (auto it = m_scopes.rbegin(); it != m_scopes.rend(); ++it)
 	{
@@ -61,7 +62,7 @@ bool ScopeChain<Value>::Assign(const std::string& name, const Value& value)
 }
 
 template <typename Value>
-boost::optional<Value> ScopeChain<Value>::GetValue(const std::string& name)
+boost::optional<Value> ScopeChain<Value>::GetValue(SymbolId name)
 {
 	for (auto it = m_scopes.crbegin(); it != m_scopes.crend(); ++it)
 	{
@@ -0,0 +1,418 @@
+#include "TypeChecker.h"
+#include "ScopeChain.h"
+#include "../AST/StackGuard.h"
+#include "../AST/SwitchVisitor.h"
+#include <boost/format.hpp>
+
+namespace
+{
+std::string ToCastTargetName(ExpressionType type)
+{
+	switch (type)
+	{
+	case ExpressionType::Int:
+		return "integer";
+	case ExpressionType::Float:
+		return "float";
+	case ExpressionType::Bool:
+		return "bool";
+	case ExpressionType::String:
+		return "string";
+	}
+	assert(false);
+	throw std::logic_error("ToCastTargetName() - undefined expression type");
+}
+
+// Whether codegen can convert a value of type from to type to. Like codegen,
+// it throws for a string made into anything else.
+bool Cast(ExpressionType from, ExpressionType to)
+{
+	if (Convertible(from, to))
+	{
+		return true;
+	}
+	if (from == ExpressionType::String)
+	{
+		throw std::runtime_error("can't cast string to " + ToCastTargetName(to));
+	}
+	return false;
+}
+
+bool IsArithmetic(BinaryExpressionAST::Operator operation)
+{
+	switch (operation)
+	{
+	case BinaryExpressionAST::Plus:
+	case BinaryExpressionAST::Minus:
+	case BinaryExpressionAST::Mul:
+	case BinaryExpressionAST::Div:
+	case BinaryExpressionAST::Mod:
+		return true;
+	default:
+		return false;
+	}
+}
+}
+
+class TypeChecker::Pass
+	: public ExpressionSwitch<Pass, ExpressionType>
+	, public StatementSwitch<Pass, bool>
+{
+public:
+	Pass(const std::unordered_map<std::string, Signature>& functions, const std::string& function,
+		boost::optional<ExpressionType> returnType)
+		: m_functions(functions)
+		, m_function(function)
+		, m_returnType(returnType)
+	{
+		m_scopes.PushScope();
+	}
+
+	void Define(SymbolId name, ExpressionType type)
+	{
+		m_scopes.Define(name, type);
+	}
+
+	ExpressionType Check(const IExpressionAST& node)
+	{
+		if (StackGuard::IsNearEnd())
+		{
+			ExpressionType type = ExpressionType::Int;
+			StackGuard::Grow([&] { type = Check(node); });
+			return type;
+		}
+		const ExpressionType type = ExpressionSwitch<Pass, ExpressionType>::Dispatch(node);
+		node.SetType(type);
+		return type;
+	}
+
+	// True if the statement ends its block: codegen emits nothing after it.
+	bool Check(const IStatementAST& node)
+	{
+		if (StackGuard::IsNearEnd())
+		{
+			bool terminates = false;
+			StackGuard::Grow([&] { terminates = Check(node); });
+			return terminates;
+		}
+		return StatementSwitch<Pass, bool>::Dispatch(node);
+	}
+
+	ExpressionType Visit(const BinaryExpressionAST& node)
+	{
+		const ExpressionType left = Check(node.GetLeft());
+		const ExpressionType right = Check(node.GetRight());
+
+		const auto type = GetPreferredType(left, right);
+		if (!type)
+		{
+			const auto fmt = boost::format("can't codegen operator '%1%' on operands with types '%2%' and '%3%'")
+				% ToString(node.GetOperator())
+				% ToString(left)
+				% ToString(right);
+			throw std::runtime_error(fmt.str());
+		}
+
+		switch (*type)
+		{
+		case ExpressionType::Int:
+		case ExpressionType::Float:
+			return IsArithmetic(node.GetOperator()) ? *type : ExpressionType::Bool;
+		case ExpressionType::Bool:
+			if (IsArithmetic(node.GetOperator()))
+			{
+				throw std::runtime_error("can't perform codegen for operator '" + ToString(node.GetOperator()) + "' on booleans");
+			}
+			return ExpressionType::Bool;
+		case ExpressionType::String:
+		default:
+			throw std::runtime_error("can't codegen binary operator '" +
+				ToString(node.GetOperator()) + "' for " + ToString(*type));
+		}
+	}
+
+	ExpressionType Visit(const LiteralConstantAST& node)
+	{
+		return node.GetType();
+	}
+
+	ExpressionType Visit(const UnaryAST& node)
+	{
+		const ExpressionType type = Check(node.GetExpr());
+
+		switch (node.GetOperator())
+		{
+		case UnaryAST::Plus:
+			return type;
+		case UnaryAST::Minus:
+			if (type == ExpressionType::String)
+			{
+				throw std::runtime_error("can't create negative value of " + ToString(type));
+			}
+			return type;
+		case UnaryAST::Negation:
+			Cast(type, ExpressionType::Bool);
+			return ExpressionType::Bool;
+		default:
+			assert(false);
+			throw std::logic_error("Visit(UnaryAST): undefined unary operator");
+		}
+	}
+
+	ExpressionType Visit(const IdentifierAST& node)
+	{
+		return GetVariable(node.GetSymbol(), node.GetName());
+	}
+
+	ExpressionType Visit(const FunctionCallExprAST& node)
+	{
+		const Signature& signature = CheckCall(node);
+		if (!signature.returnType)
+		{
+			throw std::runtime_error("function '" + node.GetName() + "' returns void - you can't store the result");
+		}
+		return *signature.returnType;
+	}
+
+	ExpressionType Visit(const ArrayElementAccessAST& node)
+	{
+		GetVariable(node.GetSymbol(), node.GetName());
+		Cast(Check(node.GetIndex()), ExpressionType::Int);
+		// Elements are chars, read as int.
+		return ExpressionType::Int;
+	}
+
+	bool Visit(const VariableDeclarationAST& node)
+	{
+		const IdentifierAST& identifier = node.GetIdentifier();
+		if (m_scopes.GetValue(identifier.GetSymbol()))
+		{
+			throw std::runtime_error("variable '" + identifier.GetName() + "' is already defined");
+		}
+		m_scopes.Define(identifier.GetSymbol(), node.GetType());
+		identifier.SetType(node.GetType());
+
+		if (const IExpressionAST* expression = node.GetExpression())
+		{
+			CheckStore(Check(*expression), identifier);
+		}
+		return false;
+	}
+
+	bool Visit(const AssignStatementAST& node)
+	{
+		const IdentifierAST& identifier = node.GetIdentifier();
+		const auto type = m_scopes.GetValue(identifier.GetSymbol());
+		if (!type)
+		{
+			throw std::runtime_error("can't assign because variable '" + identifier.GetName() + "' is not defined");
+		}
+		identifier.SetType(*type);
+
+		CheckStore(Check(node.GetExpr()), identifier);
+		return false;
+	}
+
+	bool Visit(const ArrayElementAssignAST& node)
+	{
+		GetVariable(node.GetSymbol(), node.GetName());
+		Cast(Check(node.GetIndex()), ExpressionType::Int);
+		Cast(Check(node.GetExpression()), ExpressionType::Int);
+		return false;
+	}
+
+	bool Visit(const ReturnStatementAST& node)
+	{
+		if (!m_returnType)
+		{
+			if (node.GetExpression())
+			{
+				const ExpressionType type = Check(*node.GetExpression());
+				throw std::runtime_error("function '" + m_function + "' can't return value of type " + ToString(type));
+			}
+			return true;
+		}
+
+		if (!node.GetExpression())
+		{
+			throw std::runtime_error("return statement must have expression of type" + ToString(*m_returnType));
+		}
+
+		const ExpressionType type = Check(*node.GetExpression());
+		if (!Cast(type, *m_returnType))
+		{
+			auto fmt = boost::format("returning expression of type %1% must be at least convertible to function return type (%2%)")
+				% ToString(type)
+				% ToString(*m_returnType);
+			throw std::runtime_error(fmt.str());
+		}
+		return true;
+	}
+
+	bool Visit(const IfStatementAST& node)
+	{
+		Cast(Check(node.GetExpr()), ExpressionType::Bool);
+		Check(node.GetThenStmt());
+		if (node.GetElseStmt())
+		{
+			Check(*node.GetElseStmt());
+		}
+		return false;
+	}
+
+	bool Visit(const WhileStatementAST& node)
+	{
+		Cast(Check(node.GetExpr()), ExpressionType::Bool);
+		Check(node.GetStatement());
+		return false;
+	}
+
+	bool Visit(const CompositeStatementAST& node)
+	{
+		m_scopes.PushScope();
+		bool terminates = false;
+		for (size_t i = 0; i < node.GetCount() && !terminates; ++i)
+		{
+			terminates = Check(node.GetStatement(i));
+		}
+		m_scopes.PopScope();
+		return terminates;
+	}
+
+	bool Visit(const PrintAST& node)
+	{
+		for (size_t i = 0; i < node.GetParamsCount(); ++i)
+		{
+			Check(node.GetExpression(i));
+		}
+		if (node.GetParamsCount() == 0 || node.GetExpression(0).GetType() != ExpressionType::String)
+		{
+			throw std::runtime_error("print statement requires string as first argument");
+		}
+		return false;
+	}
+
+	bool Visit(const FunctionCallStatementAST& node)
+	{
+		// The result of a call made for its effect is dropped.
+		const FunctionCallExprAST& call = node.GetCallAsDerived();
+		if (GetFunction(call).returnType)
+		{
+			Check(node.GetCall());
+		}
+		else
+		{
+			CheckCall(call);
+		}
+		return false;
+	}
+
+private:
+	ExpressionType GetVariable(SymbolId symbol, const std::string& name)
+	{
+		const auto type = m_scopes.GetValue(symbol);
+		if (!type)
+		{
+			throw std::runtime_error("variable '" + name + "' is not defined");
+		}
+		return *type;
+	}
+
+	const Signature& GetFunction(const FunctionCallExprAST& call)
+	{
+		auto found = m_functions.find(call.GetName());
+		if (found == m_functions.end())
+		{
+			throw std::runtime_error("calling function '" + call.GetName() + "' that isn't defined");
+		}
+		return found->second;
+	}
+
+	const Signature& CheckCall(const FunctionCallExprAST& call)
+	{
+		const Signature& signature = GetFunction(call);
+		if (signature.params.size() != call.GetParamsCount())
+		{
+			boost::format fmt("function '%1%' expects %2% params, %3% given");
+			throw std::runtime_error((fmt % call.GetName() % signature.params.size() % call.GetParamsCount()).str());
+		}
+
+		for (size_t i = 0; i < signature.params.size(); ++i)
+		{
+			const ExpressionType type = Check(call.GetParam(i));
+			if (!Cast(type, signature.params[i]))
+			{
+				auto fmt = boost::format("function '%1%' expects '%2%' as parameter, '%3%' given (can't cast)")
+					% call.GetName()
+					% ToString(signature.params[i])
+					% ToString(type);
+				throw std::runtime_error(fmt.str());
+			}
+		}
+		return signature;
+	}
+
+	void CheckStore(ExpressionType type, const IdentifierAST& variable)
+	{
+		if (!Cast(type, variable.GetType()))
+		{
+			auto fmt = boost::format("can't set expression of type '%1%' to variable '%2%' of type '%3%'")
+				% ToString(type)
+				% variable.GetName()
+				% ToString(variable.GetType());
+			throw std::runtime_error(fmt.str());
+		}
+	}
+
+	const std::unordered_map<std::string, Signature>& m_functions;
+	const std::string m_function;
+	const boost::optional<ExpressionType> m_returnType;	// none for void
+	ScopeChain<ExpressionType> m_scopes;
+};
+
+void TypeChecker::Check(const FunctionAST& function)
+{
+	const std::string name = function.GetIdentifier().GetName();
+
+	// Registered before the body so that it can call itself.
+	Signature& signature = m_functions[name];
+	signature.returnType = function.GetReturnType();
+	signature.params.clear();
+	for (const FunctionAST::Param& param : function.GetParams())
+	{
+		signature.params.push_back(param.second);
+	}
+
+	Pass pass(m_functions, name, function.GetReturnType());
+	for (const FunctionAST::Param& param : function.GetParams())
+	{
+		pass.Define(param.first, param.second);
+	}
+	pass.Check(function.GetStatement());
+}
+
+void TypeChecker::Check(const IStatementAST& block)
+{
+	const std::string name("main");
+
+	Pass pass(m_functions, name, ExpressionType::Int);
+	pass.Check(block);
+
+	Signature& signature = m_functions[name];
+	signature.returnType = ExpressionType::Int;
+	signature.params.clear();
+}
+
+void TypeChecker::Check(const ProgramAST& program)
+{
+	for (size_t i = 0; i < program.GetFunctionsCount(); ++i)
+	{
+		Check(program.GetFunction(i));
+	}
+}
+
+const std::vector<ExpressionType>* TypeChecker::GetParams(const std::string& name)const
+{
+	auto found = m_functions.find(name);
+	return found != m_functions.end() ? &found->second.params : nullptr;
+}
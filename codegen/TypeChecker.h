@@ -0,0 +1,39 @@
+#pragma once
+#include "../AST/AST.h"
+#include <boost/optional.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Works out the type of every expression before codegen and keeps it on the
+// node, so codegen reads types from the tree instead of from the LLVM values
+// it builds. It rejects what codegen would reject, in the same order and
+// with the same messages, so codegen's own type errors are never reached.
+//
+// Functions are known to the bodies checked after them and to their own.
+class TypeChecker
+{
+public:
+	void Check(const FunctionAST& function);
+
+	// A block that codegen makes the body of main, which returns int.
+	void Check(const IStatementAST& block);
+
+	void Check(const ProgramAST& program);
+
+	// The parameter types of a function checked so far, which codegen
+	// converts the arguments of a call to; null if there is none.
+	const std::vector<ExpressionType>* GetParams(const std::string& name)const;
+
+private:
+	class Pass;
+
+	struct Signature
+	{
+		boost::optional<ExpressionType> returnType;	// none for void
+		std::vector<ExpressionType> params;
+	};
+
+	// By name, as codegen looks them up.
+	std::unordered_map<std::string, Signature> m_functions;
+};
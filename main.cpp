@@ -1,22 +1,188 @@
 #include <iostream>
 
+#include "ASTCache.h"
 #include "Parser.h"
 #include "Lexer.h"
+#include "TokenStream.h"
+#include "SourceBuffer.h"
 #include "ConsoleCtrl.h"
+#include "Error.h"
+#include "AST/ConstantFolder.h"
+#include "AST/ExpressionDAG.h"
+#include "AST/FlatAST.h"
+#include "AST/StackGuard.h"
 #include "codegen/CodegenContext.h"
 #include "codegen/CodegenVisitor.h"
 
+namespace
+{
+void printDiagnostics(const Parser &parser)
+{
+    for (const std::string &diagnostic : parser.diagnostics)
+    {
+        std::cout << diagnostic;
+    }
+}
+
+// What was parsed: a program of functions or else a single block.
+struct Tree
+{
+    const IStatementAST *block = nullptr;
+    const ProgramAST *program = nullptr;
+};
+
+// Parses the input and prints every syntax error the parser recovered from,
+// also when a later one ends the parse. Returns false if there were any;
+// otherwise the tree is kept in tree and added to flat, if given.
+bool parse(Parser &parser, ExpressionDAG &dag, Tree &tree, FlatAST *flat = nullptr)
+{
+    parser.maxErrors = ConsoleCtrl::errors;
+    parser.dag = ConsoleCtrl::share ? &dag : nullptr;
+
+    const IStatementAST *block = nullptr;
+    const ProgramAST *program = nullptr;
+    try
+    {
+        if (parser.look->tag == '{')
+        {
+            block = parser.stmt();
+        }
+        else
+        {
+            program = parser.program(ConsoleCtrl::jobs);
+        }
+    } catch (SourceError &e)
+    {
+        printDiagnostics(parser);
+
+        // Blocks left open at the end of the input all fail the same way.
+        if (!parser.diagnostics.empty() && parser.diagnostics.back() == e.what())
+        {
+            throw Error(nullptr);
+        }
+        throw;
+    } catch (...)
+    {
+        printDiagnostics(parser);
+        throw;
+    }
+    printDiagnostics(parser);
+    if (!parser.diagnostics.empty())
+    {
+        return false;
+    }
+    tree.block = block;
+    tree.program = program;
+
+    if (flat && block)
+    {
+        flat->AddStatement(*block);
+    }
+    for (size_t i = 0; flat && program && i < program->GetFunctionsCount(); i++)
+    {
+        flat->AddFunction(program->GetFunction(i));
+    }
+    return true;
+}
+
+// Builds the whole tree of an unchanged input from the cache, or parses the
+// input and keeps its tree there if it has no errors.
+bool parseCached(ASTContext &context, ExpressionDAG &dag, Tree &tree)
+{
+    ASTCache cache(ConsoleCtrl::cache);
+    auto *source = new SourceBuffer(ConsoleCtrl::ifile);
+    std::string key = ASTCache::key(source->begin(), source->size());
+
+    std::unique_ptr<ASTCache::Entry> entry = cache.find(key);
+    if (entry)
+    {
+        delete source;
+        const FlatAST &flat = entry->tree();
+        if (flat.GetFunctionsCount() > 0)
+        {
+            ProgramAST *program = context.Create<ProgramAST>();
+            flat.BuildProgram(context, *program);
+            tree.program = program;
+        }
+        else if (flat.GetSize() > 0)
+        {
+            // A block: the root comes after everything in it.
+            tree.block = flat.BuildStatement(FlatAST::Index(flat.GetSize() - 1), context);
+        }
+        return true;
+    }
+
+    TokenStream tokens(source, ConsoleCtrl::jobs);
+    Parser parser(&tokens, context);
+    FlatAST flat;
+    if (!parse(parser, dag, tree, &flat))
+    {
+        return false;
+    }
+    cache.store(key, flat);
+    return true;
+}
+}
+
 int main(int argc, const char * argv[])
 {
     int ret = EXIT_SUCCESS;
 
     try {
         ConsoleCtrl::process(argc, argv);
+        StackGuard::SetLimit(size_t(ConsoleCtrl::stack) << 20);
 
-        auto *lexer = new Lexer();
-        auto *parser = new Parser(lexer);
+        // Tokens live in the lexer's arena and go away with it; the tree
+        // lives in the context and goes in one go at the end.
+        ASTContext context;
+        ExpressionDAG dag(context);
+        Tree tree;
+        bool parsed;
+        if (ConsoleCtrl::cache)
+        {
+            parsed = parseCached(context, dag, tree);
+        }
+        else if (ConsoleCtrl::prelex)
+        {
+            TokenStream tokens(new SourceBuffer(ConsoleCtrl::ifile), ConsoleCtrl::jobs);
+            Parser parser(&tokens, context);
+            parsed = parse(parser, dag, tree);
+        }
+        else
+        {
+            Lexer lexer;
+            Parser parser(&lexer, context);
+            parsed = parse(parser, dag, tree);
+        }
+        if (!parsed)
+        {
+            ret = EXIT_FAILURE;
+        }
 
-        auto ast = parser->stmt();
+        if (ConsoleCtrl::stats)
+        {
+            std::cerr << "AST: " << context.GetNodeCount() << " nodes, "
+                      << context.GetBytesUsed() << " bytes" << std::endl;
+            if (ConsoleCtrl::share)
+            {
+                const ExpressionDAG::Stats &shared = dag.GetStats();
+                std::cerr << "Shared: " << shared.reused << " of " << shared.requested
+                          << " expression nodes, " << shared.bytesSaved << " bytes saved" << std::endl;
+            }
+
+            // What codegen, which folds every tree it is given, would fold.
+            ConstantFolder folder(context);
+            if (tree.block)
+            {
+                folder.Fold(*tree.block);
+            }
+            if (tree.program)
+            {
+                folder.Fold(*tree.program, *context.Create<ProgramAST>());
+            }
+            std::cerr << "Folded: " << folder.GetStats().folded << " operators, "
+                      << folder.GetStats().pruned << " branches pruned" << std::endl;
+        }
 
 //        std::unique_ptr<CodegenContext> context = llvm::make_unique<CodegenContext>();
 //        Codegen codegen(*context);
@@ -0,0 +1,179 @@
+#include "../ASTCache.h"
+#include "../Parser.h"
+#include "../SourceBuffer.h"
+#include "../TokenStream.h"
+#include "../AST/ASTContext.h"
+#include "../AST/FlatAST.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+// The fixtures the front end rejects, with part of the error each gives.
+// Any other fixture that fails to parse fails the test, as does one of
+// these that parses.
+const std::map<std::string, std::string> gcRejected = {
+	{ "1.txt", "syntax error" },	// do-while is not in the language
+	{ "5.txt", "'b' undeclared" },
+	{ "6.txt", "'b' undeclared" }
+};
+
+std::string ReadFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		throw std::runtime_error("cannot read " + path);
+	}
+	std::ostringstream text;
+	text << file.rdbuf();
+	return text.str();
+}
+
+std::string BaseName(const std::string& path)
+{
+	const size_t slash = path.find_last_of('/');
+	return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// Parses the text as the compiler does, a program of functions or else a
+// single block, and flattens the tree as the compiler does before storing it.
+void Flatten(const std::string& text, ASTContext& context, FlatAST& flat)
+{
+	TokenStream stream(new SourceBuffer(text.data(), text.size()));
+	Parser parser(&stream, context);
+	if (parser.look->tag == '{')
+	{
+		flat.AddStatement(*parser.stmt());
+		return;
+	}
+	const ProgramAST* program = parser.program();
+	for (size_t i = 0; i < program->GetFunctionsCount(); ++i)
+	{
+		flat.AddFunction(program->GetFunction(i));
+	}
+}
+
+// Builds the tree of a cache entry as a hit does and flattens it again.
+void Rebuild(const FlatAST& loaded, ASTContext& context, FlatAST& again)
+{
+	if (loaded.GetFunctionsCount() == 0 && loaded.GetSize() > 0)
+	{
+		// A block: the root comes after everything in it.
+		again.AddStatement(*loaded.BuildStatement(FlatAST::Index(loaded.GetSize() - 1), context));
+	}
+	for (size_t i = 0; i < loaded.GetFunctionsCount(); ++i)
+	{
+		again.AddFunction(*loaded.BuildFunction(loaded.GetFunction(i), context));
+	}
+}
+
+// Flips each bit of the image in turn. The damaged image must be refused
+// with std::runtime_error, which the cache takes as a miss, or else build a
+// tree like any other.
+void Damage(const std::string& image)
+{
+	std::vector<uint64_t> aligned((image.size() + 7) / 8);
+	for (size_t bit = 0; bit < image.size() * 8; ++bit)
+	{
+		memcpy(aligned.data(), image.data(), image.size());
+		reinterpret_cast<char*>(aligned.data())[bit / 8] ^= char(1 << (bit % 8));
+
+		std::unique_ptr<FlatAST> damaged;
+		try
+		{
+			damaged.reset(new FlatAST(aligned.data(), image.size()));
+		}
+		catch (const std::runtime_error&)
+		{
+			continue;
+		}
+		ASTContext context;
+		FlatAST again;
+		Rebuild(*damaged, context, again);
+	}
+}
+
+// Stores the tree of the fixture in the cache, reads it back and checks
+// that the tree built from it flattens to the image that was stored.
+void RoundTrip(const std::string& path, const ASTCache& cache)
+{
+	const std::string text = ReadFile(path);
+	ASTContext context;
+	FlatAST flat;
+	Flatten(text, context, flat);
+	std::string image;
+	flat.Save(image);
+
+	const std::string key = ASTCache::key(text.data(), text.size());
+	if (!cache.store(key, flat))
+	{
+		throw std::runtime_error("cannot store the tree in the cache");
+	}
+	std::unique_ptr<ASTCache::Entry> entry = cache.find(key);
+	if (!entry)
+	{
+		throw std::runtime_error("the tree just stored is not in the cache");
+	}
+
+	ASTContext rebuiltContext;
+	FlatAST again;
+	Rebuild(entry->tree(), rebuiltContext, again);
+	std::string second;
+	again.Save(second);
+	if (second != image)
+	{
+		throw std::runtime_error("the tree read back from the cache differs");
+	}
+	Damage(image);
+}
+}
+
+// Usage: cache_round_trip <cache directory> <fixture>...
+int main(int argc, const char* argv[])
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: cache_round_trip <cache directory> <fixture>...\n");
+		return EXIT_FAILURE;
+	}
+
+	const ASTCache cache(argv[1]);
+	int failures = 0;
+	for (int i = 2; i < argc; ++i)
+	{
+		const std::string name = BaseName(argv[i]);
+		auto rejected = gcRejected.find(name);
+		try
+		{
+			RoundTrip(argv[i], cache);
+			if (rejected != gcRejected.end())
+			{
+				fprintf(stderr, "%s: parsed, but the front end should reject it\n", name.c_str());
+				++failures;
+				continue;
+			}
+			printf("%s: ok\n", name.c_str());
+		}
+		catch (const std::exception& e)
+		{
+			const std::string reason = e.what() ? e.what() : "";
+			if (rejected != gcRejected.end() && reason.find(rejected->second) != std::string::npos)
+			{
+				printf("%s: rejected as expected\n", name.c_str());
+				continue;
+			}
+			fprintf(stderr, "%s: %s\n", name.c_str(), reason.substr(0, reason.find('\n')).c_str());
+			++failures;
+		}
+	}
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,373 @@
+#include "../IncrementalParser.h"
+#include "../Parser.h"
+#include "../SourceBuffer.h"
+#include "../TokenStream.h"
+#include "../AST/ASTContext.h"
+#include "../AST/FlatAST.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+const size_t gcRandomEdits = 3000;
+
+const char gcSource[] =
+	"int f0(int a)\n"
+	"{\n"
+	"    int b;\n"
+	"    b = a * 2 + 1;\n"
+	"    if (b > 10) { return b; }\n"
+	"    return a;\n"
+	"}\n"
+	"\n"
+	"void f1(int a, float c)\n"
+	"{\n"
+	"    while (a < 100) { a = a + f0(a); }\n"
+	"}\n"
+	"\n"
+	"bool f2(bool x)\n"
+	"{\n"
+	"    int i;\n"
+	"    i = 0;\n"
+	"    while (i < 3) { f1(i, 1.5); i = i + 1; }\n"
+	"    return !x;\n"
+	"}\n";
+
+// A program the compiler takes as one block.
+const char gcBlockSource[] =
+	"{\n"
+	"    int i; int j;\n"
+	"    i = 1;\n"
+	"    j = 0;\n"
+	"    while (i < 10)\n"
+	"    {\n"
+	"        int k;\n"
+	"        k = i * 2;\n"
+	"        if (k > 4) { j = j + k; } else { int j; j = k; }\n"
+	"        i = i + 1;\n"
+	"    }\n"
+	"    if (j == 0) { int i; i = 5; j = i; }\n"
+	"}\n";
+
+// What random edits insert: mostly pieces that break or close a function,
+// so that edits move where functions begin and end.
+const char* const gcSnippets[] = {
+	"}", "{", ";", "int ", "x", "\n", "(", ")", "return 1;", " ", "void g() { }\n", "int",
+	"\n\n", "{ int q; }", "if (a) ", "while", "a = 1;", "}\n}", "f0(a);"
+};
+
+// The tree and the errors of a parse from scratch, or the error that ended it.
+struct Parse
+{
+	std::string image;
+	std::vector<std::string> diagnostics;
+	std::string failure;
+};
+
+Parse ParseAll(const std::string& text)
+{
+	Parse parse;
+	TokenStream stream(new SourceBuffer(text.data(), text.size()));
+	ASTContext context;
+	Parser parser(&stream, context);
+	parser.maxErrors = 0;
+	try
+	{
+		// A program that opens with '{' is that block, as the compiler takes it.
+		if (parser.look->tag == '{')
+		{
+			FlatAST flat;
+			flat.AddStatement(*parser.stmt());
+			flat.Save(parse.image);
+		}
+		else
+		{
+			FlatAST(*parser.program()).Save(parse.image);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		parse.failure = e.what() ? e.what() : "";
+	}
+	parse.diagnostics = parser.diagnostics;
+	return parse;
+}
+
+// Applies the edit and checks that the tree and the errors are the ones a
+// parse from scratch of the edited text gives. Returns false if that parse
+// gave up, which leaves nothing to compare. Keeps the number of tokens the
+// edit reparsed in reparsed, if given.
+bool Edit(IncrementalParser& parser, size_t offset, size_t removed, const std::string& text, size_t* reparsed = nullptr)
+{
+	std::string failure;
+	try
+	{
+		const size_t count = parser.edit(offset, removed, text.data(), text.size());
+		if (reparsed)
+		{
+			*reparsed = count;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		failure = e.what() ? e.what() : "";
+	}
+
+	const Parse expected = ParseAll(parser.tokens().text());
+	if (!expected.failure.empty())
+	{
+		return false;
+	}
+	if (!failure.empty())
+	{
+		throw std::runtime_error("the edit failed where a full parse does not: " + failure);
+	}
+
+	std::string image;
+	if (parser.block())
+	{
+		FlatAST flat;
+		flat.AddStatement(*parser.block());
+		flat.Save(image);
+	}
+	else
+	{
+		FlatAST(parser.program()).Save(image);
+	}
+	if (image != expected.image)
+	{
+		throw std::runtime_error("the tree differs from a full parse");
+	}
+	if (parser.diagnostics() != expected.diagnostics)
+	{
+		std::string message = "the errors differ from a full parse:\n";
+		for (const std::string& diagnostic : parser.diagnostics())
+		{
+			message += "  incremental " + diagnostic;
+		}
+		for (const std::string& diagnostic : expected.diagnostics)
+		{
+			message += "  full        " + diagnostic;
+		}
+		throw std::runtime_error(message);
+	}
+	return true;
+}
+
+void Require(bool compared)
+{
+	if (!compared)
+	{
+		throw std::runtime_error("a full parse of the edited text gave up");
+	}
+}
+
+void Expect(bool condition, const char* failure)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(failure);
+	}
+}
+
+// A closing brace between two functions is an error of its own, and
+// removing it again leaves the functions as they were.
+void StrayBrace()
+{
+	const std::string source(gcSource);
+	IncrementalParser parser(source.data(), source.size());
+	const size_t between = source.find("\nvoid f1");
+	Require(Edit(parser, between, 0, "}"));
+	Expect(!parser.diagnostics().empty(), "a stray '}' gave no error");
+	Require(Edit(parser, between, 1, ""));
+	Expect(parser.diagnostics().empty(), "removing the stray '}' left an error");
+
+	// Inside a body it closes the function early instead.
+	Require(Edit(parser, parser.tokens().text().find("    return a;"), 0, "}"));
+}
+
+// The errors of a function left open at the end of the input belong to the
+// tokens up to EOF; an edit elsewhere must keep them, and closing the
+// function must drop them.
+void OpenAtEnd()
+{
+	const std::string source = std::string(gcSource) + "int f3()\n{\n    return 1;\n";
+	IncrementalParser parser(source.data(), source.size());
+	Require(Edit(parser, 0, 0, " "));
+	Require(Edit(parser, parser.tokens().text().find("a * 2"), 1, "b"));
+	Expect(!parser.diagnostics().empty(), "a function open at the end gave no error");
+	Require(Edit(parser, parser.tokens().textSize(), 0, "}\n"));
+	Expect(parser.diagnostics().empty(), "closing the function left an error");
+}
+
+// Lines added above a function with an error in it move the error, though
+// none of the function's tokens change.
+void LinesShift()
+{
+	std::string source(gcSource);
+	source.replace(source.find("i = 0;"), 6, "i = ;");
+	IncrementalParser parser(source.data(), source.size());
+	Expect(!parser.diagnostics().empty(), "'i = ;' gave no error");
+	Require(Edit(parser, 0, 0, "\n\n\n"));
+	Require(Edit(parser, parser.tokens().text().find("void f1"), 0, "\n"));
+	Require(Edit(parser, 0, 2, ""));
+}
+
+// An edit inside a block parses only that block again, with the variables
+// declared around it and the parameters in scope.
+void InnerBlock()
+{
+	const std::string source(gcSource);
+	IncrementalParser parser(source.data(), source.size());
+	const std::string loop = "{ f1(i, 1.5); i = i + 1; }";
+	size_t reparsed = 0;
+	Require(Edit(parser, source.find("1.5"), 3, "2.5", &reparsed));
+	Expect(reparsed == 15, "an edit in a block reparsed more than the block");
+
+	// i is declared in the function's block, x is a parameter and y is
+	// declared nowhere.
+	Require(Edit(parser, parser.tokens().text().find("i + 1"), 1, "x", &reparsed));
+	Expect(reparsed == 15 && parser.diagnostics().empty(), "variables around the block were not in scope");
+	Require(Edit(parser, parser.tokens().text().find("x + 1"), 1, "y", &reparsed));
+	Expect(reparsed == 15 && parser.diagnostics().size() == 1, "an undeclared variable gave no error");
+
+	// New lines move the error after the block, so the function is
+	// parsed whole.
+	Require(Edit(parser, parser.tokens().text().find("{ return b; }"), 0, "\n"));
+	Require(Edit(parser, parser.tokens().text().find("y + 1"), 1, "i"));
+	Expect(parser.diagnostics().empty(), "fixing the variable left an error");
+
+	// Taking a brace out pairs the others up differently.
+	Require(Edit(parser, parser.tokens().text().find("{ f1("), 1, ""));
+	Require(Edit(parser, parser.tokens().text().find("f1("), 0, "{"));
+}
+
+// A program that is one block is parsed as the compiler parses it, and an
+// edit in a block inside it parses that block alone.
+void BlockProgram()
+{
+	const std::string small = "{\nint i; int j;\ni = 1;\nj = i + 2;\n}\n";
+	IncrementalParser parser(small.data(), small.size());
+	Expect(parser.block() && parser.diagnostics().empty(), "a block program did not parse");
+	Require(Edit(parser, small.find("1;"), 1, "7"));
+	Require(Edit(parser, small.find("i + 2"), 1, "k"));
+	Expect(parser.diagnostics().size() == 1, "an undeclared variable gave no error");
+
+	const std::string source(gcBlockSource);
+	Require(Edit(parser, 0, parser.tokens().textSize(), source));
+	Expect(parser.block() && parser.diagnostics().empty(), "a block program did not parse");
+	size_t reparsed = 0;
+	Require(Edit(parser, source.find("j = k;"), 1, "k", &reparsed));
+	Expect(reparsed == 9, "an edit in a block reparsed more than the block");
+	Require(Edit(parser, source.find("j = 0"), 1, "k", &reparsed));
+	Expect(parser.diagnostics().size() == 1, "an undeclared variable gave no error");
+
+	// Past the block nothing is parsed; in front of it the program is a
+	// program of functions.
+	Require(Edit(parser, parser.tokens().textSize(), 0, "int f() { }\n", &reparsed));
+	Expect(reparsed == 0, "text after a block program was parsed");
+	Require(Edit(parser, 0, 0, "void g() { }\n"));
+	Expect(!parser.block() && parser.program().GetFunctionsCount() != 0, "the program did not turn into functions");
+	Require(Edit(parser, 0, parser.tokens().text().find("{\n"), ""));
+	Expect(parser.block() != nullptr, "the program did not turn into a block");
+}
+
+// Random edits, most of them undone by the next one, against a full parse
+// after each.
+void EditAtRandom(const std::string& source)
+{
+	IncrementalParser parser(source.data(), source.size());
+	std::mt19937_64 random(1);
+
+	bool undo = false;
+	size_t undoOffset = 0;
+	size_t undoRemoved = 0;
+	std::string undoText;
+	for (size_t i = 0; i < gcRandomEdits; ++i)
+	{
+		const size_t size = parser.tokens().textSize();
+		size_t offset = random() % (size + 1);
+		size_t removed = 0;
+		std::string text;
+		if (undo && random() % 10)
+		{
+			offset = undoOffset;
+			removed = undoRemoved;
+			text = undoText;
+			undo = false;
+		}
+		else
+		{
+			if (random() % 2)
+			{
+				text = gcSnippets[random() % (sizeof(gcSnippets) / sizeof(*gcSnippets))];
+			}
+			else
+			{
+				removed = std::min<size_t>(random() % 20, size - offset);
+			}
+			undoOffset = offset;
+			undoRemoved = text.size();
+			undoText = parser.tokens().text().substr(offset, removed);
+			undo = true;
+		}
+
+		try
+		{
+			Edit(parser, offset, removed, text);
+		}
+		catch (const std::exception& e)
+		{
+			throw std::runtime_error("edit " + std::to_string(i) + ": " + e.what());
+		}
+	}
+}
+
+void RandomEdits()
+{
+	EditAtRandom(gcSource);
+}
+
+void RandomBlockEdits()
+{
+	EditAtRandom(gcBlockSource);
+}
+}
+
+int main()
+{
+	const struct
+	{
+		const char* name;
+		void (*run)();
+	} cases[] = {
+		{ "stray brace", StrayBrace },
+		{ "open at end", OpenAtEnd },
+		{ "lines shift", LinesShift },
+		{ "inner block", InnerBlock },
+		{ "block program", BlockProgram },
+		{ "random edits", RandomEdits },
+		{ "random block edits", RandomBlockEdits }
+	};
+
+	int failures = 0;
+	for (const auto& test : cases)
+	{
+		try
+		{
+			test.run();
+			printf("%s: ok\n", test.name);
+		}
+		catch (const std::exception& e)
+		{
+			fprintf(stderr, "%s: %s\n", test.name, e.what());
+			++failures;
+		}
+	}
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}